@@ -0,0 +1,26 @@
+# Compiles every <code>.json in src_dir into <code>.cat in out_dir at build time,
+# the catalogs are then embedded through libromfs instead of the raw JSON.
+function(compile_lang_catalog target src_dir out_dir outputs)
+  add_executable(lang_catalog
+    ${PROJECT_SOURCE_DIR}/tools/lang_catalog.cpp
+    ${PROJECT_SOURCE_DIR}/source/helpers/lang_catalog.cpp
+  )
+  target_include_directories(lang_catalog PRIVATE ${PROJECT_SOURCE_DIR}/include)
+  target_link_libraries(lang_catalog PRIVATE json)
+
+  file(GLOB LANG_FILES "${src_dir}/*.json")
+  set(CATALOG_FILES "")
+  foreach(file ${LANG_FILES})
+    get_filename_component(code ${file} NAME_WE)
+    set(catalog "${out_dir}/${code}.cat")
+    add_custom_command(OUTPUT ${catalog}
+      COMMAND ${CMAKE_COMMAND} -E make_directory ${out_dir}
+      COMMAND $<TARGET_FILE:lang_catalog> ${file} ${catalog}
+      DEPENDS lang_catalog ${file}
+    )
+    list(APPEND CATALOG_FILES ${catalog})
+  endforeach()
+
+  add_custom_target(${target} DEPENDS ${CATALOG_FILES})
+  set(${outputs} ${CATALOG_FILES} PARENT_SCOPE)
+endfunction()
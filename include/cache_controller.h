@@ -0,0 +1,71 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "config.h"
+#include "mpv.h"
+
+namespace ImPlay {
+// Sizes mpv's demuxer cache for the current file instead of a fixed demuxer-max-bytes.
+//
+// Throughput comes from cache-speed, the media bitrate from demuxer-cache-state (forward bytes
+// over forward seconds). How far to read ahead depends on their ratio and on the source:
+// local files need almost nothing, HLS fetches whole segments and progressive HTTP benefits
+// most from a deep buffer on a slow link. Every rebuffer doubles the target for the rest of
+// the file. Forward and back buffer together stay under Cache.MaxMemory.
+//
+// Driven by mpv property observers, so everything runs on the UI thread.
+class CacheController {
+ public:
+  enum class Policy { None, Local, Hls, Http };
+
+  struct Status {
+    Policy policy = Policy::None;
+    int64_t maxBytes = 0;  // demuxer-max-bytes in effect
+    double readahead = 0;  // seconds
+    double throughput = 0;  // bytes/s
+    double bitrate = 0;     // bytes/s of media
+    int rebuffers = 0;
+  };
+
+  CacheController(Config *config, Mpv *mpv);
+
+  void init();
+  // Reapplies after the adaptive switch, the ceiling or the fixed size changed.
+  void configure();
+  const Status &status() const { return current; }
+
+  static const char *policyName(Policy policy);
+
+ private:
+  static constexpr int64_t MiB = 1 << 20;
+  static constexpr int64_t MinBytes = 16 * MiB;
+  static constexpr int64_t MaxBackBytes = 64 * MiB;
+
+  void fileLoaded();
+  void sample(mpv_node &state);
+  void rebuffered();
+  void decide(const char *reason, bool force);
+  void apply(int64_t bytes, double readahead, const char *reason);
+
+  int64_t backBytes() const;
+
+  // What mpv.conf or the command line set, restored when switching to the fixed size
+  struct Initial {
+    int64_t backBytes = 50 * MiB;
+    double readaheadSecs = 1;
+    double cacheSecs = 3600;
+  } initial;
+
+  Config *config = nullptr;
+  Mpv *mpv = nullptr;
+  Status current;
+  double boost = 1;
+  double speed = 0;  // latest cache-speed
+  bool buffering = false;
+  std::chrono::steady_clock::time_point lastDecision;
+};
+}  // namespace ImPlay
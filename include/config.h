@@ -25,6 +25,9 @@ struct ConfigData {
     bool UseConfig = false;
     bool UseWid = false;
     bool WatchLater = false;
+    bool SniffMedia = true;  // read file headers when a scanned file has no known extension
+    bool FollowGrowing = true;  // keep reading local files that are still being downloaded
+    bool Readahead = true;      // warm the page cache with headers and indexes of local files
     int Volume = 100;
     bool operator==(const Mpv_&) const = default;
   } Mpv;
@@ -44,6 +47,7 @@ struct ConfigData {
   struct Debug_ {
     std::string LogLevel = "status";
     int LogLimit = 500;
+    int PollRate = 5;  // property inspector refresh rate (Hz)
     bool operator==(const Debug_&) const = default;
   } Debug;
   struct Recent_ {
@@ -51,6 +55,30 @@ struct ConfigData {
     bool SpaceToPlayLast = false;
     bool operator==(const Recent_&) const = default;
   } Recent;
+  struct Daemon_ {
+    int IdleTimeout = 30;  // minutes hidden before a daemon exits, 0 = never
+    int TrimDelay = 10;    // seconds hidden before a daemon returns memory to the system
+    bool operator==(const Daemon_&) const = default;
+  } Daemon;
+  struct Cache_ {
+    bool Adaptive = true;  // size the demuxer cache from measured throughput and bitrate
+    int MaxMemory = 400;   // MiB, ceiling for the adaptive cache, back buffer included
+    int Size = 150;        // MiB, fixed forward cache when not adaptive
+    bool Log = false;      // print every adaptive decision to the mpv log
+    bool Disk = false;     // keep remote media bytes on disk across sessions
+    int DiskSize = 4096;   // MiB, least recently used items are evicted beyond this
+    bool operator==(const Cache_&) const = default;
+  } Cache;
+  struct Prefetch_ {
+    bool Enabled = true;  // warm up the next remote playlist item before the current one ends
+    int Lead = 30;        // seconds before the end
+    int Share = 25;       // percent of the measured throughput the warm-up may use
+    bool operator==(const Prefetch_&) const = default;
+  } Prefetch;
+  struct Library_ {
+    std::vector<std::string> Folders;
+    bool operator==(const Library_&) const = default;
+  } Library;
   bool operator==(const ConfigData&) const = default;
 };
 
@@ -0,0 +1,157 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "mpv.h"
+
+namespace ImPlay {
+// Remote media bytes kept on disk across sessions.
+//
+// HTTP(S) items are rewritten on load to diskcache://<url> and read through an mpv_stream_cb
+// reader. It fetches with curl, one range request per seek, streamed from its stdout. Every
+// fetched byte is also written to a sparse <key>.data file, and <key>.meta records the covered
+// ranges with the URL and its validator: the ETag or Last-Modified, plus the size. When the URL
+// is opened again and the validator still matches, those ranges are read from disk. Seeking
+// back and rewatching then cost no network at all. Entries that are not open are evicted least
+// recently used first once the store exceeds [cache] disk-size. Off unless [cache] disk is set.
+//
+// Entries are keyed by the playlist path of the item rather than the URL opened, which an
+// earlier on_load hook may have swapped for a signed, short lived redirect. Requests carry
+// mpv's user-agent, referrer and http-header-fields of the item and follow its cookies,
+// tls-verify, tls-ca-file, http-proxy and network-timeout options. They are passed to curl as a
+// config on stdin (-K -), so headers and cookies do not show up in the process list. Servers
+// without a validator are streamed through without being stored. Not available on Windows,
+// where items keep going through mpv's own HTTP stack.
+class DiskCache {
+ public:
+  static constexpr const char *Protocol = "diskcache";
+
+  struct Stats {
+    int64_t opens = 0;      // items read through the cache
+    int64_t reused = 0;     // of those, found on disk with a matching validator
+    int64_t hitBytes = 0;   // served from disk, the bytes saved
+    int64_t missBytes = 0;  // fetched from the network
+    int64_t storedBytes = 0;
+    int64_t entries = 0;
+
+    double hitRatio() const { return hitBytes + missBytes > 0 ? (double)hitBytes / (hitBytes + missBytes) : 0; }
+  };
+
+  DiskCache(Config *config, Mpv *mpv);
+
+  bool open(const std::filesystem::path &dir);
+  // Registers the protocol and the on_load hook, after mpv's core is initialized.
+  void init();
+
+  Stats stats();
+
+ private:
+  static constexpr int64_t SkipBytes = 512 * 1024;  // read on rather than reconnect for gaps this small
+  static constexpr int64_t SaveBytes = 8 << 20;     // index flush interval while fetching
+  static constexpr int ProbeSecs = 15;
+
+  struct Request {
+    std::string url;     // as opened, every fetch follows its redirects afresh
+    std::string config;  // curl config lines, without the URL
+  };
+
+  // What the on_load hook knows about an item, taken by its stream when it opens
+  struct Pending {
+    std::string path;  // playlist entry, what the entry is keyed by
+    std::string config;
+  };
+
+  struct Entry {
+    std::string key, url, validator;  // url is the playlist path
+    std::filesystem::path meta;
+    int64_t size = 0;
+    std::time_t used = 0;
+    int users = 0;
+    std::mutex lock;
+    std::fstream file;
+    std::map<int64_t, int64_t> ranges;  // start -> end, disjoint
+    int64_t unsaved = 0;
+
+    // Bytes on disk from pos on, 0 when pos is not cached.
+    int64_t cachedAt(int64_t pos);
+    // Start of the first cached range after pos, size if there is none.
+    int64_t nextCached(int64_t pos);
+    int64_t fetch(int64_t pos, char *buf, int64_t n);
+    // Writes fetched bytes, and the index every SaveBytes of them.
+    void store(int64_t pos, const char *buf, int64_t n);
+    int64_t bytes();
+    bool load(const std::filesystem::path &path);
+    void save();
+
+   private:
+    void write();  // with lock held
+  };
+
+  // curl writing the response body of one range request to a pipe
+  struct Fetch {
+    int pid = -1;
+    int fd = -1;
+    int64_t pos = 0;
+
+    bool start(const Request &request, int64_t from);
+    void stop();
+  };
+
+  struct Reader {
+    DiskCache *owner;
+    Request request;
+    std::shared_ptr<Entry> entry;  // null when the server gives nothing to validate against
+    int64_t size = -1;
+    bool ranged = false;
+    int64_t pos = 0;
+    Fetch fetch;
+    std::mutex fetchLock;  // cancel kills the fetch from another thread
+    std::atomic<bool> cancelled = false;
+
+    // Moves the fetch to pos, reading (and storing) small gaps instead of reconnecting.
+    bool seekFetch();
+  };
+
+  struct Indexed {
+    int64_t bytes = 0;
+    std::time_t used = 0;
+  };
+
+  bool accepts(const std::string &url) const;
+  std::string requestConfig();
+  std::shared_ptr<Entry> acquire(const std::string &path, const std::string &validator, int64_t size);
+  void release(const std::shared_ptr<Entry> &entry);
+  void evict();
+  std::filesystem::path pathOf(const std::string &key, const char *ext) const;
+
+  static int openStream(void *userData, char *uri, mpv_stream_cb_info *info);
+  static int64_t read(void *cookie, char *buf, uint64_t nbytes);
+  static int64_t seek(void *cookie, int64_t offset);
+  static int64_t size(void *cookie);
+  static void close(void *cookie);
+  static void cancel(void *cookie);
+
+  Config *config;
+  Mpv *mpv;
+  std::filesystem::path dir;
+  bool ready = false;
+
+  std::mutex lock;
+  std::map<std::string, Indexed> index;
+  std::map<std::string, std::shared_ptr<Entry>> live;
+  std::map<std::string, Pending> pending;  // by stream URL, set on load
+
+  std::atomic<int64_t> opens = 0, reused = 0, hitBytes = 0, missBytes = 0;
+};
+}  // namespace ImPlay
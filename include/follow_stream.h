@@ -0,0 +1,75 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include "mpv.h"
+
+namespace ImPlay {
+// mpv_stream_cb protocol for local files that are still being written: follow://<path>.
+//
+// A read at the current end waits for the file to grow instead of returning EOF, woken by
+// inotify on Linux and polling elsewhere; only once it has not grown for IdleSecs is it
+// treated as complete. Seeks past the written region are accepted and wait the same way. The
+// size reported to mpv is what has been written so far, so demuxers skip index elements that
+// are not there yet, and it is published for the seek bar through available(). Size and
+// modification time come from the open file, not its path, so a download renamed once it
+// completes (foo.mkv.part to foo.mkv) keeps playing to the end.
+class FollowStream {
+ public:
+  static constexpr const char *Protocol = "follow";
+
+  static int add(Mpv *mpv);
+
+  // Whether a local file looks like a download in progress: a partial download extension, or
+  // modified within the last GrowingSecs.
+  static bool growing(const std::filesystem::path &path);
+  // Bytes written so far of a file open through the protocol, -1 for any other file.
+  static int64_t available(const std::string &path);
+  static bool active() { return readers > 0; }
+
+ private:
+  static constexpr int GrowingSecs = 10;
+  static constexpr int IdleSecs = 30;
+
+  struct Reader {
+    std::string path;
+#ifdef _WIN32
+    void *file = nullptr;  // HANDLE, shared for delete so the downloader can rename it
+#else
+    int fd = -1;
+#endif
+    int64_t pos = 0;
+    int64_t size = 0;
+    std::time_t mtime = 0;
+    int notify = -1;  // inotify descriptor, -1 when polling
+    std::atomic<bool> cancelled = false;
+
+    ~Reader();
+    bool open();
+    int64_t readAt(char *buf, int64_t n);
+    // Updates size and mtime from the open file.
+    int64_t refresh();
+    // Waits until the file extends past pos, false on cancel or when it stopped growing.
+    bool waitForData();
+    void sleep();
+  };
+
+  static int open(void *userData, char *uri, mpv_stream_cb_info *info);
+  static int64_t read(void *cookie, char *buf, uint64_t nbytes);
+  static int64_t seek(void *cookie, int64_t offset);
+  static int64_t size(void *cookie);
+  static void close(void *cookie);
+  static void cancel(void *cookie);
+
+  static inline std::atomic<int> readers = 0;
+  static inline std::mutex lock;
+  static inline std::map<std::string, int64_t> sizes;
+};
+}  // namespace ImPlay
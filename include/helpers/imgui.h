@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #pragma once
+#include <vector>
 #include <imgui.h>
 
 namespace ImGui {
@@ -12,4 +13,6 @@ void TextEllipsis(const char* text, float maxWidth = 0);
 void Hyperlink(const char* label, const char* url);
 void HelpMarker(const char* desc);
 ImTextureID LoadTexture(const char* path, ImVec2* size = nullptr);
+// Decompresses a font embedded with binary_to_compressed_c. Thread-safe, needs no context.
+std::vector<unsigned char> DecompressTTF(const void* data, int size);
 }  // namespace ImGui
\ No newline at end of file
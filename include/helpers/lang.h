@@ -3,8 +3,12 @@
 
 #pragma once
 #include <string>
+#include <string_view>
+#include <filesystem>
 #include <map>
+#include <vector>
 #include <imgui.h>
+#include "lang_catalog.h"
 
 namespace ImPlay {
 struct LangFont {
@@ -13,28 +17,42 @@ struct LangFont {
   int glyph_range = 0;
 };
 
+// An available language, the catalog is only loaded for the active and fallback languages.
 struct LangData {
   std::string code;
   std::string title;
+  std::filesystem::path file;  // user override (<code>.json), empty for bundled catalogs
   std::vector<LangFont> fonts;
-  std::map<std::string, std::string> entries;
+  LangCatalog catalog;
 
-  std::string get(std::string& key);
+  LangData() = default;
+  // catalog may view storage: a copy would point into the source's buffer, a move keeps the buffer
+  LangData(const LangData&) = delete;
+  LangData& operator=(const LangData&) = delete;
+  LangData(LangData&&) = default;
+  LangData& operator=(LangData&&) = default;
+
+  bool load();
+  const char* get(const char* key) const;
+
+ private:
+  std::vector<std::byte> storage;  // backing memory for catalogs compiled at runtime
+  bool loaded = false;
 };
 
 class LangStr {
  public:
-  explicit LangStr(std::string key);
+  explicit LangStr(const char* key);
 
-  operator std::string() const;
-  operator std::string_view() const;
-  operator const char*() const;
+  operator std::string() const { return m_str; }
+  operator std::string_view() const { return m_str; }
+  operator const char*() const { return m_str; }
 
  private:
-  std::string m_str;
+  const char* m_str;
 };
 
-inline std::string format_as(LangStr s) { return s; }
+inline std::string_view format_as(LangStr s) { return s; }
 
 const ImWchar* getLangGlyphRanges();
 
@@ -42,10 +60,11 @@ std::map<std::string, LangData>& getLangs();
 std::string& getLangFallback();
 std::string& getLang();
 
-std::string i18n(std::string key);
+// Returns a pointer into the loaded catalog (valid for the process lifetime), or key itself if missing.
+const char* i18n(const char* key);
 template <typename... T>
-inline std::string i18n_a(std::string key, T... args) {
+inline std::string i18n_a(const char* key, T... args) {
   return fmt::vformat(i18n(key), fmt::make_format_args(args...));
 }
 inline LangStr operator""_i18n(const char* key, size_t) { return LangStr(key); }
-}  // namespace ImPlay
\ No newline at end of file
+}  // namespace ImPlay
@@ -0,0 +1,100 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ImPlay {
+// 64-bit FNV-1a, shared by the build-time compiler and runtime lookups. 0 marks an empty slot.
+constexpr uint64_t langHash(std::string_view str) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (char c : str) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3ull;
+  }
+  return hash != 0 ? hash : 1;
+}
+
+// Read-only view over a compiled language catalog.
+//
+// Layout (little endian, no alignment requirement):
+//   Header
+//   Slot[slotCount]   open-addressing table, probed linearly from hash & (slotCount - 1)
+//   Font[fontCount]
+//   char[]            NUL-terminated strings referenced by offset
+class LangCatalog {
+ public:
+  static constexpr uint32_t Magic = 0x434c5049;  // "IPLC"
+  static constexpr uint32_t Version = 1;
+
+  enum Flags_ {
+    Flags_None = 0,
+    Flags_Fallback = 1 << 0,
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t slotCount;
+    uint32_t entryCount;
+    uint32_t fontCount;
+    uint32_t code;
+    uint32_t title;
+  };
+
+  struct Slot {
+    uint64_t hash;
+    uint32_t key;
+    uint32_t value;
+  };
+
+  struct Font {
+    uint32_t path;
+    int32_t size;
+    int32_t glyphRange;
+  };
+
+  LangCatalog() = default;
+  explicit LangCatalog(std::span<const std::byte> data);
+
+  bool valid() const { return data != nullptr; }
+  const char *code() const { return str(header.code); }
+  const char *title() const { return str(header.title); }
+  bool fallback() const { return header.flags & Flags_Fallback; }
+  uint32_t size() const { return header.entryCount; }
+  uint32_t slotCount() const { return header.slotCount; }
+  uint32_t fontCount() const { return header.fontCount; }
+
+  const char *find(std::string_view key) const { return find(key, langHash(key)); }
+  const char *find(std::string_view key, uint64_t hash) const;
+
+  Slot slot(uint32_t index) const;
+  Font font(uint32_t index) const;
+  const char *str(uint32_t offset) const { return offset < stringsSize ? strings + offset : ""; }
+
+  // Compiles a language JSON document, returns an empty buffer and sets error on failure.
+  static std::vector<std::byte> compile(std::string_view json, std::string *error = nullptr);
+
+ private:
+  template <typename T>
+  T load(size_t offset) const {
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+  }
+
+  const std::byte *data = nullptr;
+  Header header{};
+  size_t slotsOffset = 0;
+  size_t fontsOffset = 0;
+  const char *strings = nullptr;
+  size_t stringsSize = 0;
+};
+}  // namespace ImPlay
@@ -0,0 +1,51 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace ImPlay {
+// Memory-mapped view of a whole file.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Maps the file read-only, or read-write when writable is set. A writable file is created
+  // if missing and grown to at least minSize bytes first.
+  bool open(const std::filesystem::path &path, bool writable = false, size_t minSize = 0);
+  void close();
+
+  // Grows or shrinks a writable mapping, the contents up to the smaller size are kept.
+  bool resize(size_t size);
+  // Schedules dirty pages for writeback, waits for completion when sync is set.
+  bool flush(bool sync = false);
+
+  bool valid() const { return ptr != nullptr || (opened && length == 0); }
+  size_t size() const { return length; }
+  std::byte *data() { return ptr; }
+  const std::byte *data() const { return ptr; }
+  std::span<const std::byte> bytes() const { return {ptr, length}; }
+
+ private:
+  bool map();
+  void unmap();
+
+  std::byte *ptr = nullptr;
+  size_t length = 0;
+  bool writable = false;
+  bool opened = false;
+#ifdef _WIN32
+  void *file = nullptr;
+  void *mapping = nullptr;
+#else
+  int fd = -1;
+#endif
+};
+}  // namespace ImPlay
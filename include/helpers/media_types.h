@@ -0,0 +1,128 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+namespace ImPlay {
+enum class MediaType : uint8_t { None, Video, Audio, Image, Subtitle };
+
+namespace MediaTypes {
+inline constexpr std::string_view Video[] = {
+    "yuv", "y4m",   "m2ts", "m2t",   "mts",  "mtv",  "ts",   "tsv",    "tsa",  "tts",  "trp",  "mpeg", "mpg",
+    "mpe", "mpeg2", "m1v",  "m2v",   "mp2v", "mpv",  "mpv2", "mod",    "vob",  "vro",  "evob", "evo",  "mpeg4",
+    "m4v", "mp4",   "mp4v", "mpg4",  "h264", "avc",  "x264", "264",    "hevc", "h265", "x265", "265",  "ogv",
+    "ogm", "ogx",   "mkv",  "mk3d",  "webm", "avi",  "vfw",  "divx",   "3iv",  "xvid", "nut",  "flic", "fli",
+    "flc", "nsv",   "gxf",  "mxf",   "wm",   "wmv",  "asf",  "dvr-ms", "dvr",  "wtv",  "dv",   "hdv",  "flv",
+    "f4v", "qt",    "mov",  "hdmov", "rm",   "rmvb", "3gpp", "3gp",    "3gp2", "3g2"};
+inline constexpr std::string_view Audio[] = {
+    "ac3", "a52",  "eac3", "mlp",  "dts", "dts-hd", "dtshd", "true-hd", "thd",  "truehd", "thd+ac3", "tta", "pcm",
+    "wav", "aiff", "aif",  "aifc", "amr", "awb",    "au",    "snd",     "lpcm", "ape",    "wv",      "shn", "adts",
+    "adt", "mpa",  "m1a",  "m2a",  "mp1", "mp2",    "mp3",   "m4a",     "aac",  "flac",   "oga",     "ogg", "opus",
+    "spx", "mka",  "weba", "wma",  "f4a", "ra",     "ram",   "3ga",     "3ga2", "ay",     "gbs",     "gym", "hes",
+    "kss", "nsf",  "nsfe", "sap",  "spc", "vgm",    "vgz",   "m3u",     "m3u8", "pls",    "cue"};
+inline constexpr std::string_view Image[] = {"jpg", "bmp", "png", "gif", "webp"};
+inline constexpr std::string_view Subtitle[] = {"srt", "ass", "idx", "sub", "sup", "ttxt", "txt", "ssa", "smi", "mks"};
+}  // namespace MediaTypes
+
+// Packs an extension of up to 8 ASCII characters, lowercased, into one integer. 0 if it does not fit.
+template <typename CharT>
+constexpr uint64_t packExtension(std::basic_string_view<CharT> ext) {
+  if (ext.empty() || ext.size() > 8) return 0;
+  uint64_t key = 0;
+  for (CharT c : ext) {
+    if (c <= 0 || c > 0x7f) return 0;
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    key = key << 8 | static_cast<uint8_t>(c);
+  }
+  return key;
+}
+
+// Perfect hash over all known extensions, built at compile time.
+// A multiply-shift hash is searched until no two keys share a slot, so a lookup is one
+// multiplication, one table read and one compare.
+class ExtensionTable {
+ public:
+  static constexpr int Bits = 12;
+  static constexpr size_t Count = std::size(MediaTypes::Video) + std::size(MediaTypes::Audio) +
+                                  std::size(MediaTypes::Image) + std::size(MediaTypes::Subtitle);
+  static_assert(Count < 256, "slot indices are stored in a byte");
+
+  consteval ExtensionTable() {
+    size_t n = 0;
+    auto add = [&](const auto &list, MediaType type) {
+      for (auto ext : list) {
+        keys[n] = packExtension(ext);
+        types[n++] = type;
+      }
+    };
+    add(MediaTypes::Video, MediaType::Video);
+    add(MediaTypes::Audio, MediaType::Audio);
+    add(MediaTypes::Image, MediaType::Image);
+    add(MediaTypes::Subtitle, MediaType::Subtitle);
+
+    uint64_t seed = 0x9e3779b97f4a7c15ull;
+    for (int attempt = 0; attempt < 10000; attempt++) {
+      // splitmix64, forced odd
+      seed += 0x9e3779b97f4a7c15ull;
+      uint64_t m = seed;
+      m = (m ^ (m >> 30)) * 0xbf58476d1ce4e5b9ull;
+      m = (m ^ (m >> 27)) * 0x94d049bb133111ebull;
+      m = (m ^ (m >> 31)) | 1;
+
+      size_t placed = 0;
+      for (; placed < Count; placed++) {
+        auto &s = slots[slot(keys[placed], m)];
+        if (s != 0) break;
+        s = static_cast<uint8_t>(placed + 1);
+      }
+      if (placed == Count) {
+        multiplier = m;
+        return;
+      }
+      for (size_t i = 0; i < placed; i++) slots[slot(keys[i], m)] = 0;
+    }
+    throw "no perfect hash found for the extension table";
+  }
+
+  template <typename CharT>
+  constexpr MediaType find(std::basic_string_view<CharT> ext) const {
+    uint64_t key = packExtension(ext);
+    if (key == 0) return MediaType::None;
+    uint8_t index = slots[slot(key, multiplier)];
+    return index != 0 && keys[index - 1] == key ? types[index - 1] : MediaType::None;
+  }
+
+ private:
+  static constexpr size_t slot(uint64_t key, uint64_t m) { return (key * m) >> (64 - Bits); }
+
+  uint64_t multiplier = 0;
+  std::array<uint8_t, 1 << Bits> slots{};
+  std::array<uint64_t, Count> keys{};
+  std::array<MediaType, Count> types{};
+};
+
+inline constexpr ExtensionTable extensionTable;
+
+// Classifies by extension, case-insensitive. Takes a file name or a full path.
+template <typename CharT>
+constexpr MediaType mediaTypeOf(std::basic_string_view<CharT> path) {
+  for (size_t i = path.size(); i > 0; i--) {
+    CharT c = path[i - 1];
+    if (c == '.') return extensionTable.find(path.substr(i));
+    if (c == '/' || c == '\\') break;
+  }
+  return MediaType::None;
+}
+
+inline MediaType mediaTypeOf(const std::filesystem::path &path) {
+  return mediaTypeOf(std::basic_string_view<std::filesystem::path::value_type>(path.native()));
+}
+
+// Reads the first bytes of a file to recognize common containers and subtitle formats.
+// Does blocking I/O, keep it off the UI thread.
+MediaType sniffMediaType(const std::filesystem::path &path);
+}  // namespace ImPlay
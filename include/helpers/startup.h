@@ -0,0 +1,38 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <filesystem>
+
+// Startup phase timings, enabled with --startup-trace[=<file>].
+//
+//   Startup::mark("name");          ends the phase started by the previous mark
+//   Startup::task("name", begin);   records a step that ran on a worker thread since begin
+//
+// Times are measured from process creation where the OS reports it, otherwise from static
+// initialization. The report is printed, or written as JSON to file, once the first frame
+// is painted and, when media was given, the first video frame is on screen.
+//
+// A launch handed over to a running instance carries its trace along: the running instance
+// adopts it and reports launch to first frame as measured from the launcher's start.
+namespace ImPlay::Startup {
+void enable(const std::filesystem::path &output, bool expectVideo);
+bool enabled();
+std::filesystem::path output();
+// Unix time in milliseconds at which this process started.
+double launchTime();
+// Starts a new trace measured from another process' launchTime(), replacing any trace that
+// has not been reported yet. UI thread only, now() reads the origin without the lock.
+void adopt(const std::filesystem::path &output, bool expectVideo, double launchTime);
+
+void mark(const char *phase);
+// Milliseconds since process start, 0 when disabled.
+double now();
+void task(const char *name, double begin);
+// Called by the video render thread after drawing a frame.
+void videoRendered();
+// Called after each swap, showsVideo when the swapped frame contains the video texture.
+void framePresented(bool showsVideo);
+// Reports whatever was collected, if that has not happened yet.
+void report();
+}  // namespace ImPlay::Startup
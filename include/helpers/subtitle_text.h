@@ -0,0 +1,28 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace ImPlay::SubtitleText {
+enum class Encoding { Utf8, Utf8Bom, Utf16Le, Utf16Be, Codepage, Unknown };
+
+struct Result {
+  Encoding encoding = Encoding::Unknown;
+  int codepage = 0;       // for Encoding::Codepage
+  int repairs = 0;        // SRT cues retimed, reordered, merged or dropped
+  bool srt = false;       // recognized and rewritten as SRT
+  bool changed = false;   // text differs from the input
+  std::string text;       // UTF-8 when encoding is known, the input otherwise
+};
+
+// Converts subtitle text to UTF-8 and, when it looks like SRT, rewrites the cues in canonical form.
+//
+// BOMs and BOM-less UTF-16 are recognized, valid UTF-8 is kept. Anything else is decoded with
+// the given Windows codepage (1250-1256, picked by the caller from the subtitle language);
+// with codepage 0 it is returned untouched for mpv to detect. Does no I/O.
+Result normalize(std::string_view data, int codepage);
+
+const char *encodingName(Encoding encoding);
+}  // namespace ImPlay::SubtitleText
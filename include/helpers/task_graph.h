@@ -0,0 +1,40 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <deque>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <thread>
+
+namespace ImPlay {
+// Runs independent startup steps on worker threads.
+//
+// Each task starts on its own thread as soon as it is added and waits for its dependencies
+// first, a failed dependency fails the task with the same exception. The owner joins tasks at
+// fixed points with wait(), which rethrows, so the observable order of initialization does
+// not depend on scheduling.
+class TaskGraph {
+ public:
+  using Task = size_t;
+
+  TaskGraph() = default;
+  ~TaskGraph();
+
+  TaskGraph(const TaskGraph &) = delete;
+  TaskGraph &operator=(const TaskGraph &) = delete;
+
+  Task add(const char *name, std::function<void()> fn, std::initializer_list<Task> deps = {});
+  void wait(Task task);
+
+ private:
+  struct Node {
+    const char *name;
+    std::shared_future<void> done;
+    std::thread thread;
+  };
+
+  std::deque<Node> nodes;
+};
+}  // namespace ImPlay
@@ -0,0 +1,66 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <filesystem>
+
+// Scoped tracing zones, exported as Chrome trace-event JSON (opens in Perfetto / chrome://tracing).
+//
+//   TRACE_ZONE("name");    records the enclosing scope, name must be a string literal
+//   TRACE_FUNC();          same, named after the enclosing function
+//   TRACE_THREAD("name");  names the calling thread in the exported trace
+//
+// Zones are recorded into per-thread ring buffers only while tracing is started,
+// and compile to nothing when built without IMPLAY_TRACING.
+#ifdef IMPLAY_TRACING
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ImPlay::Trace {
+extern std::atomic<bool> recording;
+
+inline int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void record(const char *name, int64_t begin, int64_t end);
+void setThreadName(const char *name);
+
+void start();
+void stop();
+bool dump(const std::filesystem::path &path);
+
+class Zone {
+ public:
+  explicit Zone(const char *name) : name(name), begin(recording.load(std::memory_order_relaxed) ? now() : -1) {}
+  ~Zone() {
+    if (begin >= 0) record(name, begin, now());
+  }
+
+  Zone(const Zone &) = delete;
+  Zone &operator=(const Zone &) = delete;
+
+ private:
+  const char *name;
+  int64_t begin;
+};
+}  // namespace ImPlay::Trace
+
+#define IMPLAY_TRACE_CONCAT_(a, b) a##b
+#define IMPLAY_TRACE_CONCAT(a, b) IMPLAY_TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) ImPlay::Trace::Zone IMPLAY_TRACE_CONCAT(traceZone_, __LINE__)(name)
+#define TRACE_FUNC() TRACE_ZONE(__func__)
+#define TRACE_THREAD(name) ImPlay::Trace::setThreadName(name)
+#else
+namespace ImPlay::Trace {
+inline void start() {}
+inline void stop() {}
+inline bool dump(const std::filesystem::path &path) { return false; }
+}  // namespace ImPlay::Trace
+
+#define TRACE_ZONE(name) (void)0
+#define TRACE_FUNC() (void)0
+#define TRACE_THREAD(name) (void)0
+#endif
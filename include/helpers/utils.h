@@ -2,11 +2,13 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #pragma once
+#include <algorithm>
 #include <codecvt>
 #include <locale>
 #include <filesystem>
 #include <string>
 #include <map>
+#include <thread>
 #include <vector>
 #include <fmt/format.h>
 #include <fmt/chrono.h>
@@ -33,6 +35,9 @@ struct OptionParser {
   std::map<std::string, std::string> options;
   std::vector<std::string> paths;
   std::vector<CmdSubtitleProvider> subtitleProviders;
+  // --startup-trace of a launch handed over to a running instance, adopted on the UI thread
+  std::string traceOutput;
+  double traceLaunched = -1;
 
   void parse(int argc, char** argv);
   bool check(std::string key, std::string value);
@@ -45,6 +50,8 @@ bool fileExists(std::string path);
 
 int openUrl(std::string url);
 void revealInFolder(std::string path);
+// Returns freed heap pages and, on Windows, the working set to the system.
+void releaseMemory();
 
 std::filesystem::path dataPath();
 
@@ -85,5 +92,36 @@ inline std::string join(std::vector<std::string> v, std::string_view sep) {
 
 std::vector<std::string> split(const std::string& str, const std::string& sep);
 
-bool findCase(std::string haystack, std::string needle);
+// Case-folded key whose byte order is natural order ("ep 9" < "Ep 10").
+std::string naturalKey(std::string_view str);
+
+// std::sort on up to one chunk per core, followed by pairwise std::inplace_merge passes.
+// Falls back to a plain std::sort when the range is too small to be worth the threads.
+template <typename It, typename Compare>
+void parallelSort(It first, It last, Compare comp, size_t minChunk = 1 << 14) {
+  size_t n = last - first;
+  size_t threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 16);
+  size_t chunks = std::min(threads, n / minChunk);
+  if (chunks < 2) {
+    std::sort(first, last, comp);
+    return;
+  }
+
+  std::vector<It> bounds(chunks + 1);
+  for (size_t i = 0; i <= chunks; i++) bounds[i] = first + n * i / chunks;
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < chunks; i++)
+    workers.emplace_back([=] { std::sort(bounds[i], bounds[i + 1], comp); });
+  for (auto& w : workers) w.join();
+
+  for (size_t width = 1; width < chunks; width *= 2) {
+    workers.clear();
+    for (size_t i = 0; i + width < chunks; i += 2 * width) {
+      It begin = bounds[i], mid = bounds[i + width], end = bounds[std::min(i + 2 * width, chunks)];
+      workers.emplace_back([=] { std::inplace_merge(begin, mid, end, comp); });
+    }
+    for (auto& w : workers) w.join();
+  }
+}
+
 }  // namespace ImPlay
@@ -0,0 +1,65 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "helpers/utils.h"
+
+namespace ImPlay {
+// Single instance handoff.
+//
+// The running instance listens on a per-user local socket (a named pipe on Windows) whose
+// address needs no config, so a second launch can try it before doing any other work. The
+// launcher sends its whole command line, paths, options and subtitle providers, as one frame
+// and exits as soon as the running instance acknowledges it.
+//
+// A frame is a 4 byte magic and a 4 byte little-endian length followed by that many bytes of
+// JSON; the reply is a single status byte.
+class Instance {
+ public:
+  using Handler = std::function<void()>;
+
+  Instance() = default;
+  ~Instance();
+
+  // Client side: true when a running instance accepted the request.
+  static bool forward(const OptionParser &request);
+
+  // Server side: handler is called on the listener thread after a request was queued.
+  bool listen(Handler handler);
+  std::vector<OptionParser> take();
+
+ private:
+  static constexpr uint32_t Magic = 0x49505450;  // "PTPI"
+  static constexpr uint32_t MaxFrame = 4 << 20;
+
+  enum Status : uint8_t {
+    Status_Ok = 1,
+    Status_Invalid = 2,
+  };
+
+  static std::string address();
+  static std::string encode(const OptionParser &request);
+  static bool decode(const std::string &payload, OptionParser &request);
+
+  void run();
+  uint8_t receive(const std::string &payload);
+
+  Handler handler;
+  std::thread worker;
+  std::atomic<bool> quit = false;
+  std::mutex lock;
+  std::vector<OptionParser> requests;
+#ifdef _WIN32
+  void *pipe = nullptr;
+#else
+  int listenFd = -1;
+  int wakeFd[2] = {-1, -1};
+#endif
+};
+}  // namespace ImPlay
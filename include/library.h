@@ -0,0 +1,130 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "helpers/mapped_file.h"
+#include "helpers/media_types.h"
+#include "config.h"
+
+namespace ImPlay {
+// Persistent index of the media files under the configured library folders.
+//
+// The index lives in one file that is memory-mapped and queried in place: a header, fixed-size
+// records sorted by path, and a string blob. Changes since the last compaction are kept in a
+// small in-memory delta that overrides the mapped records, and are merged into a new file by
+// the worker thread. On startup only folders whose mtime changed are relisted; afterwards the
+// tree is kept current with inotify on Linux.
+class MediaLibrary {
+ public:
+  struct Item {
+    std::string path;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    double duration = 0;  // seconds, recorded on first playback
+    MediaType type = MediaType::None;
+  };
+
+  explicit MediaLibrary(Config *config);
+  ~MediaLibrary();
+
+  void start();
+  void rescan();
+  void addFolder(const std::filesystem::path &folder);
+
+  // Media files under an indexed folder in natural order, nullopt while the folder is not indexed.
+  std::optional<std::vector<std::string>> folder(const std::filesystem::path &folder) const;
+  // Files whose name or path contains every space-separated word of query, name hits first.
+  std::vector<Item> search(std::string_view query, size_t limit) const;
+  void setDuration(const std::string &path, double duration);
+
+  size_t size() const { return files; }
+  bool indexing() const { return busy; }
+
+ private:
+  static constexpr uint32_t Magic = 0x424c5049;  // "IPLB"
+  static constexpr uint32_t Version = 1;
+  static constexpr uint32_t DirectoryType = 0xff;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;
+  };
+
+  struct Record {
+    uint64_t pathOffset;
+    uint32_t pathLength;
+    uint32_t type;
+    uint64_t size;
+    int64_t mtime;
+    double duration;
+  };
+
+  struct Entry {
+    uint32_t type = 0;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    double duration = 0;
+
+    bool operator==(const Entry &) const = default;
+  };
+
+  // mapped index, call with lock held
+  size_t count() const;
+  Record record(size_t index) const;
+  std::string_view recordPath(const Record &r) const;
+  size_t lowerBound(std::string_view path) const;
+  std::optional<Entry> find(std::string_view path) const;
+  template <typename Fn>
+  void forEach(std::string_view prefix, Fn fn) const;
+
+  void put(const std::string &path, std::optional<Entry> entry);
+  void removeTree(const std::string &path);
+
+  void run();
+  void waitForChanges();
+  void reconcile(const std::filesystem::path &dir, bool force = false);
+  void updateFile(const std::filesystem::path &path);
+  void updateFolder(const std::filesystem::path &dir);
+  void compact();
+  bool openIndex(std::string names = {});
+
+  std::filesystem::path indexPath() const;
+  std::vector<std::filesystem::path> roots() const;
+
+  Config *config;
+  MappedFile index;
+  std::string names;  // the path blob of the index lowercased, for search
+  std::map<std::string, std::optional<Entry>, std::less<>> delta;  // nullopt: removed since the last compaction
+  mutable std::shared_mutex lock;
+
+  std::thread worker;
+  mutable std::mutex waitLock;
+  std::condition_variable cond;
+  std::vector<std::filesystem::path> folders;  // guarded by waitLock
+  std::atomic<bool> quit = false;
+  bool pending = false;
+  std::atomic<bool> busy = true;
+  std::atomic<size_t> files = 0;
+
+#ifdef __linux__
+  void watch(const std::filesystem::path &dir);
+  bool handleEvents();
+
+  int inotifyFd = -1;
+  int wakeFd[2] = {-1, -1};
+  std::map<int, std::filesystem::path> watches;
+#endif
+};
+}  // namespace ImPlay
@@ -0,0 +1,95 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mpv.h"
+
+namespace ImPlay {
+// Time to first frame of every opened item, broken down by stage.
+//
+// A client of its own listens to the open sequence on a background thread, so it neither
+// shares the debug console's log level nor adds work to the UI thread. Connect and probe are
+// taken from mpv's verbose demux messages ("Trying demuxers", "Detected file format"), the
+// first frame is reported by the render path. Finished items are kept for the debug view,
+// aggregated per source (local, a protocol, or scheme://host) and appended to a JSON lines file,
+// where URLs are logged without userinfo, query and fragment.
+class LoadTimings {
+ public:
+  enum Stage_ {
+    Stage_Connect,      // stream opened, demuxer probing starts
+    Stage_Probe,        // file format detected
+    Stage_Loaded,       // MPV_EVENT_FILE_LOADED
+    Stage_VideoConfig,  // first MPV_EVENT_VIDEO_RECONFIG
+    Stage_FirstFrame,   // first frame rendered after it
+    Stage_FirstAudio,   // first audio-pts
+    Stage_COUNT,
+  };
+
+  struct Item {
+    std::string path;
+    std::string source;
+    std::string result;                // ok, error, aborted or timeout
+    std::array<double, Stage_COUNT> ms;  // since MPV_EVENT_START_FILE, negative when not reached
+  };
+
+  struct Stats {
+    int count = 0;
+    std::array<int, Stage_COUNT> reached{};
+    std::array<double, Stage_COUNT> total{};
+    std::array<double, Stage_COUNT> worst{};
+
+    double mean(Stage_ stage) const { return reached[stage] > 0 ? total[stage] / reached[stage] : -1; }
+  };
+
+  explicit LoadTimings(Mpv *mpv);
+  ~LoadTimings();
+
+  void start(const std::filesystem::path &log);
+  // Called by the video render path after each frame, cheap unless a first frame is awaited.
+  void videoRendered();
+
+  std::vector<Item> items();
+  std::map<std::string, Stats> stats();
+
+  static const char *stageName(Stage_ stage);
+  static std::string sourceOf(const std::string &path);
+  // The path without credentials and signed tokens: no user:pass@, ?query or #fragment.
+  static std::string redact(const std::string &path);
+
+ private:
+  static constexpr size_t MaxItems = 50;
+  static constexpr int TimeoutSecs = 60;
+  static constexpr uintmax_t MaxLogSize = 8 << 20;  // then rotated to <log>.1
+  static constexpr uint64_t AudioPtsId = 1;
+
+  void run();
+  void record(Stage_ stage, std::chrono::steady_clock::time_point at);
+  void finish(const char *result);  // call with lock held
+  void write(const Item &item);
+
+  Mpv *mpv = nullptr;
+  mpv_handle *client = nullptr;
+  std::filesystem::path logPath;
+  std::thread worker;
+  std::atomic<bool> quit = false;
+  std::atomic<bool> awaitingFrame = false;
+
+  std::mutex lock;
+  bool active = false;
+  bool expectVideo = false, expectAudio = false;
+  std::chrono::steady_clock::time_point started;
+  Item current;
+  std::deque<Item> finished;
+  std::map<std::string, Stats> sources;
+};
+}  // namespace ImPlay
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #pragma once
+#include <map>
 #include <string>
 #include <vector>
 #include <functional>
@@ -9,6 +10,7 @@
 #include <atomic>
 #include <mpv/client.h>
 #include <mpv/render_gl.h>
+#include <mpv/stream_cb.h>
 
 namespace ImPlay {
 typedef void *(*GLAddrLoadFunc)(const char *name);
@@ -21,7 +23,9 @@ class Mpv {
   using LogHandler = std::function<void(const char *, const char *, const char *)>;
   using Callback = std::function<void(Mpv *)>;
 
-  void init(GLAddrLoadFunc load, int64_t wid = 0);
+  // mpv_initialize, does not need a GL context and may run on another thread
+  void initCore(int64_t wid = 0);
+  void init(GLAddrLoadFunc load);
   void render(int w, int h, int fbo = 0, bool flip = true);
   bool wantRender();
   bool frameRendered();
@@ -40,6 +44,19 @@ class Mpv {
   inline int command(const char *args) { return mpv_command_string(mpv, args); }
   inline int command(const char *args[]) { return mpv_command_async(mpv, 0, args); }
   int commandv(const char *arg, ...);
+  // loadfile with per-file options, passed as named arguments so it works across mpv versions
+  int loadfile(const char *url, const char *flags, const std::map<std::string, std::string> &options);
+  // Runs a program with mpv's subprocess command and waits for it, killing it once cancel is
+  // set. Returns its exit status, or a negative value when it could not be started or was
+  // cancelled; stdout is captured into output when given. Blocks, keep it off the UI thread.
+  int subprocess(const std::vector<std::string> &args, const std::atomic<bool> &cancel,
+                 std::string *output = nullptr);
+  // Registers a read-only stream protocol, open is called on mpv's demuxer thread.
+  int addProtocol(const char *protocol, void *userData, mpv_stream_cb_open_ro_fn open) {
+    return mpv_stream_cb_add_ro(mpv, protocol, userData, open);
+  }
+  // Additional client on the same core, with its own event queue. The caller mpv_destroy()s it.
+  mpv_handle *createClient(const char *name) { return mpv_create_client(main, name); }
 
   std::string property(const char *name) {
     char *data = mpv_get_property_string(mpv, name);
@@ -66,11 +83,17 @@ class Mpv {
   }
 
   void observeEvent(mpv_event_id event, const EventHandler &handler) { events.emplace_back(event, handler); }
+  // Runs handler from waitEvent when the named hook (on_load, on_unload...) is reached, mpv
+  // continues once it returns.
+  void observeHook(const char *name, int priority, const std::function<void()> &handler);
   template <typename T, mpv_format format>
-  void observeProperty(const std::string &name, const std::function<void(T data)> &handler) {
-    propertyEvents.emplace_back(name, format, [=](void *data) { handler(*(T *)data); });
-    mpv_observe_property(mpv, 0, name.c_str(), format);
+  uint64_t observeProperty(const std::string &name, const std::function<void(T data)> &handler) {
+    uint64_t id = ++propertyEventId;
+    propertyEvents.emplace_back(id, format, [=](void *data) { handler(*(T *)data); });
+    mpv_observe_property(mpv, id, name.c_str(), format);
+    return id;
   }
+  void unobserveProperty(uint64_t id);
 
   struct TrackItem {
     int64_t id = -1;
@@ -114,6 +137,7 @@ class Mpv {
   std::vector<TrackItem> tracks;
   std::vector<AudioDevice> audioDevices;
   std::vector<BindingItem> bindings;
+  uint64_t bindingsVersion = 0;  // bumped whenever bindings is rebuilt
   std::vector<std::string> profiles;
   std::string aid, vid, sid, sid2, audioDevice, cursorAutohide;
   int64_t chapter, volume, playlistPos, playlistPlayingPos, timePos;
@@ -142,6 +166,8 @@ class Mpv {
   std::atomic<bool> frameRendered_{false};
 
   std::vector<std::tuple<mpv_event_id, EventHandler>> events;
-  std::vector<std::tuple<std::string, mpv_format, EventHandler>> propertyEvents;
+  std::vector<std::tuple<uint64_t, mpv_format, EventHandler>> propertyEvents;
+  std::vector<std::tuple<uint64_t, std::function<void()>>> hooks;
+  uint64_t propertyEventId = 0;
 };
 }  // namespace ImPlay
\ No newline at end of file
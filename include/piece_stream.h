@@ -0,0 +1,115 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "helpers/mapped_file.h"
+#include "mpv.h"
+
+namespace ImPlay {
+// Piece cache shared with the torrent backend, mapped into memory.
+//
+// A cache directory holds two files the producer creates before handing out the URL:
+//   pieces.data   the content, piece i at i * pieceLength, sized up front (sparse is fine)
+//   pieces.state  a 32 byte header followed by one uint32 "have" word and one uint8 priority
+//                 per piece, all little endian:
+//                   0  "PTPC"          4  version (1)     8  total size (uint64)
+//                   16 piece length    20 piece count     24 hint sequence   28 reserved
+//
+// The producer writes a piece to pieces.data, then stores 1 into its have word and wakes it
+// (FUTEX_WAKE on Linux, readers elsewhere poll). Readers write what they need into the
+// priority bytes, 3 for the piece a read is blocked on, 2 for the next ones and 1 for the
+// rest of the read-ahead window, and bump the hint sequence (also woken) after each change.
+class PieceCache {
+ public:
+  enum Priority : uint8_t { Priority_None, Priority_Readahead, Priority_Next, Priority_Now };
+
+  bool open(const std::filesystem::path &dir);
+
+  int64_t size() const { return total; }
+  int64_t pieceLength() const { return length; }
+  int64_t pieceCount() const { return count; }
+  const std::byte *data() const { return content.data(); }
+
+  bool have(int64_t piece) const;
+  // Blocks until the piece is available, false once cancel is set. Keeps the piece at
+  // Priority_Now while waiting, whoever else writes its priority byte.
+  bool wait(int64_t piece, const std::atomic<bool> &cancel);
+  // Stores a priority byte; publishHints makes a batch of them visible to the producer.
+  void setPriority(int64_t piece, Priority priority);
+  void publishHints();
+
+ private:
+  static constexpr size_t HeaderSize = 32;
+
+  uint32_t *haveWord(int64_t piece) const;
+  uint8_t *priorityByte(int64_t piece) const;
+
+  MappedFile state, content;
+  int64_t total = 0, length = 0, count = 0;
+};
+
+// mpv_stream_cb protocol reading from a PieceCache: ptpiece://<cache directory>.
+//
+// Unlike the HTTP bridge there is no socket and no parsing. mpv_stream_cb reads into a buffer
+// mpv owns, so true zero-copy is not possible; what this protocol gets is the closest it allows,
+// a single memcpy from the mapping into that buffer. A read of a missing piece blocks until the
+// producer completes it rather than reporting EOF, and the reader's position becomes priority
+// hints so the producer fetches what playback needs next. Several readers of one cache (mpv
+// opens more than one stream for some files) are counted per piece, and each piece gets the
+// highest priority any of them wants.
+class PieceStream {
+ public:
+  static constexpr const char *Protocol = "ptpiece";
+
+  static int add(Mpv *mpv);
+
+ private:
+  static constexpr int64_t ReadaheadPieces = 16;
+  static constexpr int64_t NextPieces = 2;
+
+  // Readers of one cache wanting each piece, by priority
+  struct Wants {
+    std::mutex lock;
+    std::vector<std::array<uint16_t, 4>> counts;
+  };
+
+  // What one reader hinted
+  struct Window {
+    int64_t first = -1, last = -1;
+    int64_t now = -1;  // piece a read is blocked on
+
+    PieceCache::Priority wanted(int64_t piece) const;
+  };
+
+  struct Reader {
+    PieceCache cache;
+    std::shared_ptr<Wants> wants;
+    int64_t pos = 0;
+    Window window;
+    std::atomic<bool> cancelled = false;
+
+    // Moves the window to start at piece, with now the piece a read waits for or -1.
+    void hint(int64_t piece, int64_t now);
+    void clearHints() { hint(-1, -1); }
+  };
+
+  static int open(void *userData, char *uri, mpv_stream_cb_info *info);
+  static int64_t read(void *cookie, char *buf, uint64_t nbytes);
+  static int64_t seek(void *cookie, int64_t offset);
+  static int64_t size(void *cookie);
+  static void close(void *cookie);
+  static void cancel(void *cookie);
+
+  static inline std::mutex lock;
+  static inline std::map<std::string, std::weak_ptr<Wants>> wantsByCache;
+};
+}  // namespace ImPlay
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #pragma once
+#include <chrono>
 #include <map>
 #include <string>
 #include <vector>
@@ -12,11 +13,24 @@
 #include <GL/gl.h>
 #endif
 #include "mpv.h"
+#include "cache_controller.h"
 #include "config.h"
+#include "disk_cache.h"
+#include "follow_stream.h"
+#include "instance.h"
+#include "library.h"
+#include "load_timings.h"
+#include "piece_stream.h"
+#include "playlist_prefetch.h"
+#include "readahead.h"
+#include "resume.h"
+#include "scanner.h"
+#include "subtitle_cache.h"
 #include "views/view.h"
 #include "views/debug.h"
 #include "views/player_overlay.h"
 #include "helpers/imgui.h"
+#include "helpers/media_types.h"
 #include "helpers/nfd.h"
 #include "helpers/utils.h"
 
@@ -29,20 +43,31 @@ class Player {
   ~Player();
 
  protected:
-  bool init(std::map<std::string, std::string> &options);
+  bool initMpv(std::map<std::string, std::string> &options);
+  bool init();
   void shutdown();
   
   // Set external subtitle providers from command line
   void setExternalSubtitleProviders(const std::vector<CmdSubtitleProvider>& providers);
+  // Applies a command line handed over by another launch.
+  void handoff(const OptionParser &request);
+
+  // Daemon mode: closing hides the window and stops playback instead of quitting.
+  void park();
+  // Trims memory or exits once the parked daemon has been idle long enough. Returns the
+  // seconds until it next needs to run, negative when it has nothing left to do.
+  double parkedTick();
 
   void initGui();
   void exitGui();
   void saveState();
   void restoreState();
 
+  void prepareFonts();
   void loadFonts();
   void render();
   void renderVideo();
+  void processEvents();
 
   void onCursorEvent(double x, double y);
   void onScrollEvent(double x, double y);
@@ -54,6 +79,8 @@ class Player {
   Config *config = nullptr;
   Mpv *mpv = nullptr;
   int width = 1280, height = 720;
+  bool daemon = false;
+  bool parked = false;
 
  private:
   void updateWindowState();
@@ -74,13 +101,20 @@ class Player {
 
   void playlistSort(bool reverse = false);
 
+  ResumeStore::State resumeState();
+  void restoreResume(const std::string &key);
+
+  void releaseVideo();
+
   void drawOpenURL();
   void drawDialog();
   void messageBox(std::string title, std::string msg);
 
   void load(std::vector<std::filesystem::path> files, bool append = false, bool disk = false);
-  bool isMediaFile(std::string file);
-  bool isSubtitleFile(std::string file);
+  void loadPlaylist(const std::vector<std::string> &paths, bool append);
+  // Queues a local file for Readahead if [mpv] readahead is on, its worker starts on first use.
+  void warm(const std::filesystem::path &path);
+  bool isMediaFile(const std::filesystem::path &file, bool sniff = false);
 
   virtual int64_t GetWid() { return 0; }
   virtual GLAddrLoadFunc GetGLAddrFunc() = 0;
@@ -106,10 +140,13 @@ class Player {
   virtual void SetWindowFloating(bool f) = 0;
   virtual void SetWindowFullscreen(bool fs) = 0;
   virtual void SetWindowShouldClose(bool c) = 0;
+  virtual void RaiseWindow() = 0;
+  virtual void HideWindow() = 0;
 
   bool idle = true;
   GLuint fbo = 0, tex = 0;
   ImTextureID logoTexture = 0;
+  std::vector<unsigned char> cascadiaFont, iconFont, unifontFont;
   std::mutex contextLock;
 
   bool m_openURL = false;
@@ -119,31 +156,29 @@ class Player {
 
   Views::Debug *debug;
   Views::PlayerOverlay *playerOverlay;
-
-  const std::vector<std::string> videoTypes = {
-      "yuv", "y4m",   "m2ts", "m2t",   "mts",  "mtv",  "ts",   "tsv",    "tsa",  "tts",  "trp",  "mpeg", "mpg",
-      "mpe", "mpeg2", "m1v",  "m2v",   "mp2v", "mpv",  "mpv2", "mod",    "vob",  "vro",  "evob", "evo",  "mpeg4",
-      "m4v", "mp4",   "mp4v", "mpg4",  "h264", "avc",  "x264", "264",    "hevc", "h265", "x265", "265",  "ogv",
-      "ogm", "ogx",   "mkv",  "mk3d",  "webm", "avi",  "vfw",  "divx",   "3iv",  "xvid", "nut",  "flic", "fli",
-      "flc", "nsv",   "gxf",  "mxf",   "wm",   "wmv",  "asf",  "dvr-ms", "dvr",  "wtv",  "dv",   "hdv",  "flv",
-      "f4v", "qt",    "mov",  "hdmov", "rm",   "rmvb", "3gpp", "3gp",    "3gp2", "3g2"};
-  const std::vector<std::string> audioTypes = {
-      "ac3", "a52",  "eac3", "mlp",  "dts", "dts-hd", "dtshd", "true-hd", "thd",  "truehd", "thd+ac3", "tta", "pcm",
-      "wav", "aiff", "aif",  "aifc", "amr", "awb",    "au",    "snd",     "lpcm", "ape",    "wv",      "shn", "adts",
-      "adt", "mpa",  "m1a",  "m2a",  "mp1", "mp2",    "mp3",   "m4a",     "aac",  "flac",   "oga",     "ogg", "opus",
-      "spx", "mka",  "weba", "wma",  "f4a", "ra",     "ram",   "3ga",     "3ga2", "ay",     "gbs",     "gym", "hes",
-      "kss", "nsf",  "nsfe", "sap",  "spc", "vgm",    "vgz",   "m3u",     "m3u8", "pls",    "cue"};
-  const std::vector<std::string> imageTypes = {"jpg", "bmp", "png", "gif", "webp"};
-  const std::vector<std::string> subtitleTypes = {"srt",  "ass", "idx", "sub", "sup",
-                                                  "ttxt", "txt", "ssa", "smi", "mks"};
+  FolderScanner *scanner;
+  MediaLibrary *library;
+  ResumeStore *resume;
+  Instance *instance;
+  SubtitleCache *subtitles;
+  CacheController *cache;
+  LoadTimings *timings;
+  PlaylistPrefetch *prefetch;
+  DiskCache *diskCache;
+  Readahead *readahead = nullptr;
+  std::string resumeKey;  // media being played, empty when not tracked
+  ResumeStore::State resumeLast;
+  std::chrono::steady_clock::time_point resumeCheckpoint;
+  std::chrono::steady_clock::time_point parkedAt;
+  bool trimmed = false;
 
   const std::vector<std::pair<std::string, std::string>> mediaFilters = {
-      {"Videos Files", fmt::format("{}", join(videoTypes, ","))},
-      {"Audio Files", fmt::format("{}", join(audioTypes, ","))},
-      {"Image Files", fmt::format("{}", join(imageTypes, ","))},
+      {"Videos Files", fmt::format("{}", fmt::join(MediaTypes::Video, ","))},
+      {"Audio Files", fmt::format("{}", fmt::join(MediaTypes::Audio, ","))},
+      {"Image Files", fmt::format("{}", fmt::join(MediaTypes::Image, ","))},
   };
   const std::vector<std::pair<std::string, std::string>> subtitleFilters = {
-      {"Subtitle Files", fmt::format("{}", join(subtitleTypes, ","))},
+      {"Subtitle Files", fmt::format("{}", fmt::join(MediaTypes::Subtitle, ","))},
   };
   const std::vector<std::pair<std::string, std::string>> isoFilters = {
       {"ISO Image Files", "iso"},
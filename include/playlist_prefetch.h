@@ -0,0 +1,106 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cache_controller.h"
+#include "config.h"
+#include "mpv.h"
+
+namespace ImPlay {
+// Gets the next remote playlist item ready while the current one is still playing.
+//
+// Prefetch.Lead seconds before the end, a curl run (mpv's subprocess command) follows the
+// redirects of the next URL and reads its first bytes, which warms DNS, TLS and the CDN edge,
+// rate limited to Prefetch.Share of the throughput the cache controller measured. When the URL
+// turned out to redirect, an on_load hook opens the final URL directly; otherwise mpv's own
+// prefetch-playlist is enabled, which opens the next item once the current one is fully cached
+// and so never competes with it. The gap between the end of an item and playback of the next
+// is measured for every automatic advance.
+//
+// Driven by mpv events and property observers on the UI thread, only curl runs on a worker. A
+// worker that is replaced is aborted and reaped once it has finished, never joined while it
+// may still be stuck connecting.
+class PlaylistPrefetch {
+ public:
+  enum class State { Idle, Running, Done, Failed };
+
+  struct Warmup {
+    State state = State::Idle;
+    std::string url;
+    std::string resolved;  // after redirects, once done
+    double ms = 0;
+  };
+
+  struct Gap {
+    std::string path;
+    double ms = 0;            // end of the previous item to playback restart
+    bool warmed = false;      // the warm-up finished before the item started
+    bool redirected = false;  // opened through the resolved URL
+    bool prefetched = false;  // mpv's prefetch-playlist was enabled for it
+  };
+
+  PlaylistPrefetch(Config *config, Mpv *mpv, CacheController *cache);
+  ~PlaylistPrefetch();
+
+  void init();
+  Warmup warmup();
+  const std::deque<Gap> &gaps() const { return recent; }
+
+  static const char *stateName(State state);
+
+ private:
+  static constexpr int64_t WarmBytes = 1 << 20;
+  static constexpr int64_t MinRate = 128 << 10;  // bytes/s, before anything was measured
+  static constexpr int WarmTimeout = 20;         // seconds
+  static constexpr size_t MaxGaps = 20;
+
+  void tick(int64_t remaining);
+  void startFile();
+  void endFile(mpv_event_end_file *event);
+  void restarted();
+  void onLoad();
+
+  // One curl run on its own thread
+  struct Job {
+    uint64_t id = 0;
+    std::atomic<bool> cancelled = false;
+    std::atomic<bool> finished = false;
+    std::thread thread;
+  };
+
+  std::string nextUrl();
+  void start(const std::string &url);
+  void run(Job *job, std::string url, int64_t rate);
+  // Aborts the running job without waiting for it, and joins the retired jobs that are done.
+  void cancel();
+
+  Config *config = nullptr;
+  Mpv *mpv = nullptr;
+  CacheController *cache = nullptr;
+
+  std::unique_ptr<Job> job;
+  std::vector<std::unique_ptr<Job>> retired;
+  uint64_t jobs = 0;
+  std::mutex lock;
+  Warmup current;
+  uint64_t currentJob = 0;  // the job current belongs to
+
+  bool armed = false;        // warm-up started for the playing item
+  std::string warming;       // the URL it was started for, empty when the next item is not remote
+  bool applied = false;      // its result has been acted on
+  bool prefetching = false;  // prefetch-playlist set by us
+  std::string redirectFrom, redirectTo;  // swapped by the on_load hook
+  bool gapPending = false;
+  std::chrono::steady_clock::time_point gapStart;
+  Gap next;
+  std::deque<Gap> recent;
+};
+}  // namespace ImPlay
@@ -0,0 +1,47 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace ImPlay {
+// Warms the page cache for local media before mpv probes it.
+//
+// Opening a file costs mpv a read of its head and often a seek to an index at the other end,
+// like the moov box of an MP4 written without faststart or the cues of an MKV. On a spinning
+// disk or a network mount each of those is a random read paid before the first frame. queue()
+// hands the file to a worker. The worker asks the kernel to read the head and the tail ahead
+// (POSIX_FADV_WILLNEED, F_RDADVISE on macOS), or the exact moov box for MP4, and returns without
+// waiting for the data. By the time mpv gets there the pages are cached. Windows has no
+// equivalent hint and is left alone.
+class Readahead {
+ public:
+  Readahead();
+  ~Readahead();
+
+  void queue(const std::filesystem::path &path);
+
+  // Hints the regions of one file. Blocks only on the few box headers read to find an MP4 index.
+  static void warm(const std::filesystem::path &path);
+
+ private:
+  static constexpr int64_t HeadBytes = 4 << 20;
+  static constexpr int64_t TailBytes = 8 << 20;
+  static constexpr int64_t MaxIndexBytes = 64 << 20;
+  static constexpr size_t MaxPending = 4;  // a whole folder queued at once is not worth warming
+
+  void run();
+
+  std::thread worker;
+  std::mutex lock;
+  std::condition_variable cond;
+  std::deque<std::filesystem::path> pending;
+  std::filesystem::path last;  // the next item is queued on every start, and usually again
+  bool quit = false;
+};
+}  // namespace ImPlay
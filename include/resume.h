@@ -0,0 +1,106 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "helpers/mapped_file.h"
+
+namespace ImPlay {
+// Playback state to resume from, keyed by media path or URL.
+//
+// Everything lives in one memory-mapped file: a header, an open-addressing table of record
+// offsets, then an append-only log of records. A checkpoint appends a record and repoints its
+// slot, so a lookup is one probe and neither opening nor closing reads the log. Superseded
+// records are dropped when the file is rewritten, which only happens once they outweigh the
+// live ones or the table fills up.
+class ResumeStore {
+ public:
+  struct State {
+    double position = 0;
+    double audioDelay = 0;
+    double subDelay = 0;
+    int64_t lastPlayed = 0;  // unix time
+    std::string aid, vid, sid;
+  };
+
+  ResumeStore() = default;
+  ~ResumeStore();
+
+  bool open(const std::filesystem::path &path);
+  std::optional<State> find(std::string_view key);
+
+  // Queued and written by the worker thread, the latest state of a key wins.
+  void checkpoint(const std::string &key, State state);
+  void remove(const std::string &key);
+  // Writes the queued changes on the calling thread.
+  void flush();
+
+  size_t size();
+
+ private:
+  static constexpr uint32_t Magic = 0x52525049;  // "IPRR"
+  static constexpr uint32_t Version = 1;
+  static constexpr uint32_t InitialSlots = 4096;
+  static constexpr uint64_t MinGarbage = 1 << 20;
+
+  enum Flags_ {
+    Flags_None = 0,
+    Flags_Removed = 1 << 0,
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotsUsed;  // including removed keys
+    uint64_t end;        // append offset
+    uint64_t garbage;    // bytes of superseded records
+  };
+
+  struct Record {
+    uint64_t hash;
+    uint32_t size;  // including the strings that follow
+    uint32_t flags;
+    double position;
+    double audioDelay;
+    double subDelay;
+    int64_t lastPlayed;
+    uint16_t keyLength;
+    uint16_t aidLength;
+    uint16_t vidLength;
+    uint16_t sidLength;
+  };
+
+  // call with fileLock held
+  Header header() const;
+  void setHeader(const Header &h);
+  uint64_t slot(uint32_t index) const;
+  void setSlot(uint32_t index, uint64_t offset);
+  std::optional<Record> record(uint64_t offset) const;
+  std::string_view recordKey(const Record &r, uint64_t offset) const;
+  int64_t probe(std::string_view key, uint64_t hash, uint32_t *free) const;
+  void write(const std::string &key, const std::optional<State> &state);
+  bool rebuild(uint32_t slotCount);
+  void drain();
+
+  void run();
+
+  std::filesystem::path path;
+  MappedFile file;
+  std::mutex fileLock;
+
+  std::thread worker;
+  std::mutex waitLock;
+  std::condition_variable cond;
+  std::map<std::string, std::optional<State>> pending;  // nullopt: remove
+  bool quit = false;
+};
+}  // namespace ImPlay
@@ -0,0 +1,64 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mpv.h"
+
+namespace ImPlay {
+// Expands folders into media files on a worker thread.
+//
+// Each directory is listed once and its files and subfolders are natural-sorted, so the
+// depth-first walk emits paths in a stable order without waiting for the whole tree.
+// Matches are streamed to mpv as `loadlist memory://` M3U batches; the first match is
+// sent on its own so playback starts as soon as it is found.
+class FolderScanner {
+ public:
+  using Filter = std::function<bool(const std::filesystem::path &)>;
+
+  FolderScanner(Mpv *mpv, Filter filter);
+  ~FolderScanner();
+
+  // Cancels any running scan before starting a new one.
+  void start(std::vector<std::filesystem::path> folders, bool append);
+  // Asks the worker to stop, returns immediately.
+  void cancel() { cancelled = true; }
+
+  bool running() const { return active; }
+  size_t filesFound() const { return files; }
+  size_t foldersScanned() const { return folders; }
+  std::string currentFolder() const;
+
+ private:
+  static constexpr size_t BatchSize = 512;
+  static constexpr std::chrono::milliseconds BatchInterval{250};
+
+  void run(std::vector<std::filesystem::path> roots);
+  void scan(const std::filesystem::path &dir);
+  void add(const std::filesystem::path &path);
+  void flush();
+
+  Mpv *mpv;
+  Filter filter;
+  std::thread worker;
+  std::atomic<bool> active = false;
+  std::atomic<bool> cancelled = false;
+  std::atomic<size_t> files = 0;
+  std::atomic<size_t> folders = 0;
+  mutable std::mutex mutex;
+  std::string current;
+
+  // worker state
+  bool append = false;
+  bool sent = false;
+  std::vector<std::string> batch;
+  std::chrono::steady_clock::time_point lastFlush;
+};
+}  // namespace ImPlay
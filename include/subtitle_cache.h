@@ -0,0 +1,126 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "mpv.h"
+
+namespace ImPlay {
+// Downloads external provider subtitles ahead of time so selecting one is a local sub-add.
+//
+// A few worker threads fetch the queued URLs in the order given, with curl run through mpv's
+// subprocess command. Downloads are stored by content, <fnv1a-64>-<size>, so the same file
+// served by several providers or URLs is kept once; index.tsv maps URLs to objects and makes
+// the cache survive restarts. Once objects and normalized copies exceed MaxCacheBytes, the least
+// recently used are removed and index.tsv is rewritten without them. Workers are only started
+// when there is something to fetch or normalize.
+//
+// Every text subtitle, downloaded or opened from disk, is also normalized once: converted to
+// UTF-8 and, for SRT, repaired (see SubtitleText::normalize). Picture formats are left alone. The
+// result is kept under the hash of its source and the codepage its name hints, so mpv never
+// redoes charset detection and opening the file again is a lookup.
+class SubtitleCache {
+ public:
+  enum class State { Unknown, Queued, Fetching, Ready, Failed };
+
+  struct Item {
+    std::string url;
+    std::string name;  // provider display name, its language picks the legacy codepage
+  };
+
+  // How one subtitle was prepared, for the debug view
+  struct Report {
+    std::string name;
+    std::string encoding;
+    int repairs = 0;
+    bool cached = false;  // normalized by an earlier run
+    double ms = 0;        // hashing and normalizing, without the download
+  };
+
+  explicit SubtitleCache(Mpv *mpv);
+  ~SubtitleCache();
+
+  bool open(const std::filesystem::path &dir);
+
+  // Replaces the download queue, first item first. Downloads already running are kept.
+  void prefetch(const std::vector<Item> &items);
+  State state(const std::string &url);
+  // Adds and selects the subtitle: the cached file when it is ready, right after the download
+  // when it is in flight, the URL itself otherwise.
+  void select(const std::string &url, const std::string &title);
+  // sub-add of a local file with the given flag ("select", "auto"), normalized on a worker first.
+  void addFile(const std::filesystem::path &path, const char *flag);
+
+  std::vector<Report> reports();
+
+  // Preferred language codes, from mpv's slang list followed by the interface language.
+  static std::vector<std::string> languages(std::string_view slang, std::string_view uiLang);
+  // Position of the first preferred language the subtitle name mentions, languages.size() if none.
+  static size_t rank(std::string_view name, const std::vector<std::string> &languages);
+
+ private:
+  static constexpr int MaxConnections = 4;
+  static constexpr uint64_t MaxFileSize = 16 << 20;
+  static constexpr uint64_t MaxCacheBytes = 64 << 20;
+  static constexpr size_t MaxReports = 64;
+
+  struct Entry {
+    State state = State::Unknown;
+    std::filesystem::path path;  // normalized file once ready
+    std::string object;          // file name under objects/, what index.tsv maps the URL to
+    int codepage = 0;            // hint path was normalized with
+    std::string name;
+    std::string title;  // selected once the download finishes
+    bool selectPending = false;
+  };
+
+  struct LocalFile {
+    std::filesystem::path path;
+    std::string flag;
+  };
+
+  // Call with lock held.
+  void startWorkers();
+  void run(int worker);
+  void fetch(const std::string &url, int worker);
+  // Moves a finished download to its object file, dropping it if the content is already cached.
+  std::filesystem::path store(const std::string &url, const std::filesystem::path &download, const std::string &data);
+  // Returns the file to give mpv for a subtitle, normalizing and caching it on first use. name
+  // is shown in the debug view and hints the language, the file name is used when empty.
+  std::filesystem::path prepare(const std::filesystem::path &source, const std::string &data, const std::string &name);
+  // The normalized copy under key, or its .clean marker when it needed no changes, empty if none.
+  std::filesystem::path normalized(const std::string &key, const std::string &ext);
+  void addLocal(const LocalFile &file);
+  // Drops least recently used files until the cache fits MaxCacheBytes.
+  void evict();
+  // Rewrites index.tsv from the ready entries. Call with lock held.
+  void writeIndex();
+  // sub-add with select, source is a local path or a URL
+  void add(const std::string &source, const std::string &title, const char *flag = "select");
+
+  Mpv *mpv = nullptr;
+  std::filesystem::path dir;
+  bool ready = false;
+
+  std::vector<std::thread> workers;
+  int running = 0;  // workers busy with an item
+  std::mutex lock;
+  std::condition_variable cond;
+  std::deque<std::string> queue;
+  std::deque<LocalFile> locals;  // user opened, go before prefetches
+  std::map<std::string, Entry> entries;
+  std::deque<Report> history;
+  uint64_t cachedBytes = 0;  // estimate, recounted by evict
+  std::atomic<bool> quit = false;
+  std::atomic<bool> noCurl = false;
+};
+}  // namespace ImPlay
@@ -2,10 +2,21 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <map>
 #include <string>
 #include <imgui.h>
+#include "disk_cache.h"
+#include "load_timings.h"
+#include "playlist_prefetch.h"
+#include "subtitle_cache.h"
 #include "view.h"
 
 namespace ImPlay::Views {
@@ -18,6 +29,45 @@ class Debug : public View {
   void show() override;
   void draw() override;
 
+  enum Timing_ {
+    Timing_Frame,   // UI frame, from NewFrame to swap
+    Timing_Video,   // mpv render on the video thread
+    Timing_Swap,    // SwapBuffers
+    Timing_Events,  // mpv event drain
+    Timing_COUNT,
+  };
+
+  void setSubtitleCache(SubtitleCache *cache) { subtitleCache = cache; }
+  void setLoadTimings(LoadTimings *timings) { loadTimings = timings; }
+  void setPlaylistPrefetch(PlaylistPrefetch *prefetch) { playlistPrefetch = prefetch; }
+  void setDiskCache(DiskCache *cache) { diskCache = cache; }
+  void toggleHud();
+  void addTiming(Timing_ timing, float ms);  // Timing_Video may be reported from the video thread
+
+  // Fixed-size sample history, plotted in place by ImGui::PlotLines
+  template <int N>
+  struct Ring {
+    std::array<float, N> values{};
+    int offset = 0;
+    int count = 0;
+
+    void push(float value) {
+      values[offset] = value;
+      offset = (offset + 1) % N;
+      if (count < N) count++;
+    }
+    void clear() { offset = count = 0; }
+    int start() const { return count < N ? 0 : offset; }
+    float last() const { return count > 0 ? values[(offset + N - 1) % N] : 0; }
+    void range(float &min, float &max) const {
+      min = max = last();
+      for (int i = 0; i < count; i++) {
+        min = std::min(min, values[i]);
+        max = std::max(max, values[i]);
+      }
+    }
+  };
+
  private:
   struct Console {
     explicit Console(Mpv *mpv);
@@ -57,19 +107,128 @@ class Debug : public View {
     int LogLimit = 500;
   };
 
+  struct Inspector {
+    explicit Inspector(Mpv *mpv);
+    ~Inspector();
+
+    void setActive(bool active);
+    void setRate(int hz);
+    void request(const std::vector<const std::string *> &names);
+
+    std::unique_lock<std::mutex> lock() { return std::unique_lock<std::mutex>(mutex); }
+    const mpv_node *find(const std::string &name) const;  // call with lock() held
+
+    bool pinned(const std::string &name) const;
+    void pin(const std::string &name);
+    void unpin(const std::string &name);
+    void drawWatch();
+
+    struct Series {
+      uint64_t id = 0;
+      std::string name;
+      std::string last;
+      Ring<240> samples;
+      int changes = 0;
+      float min = 0, max = 0;
+
+      void add(mpv_node &node);
+    };
+
+    Mpv *mpv;
+    std::list<Series> watches;
+
+   private:
+    void poll();
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<bool> active = false;
+    bool quit = false;
+    bool dirty = false;
+    int rate = 5;
+    std::vector<std::string> wanted;
+    std::map<std::string, mpv_node> snapshot;
+  };
+
+  // Lowercase index over a list of strings. Growing the query only re-scans the previous matches.
+  struct Search {
+    void reset(std::vector<std::string> texts);
+    void draw(const char *id, const char *label);
+    const std::vector<int> &results() const { return matches; }
+
+    char buf[256] = "";
+    bool fuzzy = false;
+
+   private:
+    void update();
+    int score(const std::string &text) const;
+
+    std::vector<std::string> index;
+    std::vector<int> matches;
+    std::vector<std::pair<int, int>> scored;
+    std::string query;
+    bool ranked = false;
+    bool stale = true;
+  };
+
+  struct Hud {
+    enum Stat_ {
+      Stat_FrameDrops,
+      Stat_DecoderDrops,
+      Stat_Delayed,
+      Stat_AvSync,
+      Stat_VfFps,
+      Stat_DisplayFps,
+      Stat_CacheSpeed,
+      Stat_COUNT,
+    };
+
+    explicit Hud(Mpv *mpv) : mpv(mpv) {}
+    ~Hud() { setVisible(false); }
+
+    void setVisible(bool visible);
+    void draw();
+
+    Mpv *mpv;
+    std::atomic<bool> visible = false;  // read by addTiming on the video thread
+    std::atomic<float> videoTime = -1;
+    Ring<300> timings[Timing_COUNT];
+    Ring<300> stats[Stat_COUNT];
+    double current[Stat_COUNT] = {};
+    std::string hwdec;
+    std::vector<uint64_t> observers;
+    double lastSample = 0;
+  };
+
   void drawHeader();
   void drawConsole();
   void drawBindings();
   void drawCommands();
-  void drawProperties(const char *title, std::vector<std::string> &props);
+  void drawSubtitles();
+  void drawLoadTimings();
+  void drawPrefetch();
+  void drawDiskCache();
+  void drawWatch();
+  void drawProperties(const char *title, std::vector<std::string> &props, Search &search);
   void drawPropNode(const char *name, mpv_node &node, int depth = 0);
+  void drawPropValue(const char *name, mpv_node &node, int depth);
 
   void initData();
 
   Console *console = nullptr;
+  Inspector *inspector = nullptr;
+  Hud *hud = nullptr;
+  SubtitleCache *subtitleCache = nullptr;
+  LoadTimings *loadTimings = nullptr;
+  PlaylistPrefetch *playlistPrefetch = nullptr;
+  DiskCache *diskCache = nullptr;
+  Search optionsSearch, propertiesSearch, commandsSearch, bindingsSearch;
+  uint64_t bindingsVersion = 0;
+  std::vector<const std::string *> visibleProps;
   std::string version;
   std::string m_node = "Console";
-  bool m_demo = false, m_metrics = false;
+  bool m_demo = false, m_metrics = false, m_polling = false;
 
   std::vector<std::string> options;
   std::vector<std::string> properties;
@@ -5,6 +5,10 @@
 #include <map>
 #include <string>
 #include <vector>
+#include "cache_controller.h"
+#include "library.h"
+#include "scanner.h"
+#include "subtitle_cache.h"
 #include "view.h"
 
 namespace ImPlay::Views {
@@ -37,11 +41,23 @@ class PlayerOverlay : public View {
   // Draw idle screen when no media is playing
   void drawIdleScreen();
 
+  // Folder scan progress toast, shown in both playing and idle states
+  void setScanner(FolderScanner *scanner) { m_scanner = scanner; }
+  void drawScanProgress();
+
+  // Media library search box on the idle screen
+  void setLibrary(MediaLibrary *library) { m_library = library; }
+
   // Add external subtitle providers from command line
   void setExternalProviders(const std::vector<SubtitleProvider>& providers) {
     m_externalProviders = providers;
   }
   void clearExternalProviders() { m_externalProviders.clear(); }
+  // Demuxer cache sizing shown and configured in the settings menu
+  void setCacheController(CacheController *cache) { m_cache = cache; }
+
+  // Selects provider subtitles through the prefetch cache instead of a blocking sub-add
+  void setSubtitleCache(SubtitleCache *cache) { m_subtitleCache = cache; }
 
  private:
   void drawTopBar();
@@ -51,6 +67,7 @@ class PlayerOverlay : public View {
   void drawSubtitleMenu();
   void drawAudioMenu();
   void drawSettingsMenu();
+  void drawLibrarySearch(float y);
 
   void openSubtitleFile();
   void openMediaFile();
@@ -71,9 +88,19 @@ class PlayerOverlay : public View {
   bool m_seeking = false;
   float m_seekPos = 0.0f;
 
+  FolderScanner *m_scanner = nullptr;
+
+  // Library search state, results are refreshed only when the query changes
+  MediaLibrary *m_library = nullptr;
+  char m_libraryQuery[256] = {0};
+  std::string m_lastLibraryQuery;
+  std::vector<MediaLibrary::Item> m_libraryResults;
+
   // External subtitle providers
   std::vector<SubtitleProvider> m_externalProviders;
   int m_selectedProviderTab = 0;  // 0 = Built-in, 1+ = external providers
+  SubtitleCache *m_subtitleCache = nullptr;
+  CacheController *m_cache = nullptr;
 
   // Colors matching PlayTorrio design
   ImVec4 m_primaryPurple = ImVec4(0.616f, 0.306f, 0.867f, 1.0f);   // #9d4edd
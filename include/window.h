@@ -22,7 +22,7 @@ class Window : Player {
   explicit Window(Config *config);
   ~Window();
 
-  bool init(OptionParser &parser);
+  bool init(OptionParser &parser, bool daemon = false);
   void run();
 
  private:
@@ -65,8 +65,11 @@ class Window : Player {
   void SetWindowFloating(bool f) override;
   void SetWindowFullscreen(bool fs) override;
   void SetWindowShouldClose(bool c) override;
+  void RaiseWindow() override;
+  void HideWindow() override;
 
   GLFWwindow *window = nullptr;
+  bool guiReady = false;
   bool ownCursor = true;
   double lastInputAt = 0;
 #ifdef _WIN32
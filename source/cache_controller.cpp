@@ -0,0 +1,163 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fmt/format.h>
+#include "cache_controller.h"
+
+namespace ImPlay {
+CacheController::CacheController(Config *config, Mpv *mpv) : config(config), mpv(mpv) {}
+
+void CacheController::init() {
+  mpv->observeEvent(MPV_EVENT_FILE_LOADED, [this](void *) { fileLoaded(); });
+  mpv->observeEvent(MPV_EVENT_END_FILE, [this](void *) { current.policy = Policy::None; });
+  mpv->observeProperty<mpv_node, MPV_FORMAT_NODE>("demuxer-cache-state", [this](mpv_node node) { sample(node); });
+  mpv->observeProperty<int64_t, MPV_FORMAT_INT64>("cache-speed", [this](int64_t value) { speed = (double)value; });
+  mpv->observeProperty<int, MPV_FORMAT_FLAG>("paused-for-cache", [this](int flag) {
+    if (flag && !buffering) rebuffered();
+    buffering = flag;
+  });
+  // before the first decision changes them, mpv's defaults stay if one cannot be read
+  if (auto bytes = mpv->property<int64_t, MPV_FORMAT_INT64>("demuxer-max-back-bytes"); bytes > 0)
+    initial.backBytes = bytes;
+  initial.readaheadSecs = mpv->property<double, MPV_FORMAT_DOUBLE>("demuxer-readahead-secs");
+  if (auto secs = mpv->property<double, MPV_FORMAT_DOUBLE>("cache-secs"); secs > 0) initial.cacheSecs = secs;
+  configure();
+}
+
+void CacheController::configure() {
+  auto &cache = config->Data.Cache;
+  if (!cache.Adaptive) {
+    // undo whatever the last adaptive decision set
+    mpv->property<int64_t, MPV_FORMAT_INT64>("demuxer-max-back-bytes", initial.backBytes);
+    mpv->property<double, MPV_FORMAT_DOUBLE>("demuxer-readahead-secs", initial.readaheadSecs);
+    mpv->property<double, MPV_FORMAT_DOUBLE>("cache-secs", initial.cacheSecs);
+    apply(cache.Size * MiB, 0, "fixed");
+    return;
+  }
+  mpv->commandv("set", "demuxer-max-back-bytes", fmt::format("{}", backBytes()).c_str(), nullptr);
+  decide("configure", true);
+}
+
+const char *CacheController::policyName(Policy policy) {
+  switch (policy) {
+    case Policy::Local:
+      return "local";
+    case Policy::Hls:
+      return "hls";
+    case Policy::Http:
+      return "http";
+    default:
+      return "none";
+  }
+}
+
+int64_t CacheController::backBytes() const {
+  return std::min(MaxBackBytes, (int64_t)config->Data.Cache.MaxMemory * MiB / 4);
+}
+
+void CacheController::fileLoaded() {
+  auto path = mpv->property("path");
+  auto url = path.substr(0, path.find_first_of("?#"));
+  std::transform(url.begin(), url.end(), url.begin(), [](unsigned char c) { return std::tolower(c); });
+
+  if (url.find("://") == std::string::npos || url.starts_with("file://"))
+    current.policy = Policy::Local;
+  else if (url.ends_with(".m3u8") || mpv->property("file-format") == "hls")
+    current.policy = Policy::Hls;
+  else
+    current.policy = Policy::Http;
+
+  current.throughput = current.bitrate = 0;
+  current.rebuffers = 0;
+  boost = 1;
+  decide("file-loaded", true);
+}
+
+void CacheController::sample(mpv_node &state) {
+  if (state.format != MPV_FORMAT_NODE_MAP || current.policy == Policy::None) return;
+  double duration = 0;
+  int64_t fwBytes = 0;
+  bool idle = false;
+  for (int i = 0; i < state.u.list->num; i++) {
+    auto key = state.u.list->keys[i];
+    auto &value = state.u.list->values[i];
+    if (strcmp(key, "cache-duration") == 0 && value.format == MPV_FORMAT_DOUBLE) duration = value.u.double_;
+    if (strcmp(key, "fw-bytes") == 0 && value.format == MPV_FORMAT_INT64) fwBytes = value.u.int64;
+    if (strcmp(key, "idle") == 0 && value.format == MPV_FORMAT_FLAG) idle = value.u.flag;
+  }
+
+  auto ewma = [](double &avg, double value) { avg = avg > 0 ? avg * 0.7 + value * 0.3 : value; };
+  // a couple of seconds of forward data are needed for a meaningful bitrate
+  if (duration >= 2 && fwBytes > 0) ewma(current.bitrate, fwBytes / duration);
+  // a full cache stops reading, its speed says nothing about the link then
+  if (!idle && speed > 0) ewma(current.throughput, speed);
+  decide("sample", false);
+}
+
+void CacheController::rebuffered() {
+  current.rebuffers++;
+  if (current.policy != Policy::Http && current.policy != Policy::Hls) return;
+  boost = std::min(boost * 2, 8.0);
+  decide("rebuffer", true);
+}
+
+void CacheController::decide(const char *reason, bool force) {
+  if (!config->Data.Cache.Adaptive || current.policy == Policy::None) return;
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - lastDecision < std::chrono::seconds(5)) return;
+  lastDecision = now;
+
+  double bitrate = current.bitrate;
+  double ratio = bitrate > 0 && current.throughput > 0 ? current.throughput / bitrate : 1;
+  double secs;
+  int64_t bytes;
+  switch (current.policy) {
+    case Policy::Local:
+      // the disk outruns any bitrate, only decoding jitter needs covering
+      secs = 2;
+      bytes = std::max(32 * MiB, (int64_t)(bitrate * 10));
+      break;
+    case Policy::Hls:
+      secs = (ratio >= 3 ? 20 : ratio >= 1.5 ? 40 : 120) * boost;
+      bytes = bitrate > 0 ? (int64_t)(bitrate * secs * 1.25) : 48 * MiB;
+      break;
+    default:
+      secs = (ratio >= 3 ? 30 : ratio >= 1.5 ? 60 : ratio >= 1 ? 180 : 600) * boost;
+      bytes = bitrate > 0 ? (int64_t)(bitrate * secs * 1.25) : 64 * MiB;
+      break;
+  }
+
+  int64_t ceiling = std::max(MinBytes, (int64_t)config->Data.Cache.MaxMemory * MiB - backBytes());
+  bytes = std::clamp(bytes, MinBytes, ceiling);
+  bytes = (bytes + MiB - 1) / MiB * MiB;
+  double readahead = bitrate > 0 ? std::min(secs, bytes / bitrate) : secs;
+
+  // small corrections are not worth a demuxer reconfiguration
+  auto near = [](double a, double b) { return b > 0 && std::abs(a - b) <= b / 4; };
+  if (!force && near((double)bytes, (double)current.maxBytes) && near(readahead, current.readahead)) return;
+  apply(bytes, readahead, reason);
+}
+
+void CacheController::apply(int64_t bytes, double readahead, const char *reason) {
+  current.maxBytes = bytes;
+  mpv->commandv("set", "demuxer-max-bytes", fmt::format("{}", bytes).c_str(), nullptr);
+  if (readahead > 0) {
+    current.readahead = readahead;
+    auto secs = fmt::format("{:.0f}", std::ceil(readahead));
+    mpv->commandv("set", "demuxer-readahead-secs", secs.c_str(), nullptr);
+    // with the network cache enabled mpv reads ahead by cache-secs instead
+    if (current.policy == Policy::Http || current.policy == Policy::Hls)
+      mpv->commandv("set", "cache-secs", secs.c_str(), nullptr);
+  }
+
+  if (!config->Data.Cache.Log) return;
+  auto msg = fmt::format(
+      "cache: {} {} bitrate={:.0f}KiB/s throughput={:.0f}KiB/s rebuffers={} boost={} -> {}MiB {:.0f}s",
+      reason, policyName(current.policy), current.bitrate / 1024, current.throughput / 1024,
+      current.rebuffers, boost, bytes / MiB, readahead);
+  mpv->commandv("print-text", msg.c_str(), nullptr);
+}
+}  // namespace ImPlay
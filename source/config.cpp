@@ -35,6 +35,9 @@ void Config::load() {
   inipp::get_value(ini.sections["mpv"], "config", Data.Mpv.UseConfig);
   inipp::get_value(ini.sections["mpv"], "wid", Data.Mpv.UseWid);
   inipp::get_value(ini.sections["mpv"], "watch-later", Data.Mpv.WatchLater);
+  inipp::get_value(ini.sections["mpv"], "sniff-media", Data.Mpv.SniffMedia);
+  inipp::get_value(ini.sections["mpv"], "follow-growing", Data.Mpv.FollowGrowing);
+  inipp::get_value(ini.sections["mpv"], "readahead", Data.Mpv.Readahead);
   inipp::get_value(ini.sections["mpv"], "volume", Data.Mpv.Volume);
   inipp::get_value(ini.sections["window"], "save", Data.Window.Save);
   inipp::get_value(ini.sections["window"], "single", Data.Window.Single);
@@ -44,8 +47,20 @@ void Config::load() {
   inipp::get_value(ini.sections["window"], "h", Data.Window.H);
   inipp::get_value(ini.sections["debug"], "log-level", Data.Debug.LogLevel);
   inipp::get_value(ini.sections["debug"], "log-limit", Data.Debug.LogLimit);
+  inipp::get_value(ini.sections["debug"], "poll-rate", Data.Debug.PollRate);
   inipp::get_value(ini.sections["recent"], "limit", Data.Recent.Limit);
   inipp::get_value(ini.sections["recent"], "space-to-play-last", Data.Recent.SpaceToPlayLast);
+  inipp::get_value(ini.sections["daemon"], "idle-timeout", Data.Daemon.IdleTimeout);
+  inipp::get_value(ini.sections["daemon"], "trim-delay", Data.Daemon.TrimDelay);
+  inipp::get_value(ini.sections["cache"], "adaptive", Data.Cache.Adaptive);
+  inipp::get_value(ini.sections["cache"], "max-memory", Data.Cache.MaxMemory);
+  inipp::get_value(ini.sections["cache"], "size", Data.Cache.Size);
+  inipp::get_value(ini.sections["cache"], "log", Data.Cache.Log);
+  inipp::get_value(ini.sections["cache"], "disk", Data.Cache.Disk);
+  inipp::get_value(ini.sections["cache"], "disk-size", Data.Cache.DiskSize);
+  inipp::get_value(ini.sections["prefetch"], "enabled", Data.Prefetch.Enabled);
+  inipp::get_value(ini.sections["prefetch"], "lead", Data.Prefetch.Lead);
+  inipp::get_value(ini.sections["prefetch"], "share", Data.Prefetch.Share);
 
   for (auto& [key, value] : ini.sections["recent"]) {
     if (key.find("file-") != 0 || value == "") continue;
@@ -53,6 +68,11 @@ void Config::load() {
     recentFiles.push_back({parts.front(), parts.back()});
   }
 
+  for (auto& [key, value] : ini.sections["library"]) {
+    if (key.find("folder-") != 0 || value == "") continue;
+    Data.Library.Folders.push_back(value);
+  }
+
   getLang() = Data.Interface.Lang;
 
   ini.clear();
@@ -75,6 +95,9 @@ void Config::save() {
   ini.sections["mpv"]["config"] = fmt::format("{}", Data.Mpv.UseConfig);
   ini.sections["mpv"]["wid"] = fmt::format("{}", Data.Mpv.UseWid);
   ini.sections["mpv"]["watch-later"] = fmt::format("{}", Data.Mpv.WatchLater);
+  ini.sections["mpv"]["sniff-media"] = fmt::format("{}", Data.Mpv.SniffMedia);
+  ini.sections["mpv"]["follow-growing"] = fmt::format("{}", Data.Mpv.FollowGrowing);
+  ini.sections["mpv"]["readahead"] = fmt::format("{}", Data.Mpv.Readahead);
   ini.sections["mpv"]["volume"] = std::to_string(Data.Mpv.Volume);
   ini.sections["window"]["save"] = fmt::format("{}", Data.Window.Save);
   ini.sections["window"]["single"] = fmt::format("{}", Data.Window.Single);
@@ -84,8 +107,20 @@ void Config::save() {
   ini.sections["window"]["h"] = std::to_string(Data.Window.H);
   ini.sections["debug"]["log-level"] = Data.Debug.LogLevel;
   ini.sections["debug"]["log-limit"] = std::to_string(Data.Debug.LogLimit);
+  ini.sections["debug"]["poll-rate"] = std::to_string(Data.Debug.PollRate);
   ini.sections["recent"]["limit"] = std::to_string(Data.Recent.Limit);
   ini.sections["recent"]["space-to-play-last"] = fmt::format("{}", Data.Recent.SpaceToPlayLast);
+  ini.sections["daemon"]["idle-timeout"] = std::to_string(Data.Daemon.IdleTimeout);
+  ini.sections["daemon"]["trim-delay"] = std::to_string(Data.Daemon.TrimDelay);
+  ini.sections["cache"]["adaptive"] = fmt::format("{}", Data.Cache.Adaptive);
+  ini.sections["cache"]["max-memory"] = std::to_string(Data.Cache.MaxMemory);
+  ini.sections["cache"]["size"] = std::to_string(Data.Cache.Size);
+  ini.sections["cache"]["log"] = fmt::format("{}", Data.Cache.Log);
+  ini.sections["cache"]["disk"] = fmt::format("{}", Data.Cache.Disk);
+  ini.sections["cache"]["disk-size"] = std::to_string(Data.Cache.DiskSize);
+  ini.sections["prefetch"]["enabled"] = fmt::format("{}", Data.Prefetch.Enabled);
+  ini.sections["prefetch"]["lead"] = std::to_string(Data.Prefetch.Lead);
+  ini.sections["prefetch"]["share"] = std::to_string(Data.Prefetch.Share);
 
   int index = 0;
   for (auto& file : recentFiles) {
@@ -93,6 +128,9 @@ void Config::save() {
         file.path == file.title ? file.path : fmt::format("{}|{}", file.path, file.title);
   }
 
+  index = 0;
+  for (auto& folder : Data.Library.Folders) ini.sections["library"][fmt::format("folder-{}", index++)] = folder;
+
   std::ofstream file(configFile);
   ini.generate(file);
 }
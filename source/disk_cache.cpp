@@ -0,0 +1,620 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <sstream>
+#include <string_view>
+#include <fmt/format.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char **environ;
+#endif
+#include "helpers/utils.h"
+#include "disk_cache.h"
+
+namespace ImPlay {
+static constexpr uint64_t fnv1a(std::string_view str) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (char c : str) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// A curl config file value, quoted so that spaces, quotes and backslashes survive.
+static std::string configValue(std::string_view value) {
+  std::string out = "\"";
+  for (char c : value) {
+    if (c == '\n' || c == '\r') continue;
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + '"';
+}
+
+#ifndef _WIN32
+// Writes all of data to a pipe, false if the reader went away. SIGPIPE is held back for the
+// write, a curl that exits early must not take the player with it.
+static bool writePipe(int fd, const std::string &data) {
+  sigset_t pipeSet, old;
+  sigemptyset(&pipeSet);
+  sigaddset(&pipeSet, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipeSet, &old);
+  bool ok = true;
+  for (size_t done = 0; ok && done < data.size();) {
+    auto n = ::write(fd, data.data() + done, data.size() - done);
+    if (n > 0)
+      done += n;
+    else
+      ok = n < 0 && errno == EINTR;
+  }
+  sigset_t pending;
+  if (sigpending(&pending) == 0 && sigismember(&pending, SIGPIPE) && !sigismember(&old, SIGPIPE)) {
+    int sig;
+    sigwait(&pipeSet, &sig);
+  }
+  pthread_sigmask(SIG_SETMASK, &old, nullptr);
+  return ok;
+}
+
+// A close-on-exec pipe. Created that way atomically where pipe2 exists, so a child spawned by
+// another thread meanwhile cannot inherit an end and keep the pipe open.
+static bool openPipe(int fds[2]) {
+#ifdef __APPLE__
+  if (pipe(fds) != 0) return false;
+  for (int i = 0; i < 2; i++) fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+  return true;
+#else
+  return pipe2(fds, O_CLOEXEC) == 0;
+#endif
+}
+
+// Starts curl with input on stdin and stdout on a pipe, returns its pid or -1.
+static int spawnCurl(const std::vector<std::string> &args, const std::string &input, int &out) {
+  int fds[2], in[2];
+  if (!openPipe(fds)) return -1;
+  if (!openPipe(in)) {
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return -1;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+#ifdef POSIX_SPAWN_CLOEXEC_DEFAULT
+  // without pipe2, at least keep curl from inheriting what other threads have open
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_CLOEXEC_DEFAULT);
+#endif
+  std::vector<char *> argv = {const_cast<char *>("curl")};
+  for (auto &arg : args) argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+  pid_t pid;
+  int err = posix_spawnp(&pid, "curl", &actions, &attr, argv.data(), environ);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  ::close(fds[1]);
+  ::close(in[0]);
+  if (err != 0) {
+    ::close(fds[0]);
+    ::close(in[1]);
+    return -1;
+  }
+  // curl reads all of its config before it writes anything, so this cannot deadlock
+  writePipe(in[1], input);
+  ::close(in[1]);
+  out = fds[0];
+  return pid;
+}
+
+static int64_t readPipe(int fd, char *buf, int64_t n) {
+  ssize_t got;
+  do got = ::read(fd, buf, n);
+  while (got < 0 && errno == EINTR);
+  return got;
+}
+
+// Runs curl to completion, returns its exit status with stdout in output, -1 if it did not run.
+static int runCurl(const std::vector<std::string> &args, const std::string &input, std::string &output) {
+  int fd;
+  int pid = spawnCurl(args, input, fd);
+  if (pid < 0) return -1;
+  char buf[4096];
+  for (int64_t n; (n = readPipe(fd, buf, sizeof(buf))) > 0;) output.append(buf, n);
+  ::close(fd);
+  int status;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+#endif
+
+// The response to a one byte range request: whether the server does ranges, the total size
+// and what identifies this version of the resource.
+struct Probe {
+  int status = 0;
+  int64_t size = -1;
+  bool ranged = false;
+  std::string validator;
+};
+
+static bool probe(const std::string &url, const std::string &config, int timeout, Probe &result) {
+#ifdef _WIN32
+  return false;
+#else
+  // --max-filesize stops a server that ignores the range before it sends the whole body
+  std::vector<std::string> args = {"-sS", "-L", "--max-time", std::to_string(timeout), "-r", "0-0", "--max-filesize",
+                                   "1", "-o", "/dev/null", "-D", "-", "-K", "-"};
+  std::string output;
+  if (runCurl(args, fmt::format("{}url = {}\n", config, configValue(url)), output) < 0) return false;
+
+  std::string etag, modified, length, range;
+  std::istringstream lines(output);
+  for (std::string line; std::getline(lines, line);) {
+    line = trim(line);
+    if (line.starts_with("HTTP/")) {  // a new response, after a redirect
+      auto space = line.find(' ');
+      result.status = space != std::string::npos ? std::atoi(line.c_str() + space + 1) : 0;
+      etag.clear(), modified.clear(), length.clear(), range.clear();
+      continue;
+    }
+    auto colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    auto name = tolower(line.substr(0, colon));
+    auto value = trim(line.substr(colon + 1));
+    if (name == "etag")
+      etag = value;
+    else if (name == "last-modified")
+      modified = value;
+    else if (name == "content-length")
+      length = value;
+    else if (name == "content-range")
+      range = value;
+  }
+
+  if (result.status == 206) {
+    result.ranged = true;
+    if (auto slash = range.rfind('/'); slash != std::string::npos && range[slash + 1] != '*')
+      result.size = std::atoll(range.c_str() + slash + 1);
+  } else if (result.status == 200 && !length.empty()) {
+    result.size = std::atoll(length.c_str());
+  }
+  auto validator = !etag.empty() ? etag : modified;
+  if (!validator.empty() && result.size > 0) result.validator = fmt::format("{} {}", validator, result.size);
+  return result.status == 200 || result.status == 206;
+#endif
+}
+
+int64_t DiskCache::Entry::cachedAt(int64_t pos) {
+  std::lock_guard<std::mutex> l(lock);
+  auto it = ranges.upper_bound(pos);
+  if (it == ranges.begin()) return 0;
+  --it;
+  return it->second > pos ? it->second - pos : 0;
+}
+
+int64_t DiskCache::Entry::nextCached(int64_t pos) {
+  std::lock_guard<std::mutex> l(lock);
+  auto it = ranges.upper_bound(pos);
+  return it != ranges.end() ? it->first : size;
+}
+
+int64_t DiskCache::Entry::fetch(int64_t pos, char *buf, int64_t n) {
+  std::lock_guard<std::mutex> l(lock);
+  file.clear();
+  file.seekg(pos);
+  file.read(buf, n);
+  return file.gcount();
+}
+
+void DiskCache::Entry::store(int64_t pos, const char *buf, int64_t n) {
+  std::lock_guard<std::mutex> l(lock);
+  file.clear();
+  file.seekp(pos);
+  if (!file.write(buf, n)) return;
+
+  int64_t start = pos, end = pos + n;
+  auto it = ranges.upper_bound(start);
+  if (it != ranges.begin() && std::prev(it)->second >= start) {
+    --it;
+    start = it->first;
+    end = std::max(end, it->second);
+    it = ranges.erase(it);
+  }
+  while (it != ranges.end() && it->first <= end) {
+    end = std::max(end, it->second);
+    it = ranges.erase(it);
+  }
+  ranges[start] = end;
+  unsaved += n;
+  if (unsaved >= SaveBytes) write();
+}
+
+int64_t DiskCache::Entry::bytes() {
+  std::lock_guard<std::mutex> l(lock);
+  int64_t total = 0;
+  for (auto &[start, end] : ranges) total += end - start;
+  return total;
+}
+
+// <url>, <validator>, <size>, <last used> and one "<start> <end>" line per cached range
+bool DiskCache::Entry::load(const std::filesystem::path &path) {
+  std::ifstream in(path);
+  std::string sizeLine, usedLine;
+  if (!std::getline(in, url) || !std::getline(in, validator) || !std::getline(in, sizeLine) ||
+      !std::getline(in, usedLine))
+    return false;
+  size = std::atoll(sizeLine.c_str());
+  used = std::atoll(usedLine.c_str());
+  for (int64_t start, end; in >> start >> end;)
+    if (start >= 0 && start < end && end <= size) ranges[start] = end;
+  return size > 0;
+}
+
+void DiskCache::Entry::save() {
+  std::lock_guard<std::mutex> l(lock);
+  write();
+}
+
+void DiskCache::Entry::write() {
+  file.flush();  // the ranges must not claim bytes still in the stream buffer
+  auto tmp = meta;
+  tmp += ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    out << url << '\n' << validator << '\n' << size << '\n' << used << '\n';
+    for (auto &[start, end] : ranges) out << start << ' ' << end << '\n';
+    if (!out) return;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, meta, ec);
+  unsaved = 0;
+}
+
+bool DiskCache::Fetch::start(const Request &request, int64_t from) {
+#ifdef _WIN32
+  return false;
+#else
+  auto config = fmt::format("{}url = {}\n", request.config, configValue(request.url));
+  if (from > 0) config += fmt::format("range = \"{}-\"\n", from);
+  pid = spawnCurl({"-sS", "-L", "--fail", "-K", "-"}, config, fd);
+  pos = from;
+  return pid > 0;
+#endif
+}
+
+void DiskCache::Fetch::stop() {
+#ifndef _WIN32
+  if (pid <= 0) return;
+  kill(pid, SIGKILL);
+  ::close(fd);
+  while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+  }
+  pid = fd = -1;
+#endif
+}
+
+bool DiskCache::Reader::seekFetch() {
+#ifdef _WIN32
+  return false;
+#else
+  {
+    std::lock_guard<std::mutex> l(fetchLock);
+    if (cancelled) return false;
+    if (fetch.pid > 0 && fetch.pos == pos) return true;
+    if (fetch.pid <= 0 || fetch.pos > pos || pos - fetch.pos > SkipBytes) {
+      fetch.stop();
+      // a server without ranges can only be read from the start
+      if (!fetch.start(request, ranged ? pos : 0)) return false;
+    }
+  }
+
+  char buf[64 * 1024];
+  while (fetch.pos < pos) {
+    auto n = readPipe(fetch.fd, buf, std::min<int64_t>(sizeof(buf), pos - fetch.pos));
+    if (n <= 0) return false;
+    if (entry) entry->store(fetch.pos, buf, n);
+    owner->missBytes += n;
+    fetch.pos += n;
+  }
+  return true;
+#endif
+}
+
+DiskCache::DiskCache(Config *config, Mpv *mpv) : config(config), mpv(mpv) {}
+
+bool DiskCache::open(const std::filesystem::path &dir_) {
+#ifdef _WIN32
+  return false;
+#else
+  dir = dir_;
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec) {
+    fmt::print(fg(fmt::color::red), "Failed to create stream cache: {}\n", dir.string());
+    return false;
+  }
+  std::string version;
+  if (runCurl({"--version"}, "", version) != 0) return false;
+
+  std::lock_guard<std::mutex> l(lock);
+  for (auto &file : std::filesystem::directory_iterator(dir, ec)) {
+    auto path = file.path();
+    if (path.extension() != ".meta") continue;
+    Entry entry;
+    if (!entry.load(path)) {
+      std::filesystem::remove(path, ec);
+      continue;
+    }
+    index[path.stem().string()] = {entry.bytes(), entry.used};
+  }
+  evict();
+  ready = true;
+  return true;
+#endif
+}
+
+void DiskCache::init() {
+  if (!ready) return;
+  mpv->addProtocol(Protocol, this, &DiskCache::openStream);
+  mpv->observeHook("on_load", 60, [this]() {
+    if (!config->Data.Cache.Disk) return;
+    auto url = mpv->property("stream-open-filename");
+    if (!accepts(url)) return;
+    {
+      std::lock_guard<std::mutex> l(lock);
+      if (pending.size() > 16) pending.clear();  // items that never got to open
+      pending[url] = {mpv->property("path"), requestConfig()};
+    }
+    mpv->property("stream-open-filename", fmt::format("{}://{}", Protocol, url).c_str());
+    // mpv enables its demuxer cache by itself only for its own network streams
+    mpv->commandv("set", "file-local-options/cache", "yes", nullptr);
+  });
+}
+
+bool DiskCache::accepts(const std::string &url) const {
+  if (!ready) return false;
+  auto lower = tolower(url.substr(0, url.find_first_of("?#")));
+  if (!lower.starts_with("http://") && !lower.starts_with("https://")) return false;
+  // manifests are opened by name by the demuxer, which cannot resolve segments against our URL
+  for (auto ext : {".m3u8", ".m3u", ".mpd", ".pls"})
+    if (lower.ends_with(ext)) return false;
+  return true;
+}
+
+std::string DiskCache::requestConfig() {
+  std::string config;
+  auto add = [&](const char *name, const std::string &value) {
+    config += fmt::format("{} = {}\n", name, configValue(value));
+  };
+  if (auto agent = mpv->property("user-agent"); !agent.empty()) add("header", "User-Agent: " + agent);
+  if (auto referrer = mpv->property("referrer"); !referrer.empty()) add("header", "Referer: " + referrer);
+  auto node = mpv->property<mpv_node, MPV_FORMAT_NODE>("http-header-fields");
+  if (node.format == MPV_FORMAT_NODE_ARRAY)
+    for (int i = 0; i < node.u.list->num; i++)
+      if (node.u.list->values[i].format == MPV_FORMAT_STRING) add("header", node.u.list->values[i].u.string);
+  mpv_free_node_contents(&node);
+
+  // the network options mpv's own HTTP stack honours, with its defaults
+  if (mpv->property("cookies") == "yes") add("cookie", mpv->property("cookies-file"));  // "" only enables the engine
+  if (mpv->property("tls-verify") != "yes") config += "insecure\n";
+  if (auto ca = mpv->property("tls-ca-file"); !ca.empty()) add("cacert", ca);
+  if (auto proxy = mpv->property("http-proxy"); !proxy.empty()) add("proxy", proxy);
+  if (auto timeout = (int)mpv->property<double, MPV_FORMAT_DOUBLE>("network-timeout"); timeout > 0) {
+    // mpv times out a connection that stops transferring, not a slow one
+    config += fmt::format("connect-timeout = {}\nspeed-limit = 1\nspeed-time = {}\n", timeout, timeout);
+  }
+  return config;
+}
+
+std::filesystem::path DiskCache::pathOf(const std::string &key, const char *ext) const { return dir / (key + ext); }
+
+std::shared_ptr<DiskCache::Entry> DiskCache::acquire(const std::string &path, const std::string &validator,
+                                                     int64_t size) {
+  // an item larger than the whole budget would only evict everything else, then itself
+  if (size > (int64_t)config->Data.Cache.DiskSize * 1024 * 1024) return nullptr;
+  auto key = fmt::format("{:016x}", fnv1a(path));
+  std::lock_guard<std::mutex> l(lock);
+  if (auto it = live.find(key); it != live.end()) {
+    auto &entry = it->second;
+    if (entry->url != path || entry->validator != validator) return nullptr;
+    entry->users++;
+    return entry;
+  }
+
+  auto entry = std::make_shared<Entry>();
+  bool valid = entry->load(pathOf(key, ".meta")) && entry->url == path && entry->validator == validator;
+  std::error_code ec;
+  if (!valid) {
+    // a different resource or version, its bytes are of no use
+    entry->ranges.clear();
+    entry->url = path;
+    entry->validator = validator;
+    std::filesystem::remove(pathOf(key, ".data"), ec);
+  }
+  entry->key = key;
+  entry->meta = pathOf(key, ".meta");
+  entry->size = size;
+  entry->used = std::time(nullptr);
+  auto data = pathOf(key, ".data");
+  if (!std::filesystem::exists(data, ec)) std::ofstream(data, std::ios::binary);
+  entry->file.open(data, std::ios::binary | std::ios::in | std::ios::out);
+  if (!entry->file) return nullptr;
+
+  if (valid && !entry->ranges.empty()) reused++;
+  entry->users = 1;
+  entry->save();
+  live[key] = entry;
+  index[key] = {entry->bytes(), entry->used};
+  return entry;
+}
+
+void DiskCache::release(const std::shared_ptr<Entry> &entry) {
+  std::lock_guard<std::mutex> l(lock);
+  if (--entry->users > 0) return;
+  entry->used = std::time(nullptr);
+  entry->save();
+  index[entry->key] = {entry->bytes(), entry->used};
+  live.erase(entry->key);
+  evict();
+}
+
+void DiskCache::evict() {
+  int64_t budget = (int64_t)config->Data.Cache.DiskSize * 1024 * 1024, total = 0;
+  for (auto &[key, indexed] : index) total += indexed.bytes;
+  if (total <= budget) return;
+
+  std::vector<std::pair<std::time_t, std::string>> order;
+  for (auto &[key, indexed] : index)
+    if (!live.contains(key)) order.emplace_back(indexed.used, key);
+  std::sort(order.begin(), order.end());
+  std::error_code ec;
+  for (auto &[used, key] : order) {
+    if (total <= budget) break;
+    total -= index[key].bytes;
+    index.erase(key);
+    std::filesystem::remove(pathOf(key, ".meta"), ec);
+    std::filesystem::remove(pathOf(key, ".data"), ec);
+  }
+}
+
+DiskCache::Stats DiskCache::stats() {
+  Stats stats;
+  stats.opens = opens;
+  stats.reused = reused;
+  stats.hitBytes = hitBytes;
+  stats.missBytes = missBytes;
+  std::lock_guard<std::mutex> l(lock);
+  for (auto &[key, indexed] : index) {
+    auto it = live.find(key);
+    stats.storedBytes += it != live.end() ? it->second->bytes() : indexed.bytes;
+  }
+  stats.entries = (int64_t)index.size();
+  return stats;
+}
+
+int DiskCache::openStream(void *userData, char *uri, mpv_stream_cb_info *info) {
+  auto self = static_cast<DiskCache *>(userData);
+  std::string url = uri;
+  auto prefix = std::string(Protocol) + "://";
+  if (!url.starts_with(prefix)) return MPV_ERROR_LOADING_FAILED;
+  url = url.substr(prefix.size());
+
+  auto reader = new Reader();
+  reader->owner = self;
+  auto path = url;
+  {
+    std::lock_guard<std::mutex> l(self->lock);
+    if (auto it = self->pending.find(url); it != self->pending.end()) {
+      if (!it->second.path.empty()) path = it->second.path;
+      reader->request.config = std::move(it->second.config);
+      self->pending.erase(it);
+    }
+  }
+  Probe result;
+  if (!probe(url, reader->request.config, ProbeSecs, result)) {
+    delete reader;
+    return MPV_ERROR_LOADING_FAILED;
+  }
+  // not the redirect target, a signed one expires while the item plays and seeks would then fail
+  reader->request.url = url;
+  reader->size = result.size;
+  reader->ranged = result.ranged;
+  // keyed by the playlist entry, the URL opened and its redirect targets are often signed and short lived
+  if (!result.validator.empty()) reader->entry = self->acquire(path, result.validator, result.size);
+  self->opens++;
+
+  info->cookie = reader;
+  info->read_fn = &DiskCache::read;
+  if (reader->ranged || reader->entry) info->seek_fn = &DiskCache::seek;
+  info->size_fn = &DiskCache::size;
+  info->close_fn = &DiskCache::close;
+  info->cancel_fn = &DiskCache::cancel;
+  return 0;
+}
+
+int64_t DiskCache::read(void *cookie, char *buf, uint64_t nbytes) {
+#ifdef _WIN32
+  return -1;
+#else
+  auto reader = static_cast<Reader *>(cookie);
+  auto owner = reader->owner;
+  auto &entry = reader->entry;
+  if (reader->size >= 0 && reader->pos >= reader->size) return 0;
+  int64_t want = (int64_t)std::min<uint64_t>(nbytes, INT_MAX);
+  if (reader->size >= 0) want = std::min(want, reader->size - reader->pos);
+
+  if (entry) {
+    if (auto cached = entry->cachedAt(reader->pos); cached > 0) {
+      auto n = entry->fetch(reader->pos, buf, std::min(want, cached));
+      if (n > 0) {
+        reader->pos += n;
+        owner->hitBytes += n;
+        return n;
+      }
+    }
+    // stop at the next cached range instead of downloading it again
+    want = std::min(want, entry->nextCached(reader->pos) - reader->pos);
+  }
+
+  for (int attempt = 0; attempt < 3; attempt++) {
+    if (!reader->seekFetch()) break;
+    auto n = readPipe(reader->fetch.fd, buf, want);
+    if (n > 0) {
+      if (entry) entry->store(reader->pos, buf, n);
+      reader->fetch.pos += n;
+      reader->pos += n;
+      owner->missBytes += n;
+      return n;
+    }
+    {
+      std::lock_guard<std::mutex> l(reader->fetchLock);
+      reader->fetch.stop();
+    }
+    if (n == 0 && reader->size < 0) return 0;  // no length to hold the server to
+    // ended early, reconnect where it stopped
+  }
+  return -1;
+#endif
+}
+
+int64_t DiskCache::seek(void *cookie, int64_t offset) {
+  auto reader = static_cast<Reader *>(cookie);
+  if (offset < 0 || (reader->size >= 0 && offset > reader->size)) return MPV_ERROR_GENERIC;
+  reader->pos = offset;  // the fetch follows on the next read, unless it is served from disk
+  return offset;
+}
+
+int64_t DiskCache::size(void *cookie) {
+  auto reader = static_cast<Reader *>(cookie);
+  return reader->size >= 0 ? reader->size : static_cast<int64_t>(MPV_ERROR_UNSUPPORTED);
+}
+
+void DiskCache::close(void *cookie) {
+  auto reader = static_cast<Reader *>(cookie);
+  reader->fetch.stop();
+  if (reader->entry) reader->owner->release(reader->entry);
+  delete reader;
+}
+
+void DiskCache::cancel(void *cookie) {
+  auto reader = static_cast<Reader *>(cookie);
+  std::lock_guard<std::mutex> l(reader->fetchLock);
+  reader->cancelled = true;
+#ifndef _WIN32
+  if (reader->fetch.pid > 0) kill(reader->fetch.pid, SIGKILL);  // unblocks the read, stop() reaps it
+#endif
+}
+}  // namespace ImPlay
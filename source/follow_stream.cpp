@@ -0,0 +1,216 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+#include "helpers/utils.h"
+#include "follow_stream.h"
+
+namespace ImPlay {
+// suffixes browsers and torrent clients give files until they are complete
+static constexpr std::array PartialExtensions = {"part", "partial", "crdownload", "download",
+                                                 "!qb",  "!ut",     "opdownload"};
+
+FollowStream::Reader::~Reader() {
+#ifdef __linux__
+  if (notify >= 0) ::close(notify);
+#endif
+#ifdef _WIN32
+  if (file != nullptr) CloseHandle(file);
+#else
+  if (fd >= 0) ::close(fd);
+#endif
+}
+
+#ifdef _WIN32
+bool FollowStream::Reader::open() {
+  DWORD share = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+  HANDLE h = CreateFileW(std::filesystem::u8path(path).c_str(), GENERIC_READ, share, nullptr, OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (h == INVALID_HANDLE_VALUE) return false;
+  file = h;
+  return true;
+}
+
+int64_t FollowStream::Reader::readAt(char *buf, int64_t n) {
+  OVERLAPPED at{};
+  at.Offset = (DWORD)pos;
+  at.OffsetHigh = (DWORD)(pos >> 32);
+  DWORD got = 0;
+  if (!ReadFile(file, buf, (DWORD)n, &got, &at)) return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+  return got;
+}
+
+int64_t FollowStream::Reader::refresh() {
+  LARGE_INTEGER n;
+  FILETIME written;
+  if (GetFileSizeEx(file, &n) && GetFileTime(file, nullptr, nullptr, &written)) {
+    // 100ns ticks since 1601 to seconds since 1970
+    auto ticks = ((uint64_t)written.dwHighDateTime << 32) | written.dwLowDateTime;
+    mtime = (std::time_t)((ticks - 116444736000000000ull) / 10000000);
+    if (n.QuadPart != size) {
+      size = n.QuadPart;
+      std::lock_guard<std::mutex> guard(lock);
+      sizes[path] = size;
+    }
+  }
+  return size;
+}
+#else
+bool FollowStream::Reader::open() {
+  fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  return fd >= 0;
+}
+
+int64_t FollowStream::Reader::readAt(char *buf, int64_t n) { return pread(fd, buf, n, pos); }
+
+int64_t FollowStream::Reader::refresh() {
+  struct stat st;
+  if (fstat(fd, &st) == 0) {
+    mtime = st.st_mtime;
+    if (st.st_size != size) {
+      size = st.st_size;
+      std::lock_guard<std::mutex> guard(lock);
+      sizes[path] = size;
+    }
+  }
+  return size;
+}
+#endif
+
+bool FollowStream::Reader::waitForData() {
+  using clock = std::chrono::steady_clock;
+  if (refresh() > pos) return true;
+
+  // an old file that is merely complete must not stall playback at its end
+  if (std::time(nullptr) - mtime > IdleSecs) return false;
+
+  auto lastGrowth = clock::now();
+  int64_t lastSize = size;
+  while (!cancelled) {
+    sleep();
+    if (refresh() > pos) return true;
+    if (size != lastSize) {
+      // grew, but not yet up to a seek past the written region
+      lastSize = size;
+      lastGrowth = clock::now();
+    } else if (clock::now() - lastGrowth > std::chrono::seconds(IdleSecs)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+void FollowStream::Reader::sleep() {
+#ifdef __linux__
+  if (notify >= 0) {
+    pollfd pfd{notify, POLLIN, 0};
+    if (poll(&pfd, 1, 100) > 0) {  // cancellation is checked in between
+      char events[4096];
+      while (::read(notify, events, sizeof(events)) > 0) {
+      }
+    }
+    return;
+  }
+#endif
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+int FollowStream::add(Mpv *mpv) { return mpv->addProtocol(Protocol, nullptr, &FollowStream::open); }
+
+bool FollowStream::growing(const std::filesystem::path &path) {
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(path, ec)) return false;
+  auto ext = tolower(path.extension().string());
+  if (!ext.empty()) ext = ext.substr(1);
+  if (std::find(PartialExtensions.begin(), PartialExtensions.end(), ext) != PartialExtensions.end()) return true;
+
+  auto mtime = std::filesystem::last_write_time(path, ec);
+  return !ec && std::filesystem::file_time_type::clock::now() - mtime < std::chrono::seconds(GrowingSecs);
+}
+
+int64_t FollowStream::available(const std::string &path) {
+  std::lock_guard<std::mutex> guard(lock);
+  auto it = sizes.find(path);
+  return it != sizes.end() ? it->second : -1;
+}
+
+int FollowStream::open(void *, char *uri, mpv_stream_cb_info *info) {
+  std::string path = uri;
+  auto prefix = std::string(Protocol) + "://";
+  if (!path.starts_with(prefix)) return MPV_ERROR_LOADING_FAILED;
+
+  auto reader = new Reader();
+  reader->path = path.substr(prefix.size());
+  if (!reader->open()) {
+    delete reader;
+    return MPV_ERROR_LOADING_FAILED;
+  }
+#ifdef __linux__
+  // the watch stays on the inode, IN_MOVE_SELF wakes a wait when the download is renamed on completion
+  reader->notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  uint32_t mask = IN_MODIFY | IN_CLOSE_WRITE | IN_MOVE_SELF;
+  if (reader->notify >= 0 && inotify_add_watch(reader->notify, reader->path.c_str(), mask) < 0) {
+    ::close(reader->notify);
+    reader->notify = -1;
+  }
+#endif
+  reader->size = -1;
+  reader->refresh();
+  readers++;
+
+  info->cookie = reader;
+  info->read_fn = &FollowStream::read;
+  info->seek_fn = &FollowStream::seek;
+  info->size_fn = &FollowStream::size;
+  info->close_fn = &FollowStream::close;
+  info->cancel_fn = &FollowStream::cancel;
+  return 0;
+}
+
+int64_t FollowStream::read(void *cookie, char *buf, uint64_t nbytes) {
+  auto reader = static_cast<Reader *>(cookie);
+  if (reader->pos >= reader->size && !reader->waitForData()) return reader->cancelled ? -1 : 0;
+
+  auto n = std::min<int64_t>(std::min<uint64_t>(nbytes, INT_MAX), reader->size - reader->pos);
+  auto got = reader->readAt(buf, n);
+  if (got <= 0) return got < 0 ? -1 : 0;
+  reader->pos += got;
+  return got;
+}
+
+int64_t FollowStream::seek(void *cookie, int64_t offset) {
+  if (offset < 0) return MPV_ERROR_GENERIC;
+  // past the written region is fine, the next read waits for it
+  static_cast<Reader *>(cookie)->pos = offset;
+  return offset;
+}
+
+int64_t FollowStream::size(void *cookie) { return static_cast<Reader *>(cookie)->refresh(); }
+
+void FollowStream::close(void *cookie) {
+  auto reader = static_cast<Reader *>(cookie);
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    sizes.erase(reader->path);
+  }
+  readers--;
+  delete reader;
+}
+
+void FollowStream::cancel(void *cookie) { static_cast<Reader *>(cookie)->cancelled = true; }
+}  // namespace ImPlay
@@ -89,4 +89,14 @@ ImTextureID ImGui::LoadTexture(const char* path, ImVec2* size) {
   }
 
   return (ImTextureID)(intptr_t)texture;
-}
\ No newline at end of file
+}
+
+std::vector<unsigned char> ImGui::DecompressTTF(const void* data, int size) {
+  // the decompressor is internal to imgui, borrow it through a scratch atlas
+  ImFontAtlas atlas;
+  ImFontConfig cfg;
+  if (atlas.AddFontFromMemoryCompressedTTF(data, size, 16, &cfg) == nullptr || atlas.Sources.empty()) return {};
+  auto& src = atlas.Sources.back();
+  auto begin = static_cast<const unsigned char*>(src.FontData);
+  return {begin, begin + src.FontDataSize};
+}
@@ -2,92 +2,93 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #include <fstream>
+#include <sstream>
 #include <romfs/romfs.hpp>
-#include <nlohmann/json.hpp>
 #include "helpers/utils.h"
 #include "helpers/lang.h"
 
 namespace ImPlay {
-std::string LangData::get(std::string& key) {
-  auto it = entries.find(key);
-  if (it != entries.end()) return it->second;
-  return key;
-}
+bool LangData::load() {
+  if (loaded) return catalog.valid();
+  loaded = true;
 
-LangStr::LangStr(std::string key) { m_str = i18n(key); }
+  if (!file.empty()) {
+    std::ifstream f(file, std::ios::binary);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    std::string error;
+    storage = LangCatalog::compile(ss.str(), &error);
+    if (!storage.empty()) {
+      catalog = LangCatalog(storage);
+      title = catalog.title();
+    } else {
+      fmt::print(fg(fmt::color::red), "lang: {}: {}\n", file.string(), error);
+    }
+  }
 
-LangStr::operator std::string() const { return m_str; }
+  for (uint32_t i = 0; i < catalog.fontCount(); i++) {
+    auto font = catalog.font(i);
+    fonts.push_back({catalog.str(font.path), font.size, font.glyphRange});
+  }
+  return catalog.valid();
+}
 
-LangStr::operator std::string_view() const { return m_str; }
+const char* LangData::get(const char* key) const { return catalog.find(key); }
 
-LangStr::operator const char*() const { return m_str.c_str(); }
+LangStr::LangStr(const char* key) : m_str(i18n(key)) {}
 
 const ImWchar* getLangGlyphRanges() {
   static ImVector<ImWchar> glyphRanges;
-  if (glyphRanges.empty()) {
+  static std::string lang;
+  if (glyphRanges.empty() || lang != getLang()) {
     ImFontGlyphRangesBuilder builder;
-    for (auto& [code, lang] : getLangs()) {
-      builder.AddText(lang.title.c_str());
-      for (auto& [key, value] : lang.entries) builder.AddText(value.c_str());
+    for (auto& [code, data] : getLangs()) {
+      bool active = code == getLang() || code == getLangFallback();
+      if (active && data.load()) {
+        for (uint32_t i = 0; i < data.catalog.slotCount(); i++) {
+          auto slot = data.catalog.slot(i);
+          if (slot.hash != 0) builder.AddText(data.catalog.str(slot.value));
+        }
+      }
+      builder.AddText(data.title.c_str());
     }
+    glyphRanges.clear();
     builder.BuildRanges(&glyphRanges);
+    lang = getLang();
   }
   return &glyphRanges[0];
 }
 
-static std::pair<LangData, bool> parseLang(nlohmann::json& j) {
-  LangData lang;
-  const auto& code = j["code"];
-  const auto& title = j["title"];
-  const auto& fonts = j["fonts"];
-  const auto& entries = j["entries"];
-  if (!code.is_string() && !title.is_string() && !entries.is_object()) return {lang, false};
-  if (j.contains("fallback")) {
-    const auto& fallback = j["fallback"];
-    if (fallback.is_boolean() && fallback.get<bool>()) getLangFallback() = code.get<std::string>();
-  }
-  lang.code = code.get<std::string>();
-  lang.title = title.get<std::string>();
-  if (fonts.is_array()) {
-    for (auto& [key, value] : fonts.items()) {
-      auto& path = value["path"];
-      if (!path.is_string()) continue;
-      LangFont font{path.get<std::string>()};
-      auto& size = value["size"];
-      auto& glyph_range = value["glyph-range"];
-      if (size.is_number_integer()) font.size = size.get<int>();
-      if (glyph_range.is_number_integer()) font.glyph_range = glyph_range.get<int>();
-      lang.fonts.emplace_back(font);
-    }
-  }
-  for (auto& [key, value] : entries.items()) {
-    if (key == "" || !value.is_string()) continue;
-    lang.entries[key] = value.get<std::string>();
-  }
-  return {lang, true};
-}
-
 std::map<std::string, LangData>& getLangs() {
   static std::map<std::string, LangData> langs;
   static bool loaded = false;
   if (loaded) return langs;
 
+  // bundled catalogs are views into romfs, only the headers are read here
+  for (auto& path : romfs::list("lang")) {
+    if (path.extension() != ".cat") continue;
+    LangCatalog catalog(romfs::get(path).span());
+    if (!catalog.valid()) continue;
+    auto& lang = langs[catalog.code()];
+    lang.code = catalog.code();
+    lang.title = catalog.title();
+    lang.catalog = catalog;
+    if (catalog.fallback()) getLangFallback() = lang.code;
+  }
+
+  // user languages override bundled ones by file name, they are parsed on first use
   auto langDir = dataPath() / "lang";
   if (std::filesystem::exists(langDir)) {
     for (auto& entry : std::filesystem::directory_iterator(langDir)) {
       if (entry.is_directory() || entry.path().extension() != ".json") continue;
-      std::ifstream f(entry.path());
-      auto j = nlohmann::json::parse(f);
-      if (auto [lang, ok] = parseLang(j); ok) langs.insert({lang.code, lang});
+      auto code = entry.path().stem().string();
+      auto& lang = langs[code];
+      lang.code = code;
+      lang.file = entry.path();
+      if (lang.title.empty()) lang.title = code;
     }
   }
 
-  for (auto& path : romfs::list("lang")) {
-    auto file = romfs::get(path);
-    auto j = nlohmann::json::parse(file.data(), file.data() + file.size());
-    if (auto [lang, ok] = parseLang(j); ok) langs.insert({lang.code, lang});
-  }
-
   loaded = true;
   return langs;
 }
@@ -102,28 +103,30 @@ std::string& getLang() {
   return lang;
 }
 
-std::string i18n(std::string key) {
+const char* i18n(const char* key) {
   static std::string lang;
-  static std::map<std::string, std::string> entries;
-  if (entries.empty() || lang != getLang()) {
-    entries.clear();
-    auto langs = getLangs();
-    auto it = langs.find(getLang());
-    if (it != langs.end()) {
-      for (auto& [key, value] : it->second.entries) {
-        if (value != "") entries.insert({key, value});
-      }
-    }
-    it = langs.find(getLangFallback());
-    if (it != langs.end()) {
-      for (auto& [key, value] : it->second.entries) {
-        if (value != "") entries.insert({key, value});
-      }
-    }
+  static bool ready = false;
+  static const LangCatalog *active = nullptr, *fallback = nullptr;
+  if (!ready || lang != getLang()) {
+    auto& langs = getLangs();
+    auto find = [&](const std::string& code) -> const LangCatalog* {
+      auto it = langs.find(code);
+      return it != langs.end() && it->second.load() ? &it->second.catalog : nullptr;
+    };
+    active = find(getLang());
+    fallback = find(getLangFallback());
     lang = getLang();
+    ready = true;
+  }
+
+  std::string_view str(key);
+  uint64_t hash = langHash(str);
+  if (active != nullptr) {
+    if (auto value = active->find(str, hash)) return value;
+  }
+  if (fallback != nullptr && fallback != active) {
+    if (auto value = fallback->find(str, hash)) return value;
   }
-  auto it = entries.find(key);
-  if (it != entries.end()) return it->second;
   return key;
 }
-}  // namespace ImPlay
\ No newline at end of file
+}  // namespace ImPlay
@@ -0,0 +1,122 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <bit>
+#include <map>
+#include <nlohmann/json.hpp>
+#include "helpers/lang_catalog.h"
+
+namespace ImPlay {
+LangCatalog::LangCatalog(std::span<const std::byte> span) {
+  if (span.size() < sizeof(Header)) return;
+  std::memcpy(&header, span.data(), sizeof(Header));
+  if (header.magic != Magic || header.version != Version) return;
+  if (header.slotCount == 0 || !std::has_single_bit(header.slotCount)) return;
+
+  slotsOffset = sizeof(Header);
+  fontsOffset = slotsOffset + (size_t)header.slotCount * sizeof(Slot);
+  size_t stringsOffset = fontsOffset + (size_t)header.fontCount * sizeof(Font);
+  if (stringsOffset > span.size()) return;
+
+  strings = reinterpret_cast<const char *>(span.data() + stringsOffset);
+  stringsSize = span.size() - stringsOffset;
+  data = span.data();
+}
+
+LangCatalog::Slot LangCatalog::slot(uint32_t index) const {
+  return load<Slot>(slotsOffset + (size_t)index * sizeof(Slot));
+}
+
+LangCatalog::Font LangCatalog::font(uint32_t index) const {
+  return load<Font>(fontsOffset + (size_t)index * sizeof(Font));
+}
+
+const char *LangCatalog::find(std::string_view key, uint64_t hash) const {
+  if (data == nullptr) return nullptr;
+  uint32_t mask = header.slotCount - 1;
+  for (uint32_t i = hash & mask, n = 0; n < header.slotCount; i = (i + 1) & mask, n++) {
+    auto s = slot(i);
+    if (s.hash == 0) return nullptr;
+    if (s.hash == hash && key == str(s.key)) return str(s.value);
+  }
+  return nullptr;
+}
+
+std::vector<std::byte> LangCatalog::compile(std::string_view json, std::string *error) {
+  auto fail = [&](std::string msg) {
+    if (error != nullptr) *error = msg;
+    return std::vector<std::byte>{};
+  };
+
+  auto j = nlohmann::json::parse(json, nullptr, false);
+  if (j.is_discarded()) return fail("invalid json");
+  const auto &code = j["code"];
+  const auto &title = j["title"];
+  const auto &entries = j["entries"];
+  if (!code.is_string() || !title.is_string() || !entries.is_object()) return fail("missing code, title or entries");
+
+  std::string strings;
+  std::map<std::string, uint32_t> interned;
+  auto intern = [&](const std::string &s) {
+    auto [it, inserted] = interned.try_emplace(s, (uint32_t)strings.size());
+    if (inserted) strings.append(s).push_back('\0');
+    return it->second;
+  };
+
+  Header header{Magic, Version, Flags_None};
+  if (j.contains("fallback") && j["fallback"].is_boolean() && j["fallback"].get<bool>())
+    header.flags |= Flags_Fallback;
+  header.code = intern(code.get<std::string>());
+  header.title = intern(title.get<std::string>());
+
+  std::vector<Font> fonts;
+  if (j.contains("fonts") && j["fonts"].is_array()) {
+    for (auto &value : j["fonts"]) {
+      if (!value.is_object() || !value["path"].is_string()) continue;
+      Font font{intern(value["path"].get<std::string>())};
+      if (value["size"].is_number_integer()) font.size = value["size"].get<int>();
+      if (value["glyph-range"].is_number_integer()) font.glyphRange = value["glyph-range"].get<int>();
+      fonts.push_back(font);
+    }
+  }
+
+  std::vector<std::pair<std::string, std::string>> items;
+  for (auto &[key, value] : entries.items()) {
+    if (key == "" || !value.is_string() || value.get_ref<const std::string &>() == "") continue;
+    items.emplace_back(key, value.get<std::string>());
+  }
+
+  // keep the load factor at or below 50% so probe sequences stay short
+  uint32_t slotCount = std::bit_ceil(std::max<uint32_t>(8, (uint32_t)items.size() * 2));
+  std::vector<Slot> slots(slotCount, Slot{0, 0, 0});
+  for (auto &[key, value] : items) {
+    uint64_t hash = langHash(key);
+    uint32_t i = hash & (slotCount - 1);
+    while (slots[i].hash != 0) {
+      if (slots[i].hash == hash) return fail("hash collision on key: " + key);
+      i = (i + 1) & (slotCount - 1);
+    }
+    slots[i] = Slot{hash, intern(key), intern(value)};
+  }
+
+  header.slotCount = slotCount;
+  header.entryCount = (uint32_t)items.size();
+  header.fontCount = (uint32_t)fonts.size();
+
+  std::vector<std::byte> out(sizeof(Header) + slots.size() * sizeof(Slot) + fonts.size() * sizeof(Font) +
+                             strings.size());
+  auto p = out.data();
+  std::memcpy(p, &header, sizeof(Header));
+  p += sizeof(Header);
+  for (auto &s : slots) {
+    std::memcpy(p, &s, sizeof(Slot));
+    p += sizeof(Slot);
+  }
+  for (auto &f : fonts) {
+    std::memcpy(p, &f, sizeof(Font));
+    p += sizeof(Font);
+  }
+  std::memcpy(p, strings.data(), strings.size());
+  return out;
+}
+}  // namespace ImPlay
@@ -0,0 +1,142 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "helpers/mapped_file.h"
+
+namespace ImPlay {
+#ifdef _WIN32
+bool MappedFile::open(const std::filesystem::path &path, bool writable_, size_t minSize) {
+  close();
+  writable = writable_;
+  DWORD access = writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+  DWORD share = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+  HANDLE h = CreateFileW(path.c_str(), access, share, nullptr, writable ? OPEN_ALWAYS : OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (h == INVALID_HANDLE_VALUE) return false;
+  file = h;
+  opened = true;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(h, &size)) {
+    close();
+    return false;
+  }
+  length = (size_t)size.QuadPart;
+  if (writable && length < minSize) return resize(minSize);
+  if (!map()) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool MappedFile::map() {
+  if (length == 0) return true;
+  mapping = CreateFileMappingW(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) return false;
+  ptr = static_cast<std::byte *>(MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, length));
+  return ptr != nullptr;
+}
+
+void MappedFile::unmap() {
+  if (ptr != nullptr) UnmapViewOfFile(ptr);
+  if (mapping != nullptr) CloseHandle(mapping);
+  ptr = nullptr;
+  mapping = nullptr;
+}
+
+void MappedFile::close() {
+  unmap();
+  if (file != nullptr) CloseHandle(file);
+  file = nullptr;
+  length = 0;
+  opened = false;
+}
+
+bool MappedFile::resize(size_t size) {
+  if (!opened || !writable) return false;
+  unmap();
+  LARGE_INTEGER pos;
+  pos.QuadPart = (LONGLONG)size;
+  if (!SetFilePointerEx(file, pos, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+    map();
+    return false;
+  }
+  length = size;
+  return map();
+}
+
+bool MappedFile::flush(bool sync) {
+  if (ptr == nullptr || !writable) return true;
+  if (!FlushViewOfFile(ptr, length)) return false;
+  return !sync || FlushFileBuffers(file);
+}
+#else
+bool MappedFile::open(const std::filesystem::path &path, bool writable_, size_t minSize) {
+  close();
+  writable = writable_;
+  fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  opened = true;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close();
+    return false;
+  }
+  length = (size_t)st.st_size;
+  if (writable && length < minSize) return resize(minSize);
+  if (!map()) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool MappedFile::map() {
+  if (length == 0) return true;
+  int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *p = mmap(nullptr, length, prot, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) return false;
+  ptr = static_cast<std::byte *>(p);
+  return true;
+}
+
+void MappedFile::unmap() {
+  if (ptr != nullptr) munmap(ptr, length);
+  ptr = nullptr;
+}
+
+void MappedFile::close() {
+  unmap();
+  if (fd >= 0) ::close(fd);
+  fd = -1;
+  length = 0;
+  opened = false;
+}
+
+bool MappedFile::resize(size_t size) {
+  if (!opened || !writable) return false;
+  unmap();
+  if (ftruncate(fd, (off_t)size) != 0) {
+    map();
+    return false;
+  }
+  length = size;
+  return map();
+}
+
+bool MappedFile::flush(bool sync) {
+  if (ptr == nullptr || !writable) return true;
+  return msync(ptr, length, sync ? MS_SYNC : MS_ASYNC) == 0;
+}
+#endif
+}  // namespace ImPlay
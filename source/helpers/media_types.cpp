@@ -0,0 +1,56 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <cstring>
+#include <fstream>
+#include "helpers/media_types.h"
+
+namespace ImPlay {
+static_assert(mediaTypeOf(std::string_view("Movie.MKV")) == MediaType::Video);
+static_assert(mediaTypeOf(std::string_view("dir.mp3/track")) == MediaType::None);
+static_assert(mediaTypeOf(std::string_view("song.thd+ac3")) == MediaType::Audio);
+static_assert(mediaTypeOf(std::string_view("a.SRT")) == MediaType::Subtitle);
+
+static bool startsWith(std::string_view data, std::string_view prefix) { return data.substr(0, prefix.size()) == prefix; }
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// "1\n00:00:01,000 --> 00:00:02,000"
+static bool isSrt(std::string_view data) {
+  size_t i = 0;
+  while (i < data.size() && (data[i] == '\r' || data[i] == '\n' || data[i] == ' ')) i++;
+  size_t digits = i;
+  while (i < data.size() && isDigit(data[i])) i++;
+  if (i == digits) return false;
+  while (i < data.size() && (data[i] == '\r' || data[i] == ' ')) i++;
+  if (i >= data.size() || data[i++] != '\n') return false;
+  auto line = data.substr(i, 17);
+  return line.size() == 17 && isDigit(line[0]) && isDigit(line[1]) && line[2] == ':' && isDigit(line[3]) &&
+         isDigit(line[4]) && line[5] == ':' && isDigit(line[6]) && isDigit(line[7]) &&
+         (line[8] == ',' || line[8] == '.') && isDigit(line[9]) && isDigit(line[10]) && isDigit(line[11]) &&
+         line.substr(12) == " --> ";
+}
+
+MediaType sniffMediaType(const std::filesystem::path &path) {
+  char buf[512];
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return MediaType::None;
+  file.read(buf, sizeof(buf));
+  std::string_view data(buf, (size_t)file.gcount());
+  auto byteAt = [&](size_t i) { return i < data.size() ? static_cast<uint8_t>(data[i]) : 0; };
+
+  if (startsWith(data, "\x1a\x45\xdf\xa3")) return MediaType::Video;         // EBML: Matroska, WebM
+  if (data.size() >= 8 && data.substr(4, 4) == "ftyp") return MediaType::Video;  // ISO BMFF: MP4, MOV, M4A
+  if (byteAt(0) == 0x47 && byteAt(188) == 0x47 && (data.size() <= 376 || byteAt(376) == 0x47))
+    return MediaType::Video;  // MPEG-TS
+  if (byteAt(4) == 0x47 && byteAt(196) == 0x47) return MediaType::Video;  // M2TS, 4-byte timecode prefix
+  if (startsWith(data, "OggS")) return MediaType::Audio;
+  if (startsWith(data, "fLaC")) return MediaType::Audio;
+
+  if (startsWith(data, "\xef\xbb\xbf")) data.remove_prefix(3);
+  if (startsWith(data, "[Script Info]")) return MediaType::Subtitle;  // ASS/SSA
+  if (startsWith(data, "WEBVTT")) return MediaType::Subtitle;
+  if (isSrt(data)) return MediaType::Subtitle;
+  return MediaType::None;
+}
+}  // namespace ImPlay
@@ -0,0 +1,196 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <time.h>
+#include <unistd.h>
+#endif
+#include <fmt/format.h>
+#include <fmt/color.h>
+#include <nlohmann/json.hpp>
+#include "helpers/startup.h"
+
+namespace ImPlay::Startup {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Phase {
+  std::string name;
+  double end;  // ms since process start
+};
+
+const Clock::time_point loaded = Clock::now();
+Clock::time_point origin = loaded;
+
+std::atomic<bool> active = false;
+std::atomic<bool> rendered = false;
+bool painted = false, videoShown = false, reported = false, waitVideo = false;
+std::filesystem::path outputPath;
+std::mutex lock;
+std::vector<Phase> phases;
+std::vector<std::pair<Phase, double>> tasks;  // with begin time
+double firstFrame = -1, firstVideoFrame = -1;
+
+// How long the process had been running when this module was initialized.
+Clock::duration processAge() {
+#ifdef _WIN32
+  FILETIME creation, exited, kernel, user, now;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exited, &kernel, &user)) return {};
+  GetSystemTimePreciseAsFileTime(&now);
+  auto ticks = [](FILETIME t) { return (int64_t)t.dwHighDateTime << 32 | t.dwLowDateTime; };
+  auto age = std::chrono::duration<int64_t, std::ratio<1, 10000000>>(ticks(now) - ticks(creation));
+  return std::chrono::duration_cast<Clock::duration>(age) - (Clock::now() - loaded);
+#elif defined(__linux__)
+  // field 22 of /proc/self/stat is the start time in clock ticks since boot
+  std::ifstream file("/proc/self/stat");
+  std::string stat((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  auto pos = stat.rfind(')');
+  if (pos == std::string::npos) return {};
+  unsigned long long start = 0;
+  if (sscanf(stat.c_str() + pos + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu",
+             &start) != 1)
+    return {};
+  timespec boot;
+  clock_gettime(CLOCK_BOOTTIME, &boot);
+  double age = boot.tv_sec + boot.tv_nsec / 1e9 - (double)start / sysconf(_SC_CLK_TCK);
+  auto sinceLoad = std::chrono::duration<double>(Clock::now() - loaded).count();
+  if (age < sinceLoad) return {};
+  return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(age - sinceLoad));
+#else
+  return {};
+#endif
+}
+
+double elapsed() { return std::chrono::duration<double, std::milli>(Clock::now() - origin).count(); }
+
+void markLocked(const char *phase, double time) { phases.push_back({phase, time}); }
+
+void write() {
+  if (outputPath.empty()) {
+    fmt::print("Startup phases (ms since process start):\n");
+    double prev = 0;
+    for (auto &p : phases) {
+      fmt::print("  {:>9.2f}  {:>+9.2f}  {}\n", p.end, p.end - prev, p.name);
+      prev = p.end;
+    }
+    if (!tasks.empty()) fmt::print("Background tasks:\n");
+    for (auto &[p, begin] : tasks) fmt::print("  {:>9.2f}  {:>+9.2f}  {}\n", p.end, p.end - begin, p.name);
+    if (firstFrame >= 0) fmt::print("Time to first painted frame: {:.2f} ms\n", firstFrame);
+    if (firstVideoFrame >= 0) fmt::print("Time to first video frame: {:.2f} ms\n", firstVideoFrame);
+    return;
+  }
+
+  nlohmann::json j;
+  auto &list = j["phases"] = nlohmann::json::array();
+  double prev = 0;
+  for (auto &p : phases) {
+    list.push_back({{"name", p.name}, {"end_ms", p.end}, {"duration_ms", p.end - prev}});
+    prev = p.end;
+  }
+  auto &background = j["tasks"] = nlohmann::json::array();
+  for (auto &[p, begin] : tasks)
+    background.push_back({{"name", p.name}, {"begin_ms", begin}, {"end_ms", p.end}, {"duration_ms", p.end - begin}});
+  j["first_painted_frame_ms"] = firstFrame >= 0 ? nlohmann::json(firstFrame) : nlohmann::json(nullptr);
+  j["first_video_frame_ms"] = firstVideoFrame >= 0 ? nlohmann::json(firstVideoFrame) : nlohmann::json(nullptr);
+
+  std::ofstream file(outputPath, std::ios::binary);
+  file << j.dump(2) << "\n";
+  if (!file) fmt::print(fg(fmt::color::red), "Failed to write startup trace: {}\n", outputPath.string());
+}
+}  // namespace
+
+void enable(const std::filesystem::path &output, bool expectVideo) {
+  std::lock_guard<std::mutex> l(lock);
+  origin = loaded - processAge();
+  outputPath = output;
+  waitVideo = expectVideo;
+  if (origin != loaded) markLocked("process-load", std::chrono::duration<double, std::milli>(loaded - origin).count());
+  active = true;
+}
+
+bool enabled() { return active; }
+
+std::filesystem::path output() {
+  std::lock_guard<std::mutex> l(lock);
+  return outputPath;
+}
+
+double launchTime() {
+  auto age = std::chrono::duration<double, std::milli>(Clock::now() - origin).count();
+  auto now = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+  return now - age;
+}
+
+void adopt(const std::filesystem::path &output, bool expectVideo, double launchTime) {
+  std::lock_guard<std::mutex> l(lock);
+  auto now = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+  origin = Clock::now() - std::chrono::duration_cast<Clock::duration>(
+                              std::chrono::duration<double, std::milli>(std::max(now - launchTime, 0.0)));
+  outputPath = output;
+  waitVideo = expectVideo;
+  phases.clear();
+  tasks.clear();
+  painted = videoShown = reported = false;
+  rendered = false;
+  firstFrame = firstVideoFrame = -1;
+  markLocked("handoff-received", elapsed());
+  active = true;
+}
+
+void mark(const char *phase) {
+  if (!active) return;
+  std::lock_guard<std::mutex> l(lock);
+  markLocked(phase, elapsed());
+}
+
+double now() { return active ? elapsed() : 0; }
+
+void task(const char *name, double begin) {
+  if (!active) return;
+  std::lock_guard<std::mutex> l(lock);
+  tasks.push_back({{name, elapsed()}, begin});
+}
+
+void videoRendered() {
+  if (active) rendered.store(true, std::memory_order_relaxed);
+}
+
+void framePresented(bool showsVideo) {
+  if (!active) return;
+  std::lock_guard<std::mutex> l(lock);
+  if (!painted) {
+    painted = true;
+    firstFrame = elapsed();
+    markLocked("first-painted-frame", firstFrame);
+  }
+  if (!videoShown && showsVideo && rendered.load(std::memory_order_relaxed)) {
+    videoShown = true;
+    firstVideoFrame = elapsed();
+    markLocked("first-video-frame", firstVideoFrame);
+  }
+  if (!reported && (videoShown || !waitVideo)) {
+    reported = true;
+    write();
+    active = false;
+  }
+}
+
+void report() {
+  if (!active) return;
+  std::lock_guard<std::mutex> l(lock);
+  if (reported) return;
+  reported = true;
+  write();
+  active = false;
+}
+}  // namespace ImPlay::Startup
@@ -0,0 +1,407 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <fmt/format.h>
+#include "helpers/subtitle_text.h"
+
+namespace ImPlay::SubtitleText {
+namespace {
+// Upper halves of the Windows codepages 1250-1256, U+FFFD for unassigned bytes.
+constexpr uint16_t Codepages[][128] = {
+    {  // 1250
+        0x20ac, 0xfffd, 0x201a, 0xfffd, 0x201e, 0x2026, 0x2020, 0x2021, 0xfffd, 0x2030, 0x0160, 0x2039,
+        0x015a, 0x0164, 0x017d, 0x0179, 0xfffd, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+        0xfffd, 0x2122, 0x0161, 0x203a, 0x015b, 0x0165, 0x017e, 0x017a, 0x00a0, 0x02c7, 0x02d8, 0x0141,
+        0x00a4, 0x0104, 0x00a6, 0x00a7, 0x00a8, 0x00a9, 0x015e, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x017b,
+        0x00b0, 0x00b1, 0x02db, 0x0142, 0x00b4, 0x00b5, 0x00b6, 0x00b7, 0x00b8, 0x0105, 0x015f, 0x00bb,
+        0x013d, 0x02dd, 0x013e, 0x017c, 0x0154, 0x00c1, 0x00c2, 0x0102, 0x00c4, 0x0139, 0x0106, 0x00c7,
+        0x010c, 0x00c9, 0x0118, 0x00cb, 0x011a, 0x00cd, 0x00ce, 0x010e, 0x0110, 0x0143, 0x0147, 0x00d3,
+        0x00d4, 0x0150, 0x00d6, 0x00d7, 0x0158, 0x016e, 0x00da, 0x0170, 0x00dc, 0x00dd, 0x0162, 0x00df,
+        0x0155, 0x00e1, 0x00e2, 0x0103, 0x00e4, 0x013a, 0x0107, 0x00e7, 0x010d, 0x00e9, 0x0119, 0x00eb,
+        0x011b, 0x00ed, 0x00ee, 0x010f, 0x0111, 0x0144, 0x0148, 0x00f3, 0x00f4, 0x0151, 0x00f6, 0x00f7,
+        0x0159, 0x016f, 0x00fa, 0x0171, 0x00fc, 0x00fd, 0x0163, 0x02d9,
+    },
+    {  // 1251
+        0x0402, 0x0403, 0x201a, 0x0453, 0x201e, 0x2026, 0x2020, 0x2021, 0x20ac, 0x2030, 0x0409, 0x2039,
+        0x040a, 0x040c, 0x040b, 0x040f, 0x0452, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+        0xfffd, 0x2122, 0x0459, 0x203a, 0x045a, 0x045c, 0x045b, 0x045f, 0x00a0, 0x040e, 0x045e, 0x0408,
+        0x00a4, 0x0490, 0x00a6, 0x00a7, 0x0401, 0x00a9, 0x0404, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x0407,
+        0x00b0, 0x00b1, 0x0406, 0x0456, 0x0491, 0x00b5, 0x00b6, 0x00b7, 0x0451, 0x2116, 0x0454, 0x00bb,
+        0x0458, 0x0405, 0x0455, 0x0457, 0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+        0x0418, 0x0419, 0x041a, 0x041b, 0x041c, 0x041d, 0x041e, 0x041f, 0x0420, 0x0421, 0x0422, 0x0423,
+        0x0424, 0x0425, 0x0426, 0x0427, 0x0428, 0x0429, 0x042a, 0x042b, 0x042c, 0x042d, 0x042e, 0x042f,
+        0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437, 0x0438, 0x0439, 0x043a, 0x043b,
+        0x043c, 0x043d, 0x043e, 0x043f, 0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+        0x0448, 0x0449, 0x044a, 0x044b, 0x044c, 0x044d, 0x044e, 0x044f,
+    },
+    {  // 1252
+        0x20ac, 0xfffd, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021, 0x02c6, 0x2030, 0x0160, 0x2039,
+        0x0152, 0xfffd, 0x017d, 0xfffd, 0xfffd, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+        0x02dc, 0x2122, 0x0161, 0x203a, 0x0153, 0xfffd, 0x017e, 0x0178, 0x00a0, 0x00a1, 0x00a2, 0x00a3,
+        0x00a4, 0x00a5, 0x00a6, 0x00a7, 0x00a8, 0x00a9, 0x00aa, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x00af,
+        0x00b0, 0x00b1, 0x00b2, 0x00b3, 0x00b4, 0x00b5, 0x00b6, 0x00b7, 0x00b8, 0x00b9, 0x00ba, 0x00bb,
+        0x00bc, 0x00bd, 0x00be, 0x00bf, 0x00c0, 0x00c1, 0x00c2, 0x00c3, 0x00c4, 0x00c5, 0x00c6, 0x00c7,
+        0x00c8, 0x00c9, 0x00ca, 0x00cb, 0x00cc, 0x00cd, 0x00ce, 0x00cf, 0x00d0, 0x00d1, 0x00d2, 0x00d3,
+        0x00d4, 0x00d5, 0x00d6, 0x00d7, 0x00d8, 0x00d9, 0x00da, 0x00db, 0x00dc, 0x00dd, 0x00de, 0x00df,
+        0x00e0, 0x00e1, 0x00e2, 0x00e3, 0x00e4, 0x00e5, 0x00e6, 0x00e7, 0x00e8, 0x00e9, 0x00ea, 0x00eb,
+        0x00ec, 0x00ed, 0x00ee, 0x00ef, 0x00f0, 0x00f1, 0x00f2, 0x00f3, 0x00f4, 0x00f5, 0x00f6, 0x00f7,
+        0x00f8, 0x00f9, 0x00fa, 0x00fb, 0x00fc, 0x00fd, 0x00fe, 0x00ff,
+    },
+    {  // 1253
+        0x20ac, 0xfffd, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021, 0xfffd, 0x2030, 0xfffd, 0x2039,
+        0xfffd, 0xfffd, 0xfffd, 0xfffd, 0xfffd, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+        0xfffd, 0x2122, 0xfffd, 0x203a, 0xfffd, 0xfffd, 0xfffd, 0xfffd, 0x00a0, 0x0385, 0x0386, 0x00a3,
+        0x00a4, 0x00a5, 0x00a6, 0x00a7, 0x00a8, 0x00a9, 0xfffd, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x2015,
+        0x00b0, 0x00b1, 0x00b2, 0x00b3, 0x0384, 0x00b5, 0x00b6, 0x00b7, 0x0388, 0x0389, 0x038a, 0x00bb,
+        0x038c, 0x00bd, 0x038e, 0x038f, 0x0390, 0x0391, 0x0392, 0x0393, 0x0394, 0x0395, 0x0396, 0x0397,
+        0x0398, 0x0399, 0x039a, 0x039b, 0x039c, 0x039d, 0x039e, 0x039f, 0x03a0, 0x03a1, 0xfffd, 0x03a3,
+        0x03a4, 0x03a5, 0x03a6, 0x03a7, 0x03a8, 0x03a9, 0x03aa, 0x03ab, 0x03ac, 0x03ad, 0x03ae, 0x03af,
+        0x03b0, 0x03b1, 0x03b2, 0x03b3, 0x03b4, 0x03b5, 0x03b6, 0x03b7, 0x03b8, 0x03b9, 0x03ba, 0x03bb,
+        0x03bc, 0x03bd, 0x03be, 0x03bf, 0x03c0, 0x03c1, 0x03c2, 0x03c3, 0x03c4, 0x03c5, 0x03c6, 0x03c7,
+        0x03c8, 0x03c9, 0x03ca, 0x03cb, 0x03cc, 0x03cd, 0x03ce, 0xfffd,
+    },
+    {  // 1254
+        0x20ac, 0xfffd, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021, 0x02c6, 0x2030, 0x0160, 0x2039,
+        0x0152, 0xfffd, 0xfffd, 0xfffd, 0xfffd, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+        0x02dc, 0x2122, 0x0161, 0x203a, 0x0153, 0xfffd, 0xfffd, 0x0178, 0x00a0, 0x00a1, 0x00a2, 0x00a3,
+        0x00a4, 0x00a5, 0x00a6, 0x00a7, 0x00a8, 0x00a9, 0x00aa, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x00af,
+        0x00b0, 0x00b1, 0x00b2, 0x00b3, 0x00b4, 0x00b5, 0x00b6, 0x00b7, 0x00b8, 0x00b9, 0x00ba, 0x00bb,
+        0x00bc, 0x00bd, 0x00be, 0x00bf, 0x00c0, 0x00c1, 0x00c2, 0x00c3, 0x00c4, 0x00c5, 0x00c6, 0x00c7,
+        0x00c8, 0x00c9, 0x00ca, 0x00cb, 0x00cc, 0x00cd, 0x00ce, 0x00cf, 0x011e, 0x00d1, 0x00d2, 0x00d3,
+        0x00d4, 0x00d5, 0x00d6, 0x00d7, 0x00d8, 0x00d9, 0x00da, 0x00db, 0x00dc, 0x0130, 0x015e, 0x00df,
+        0x00e0, 0x00e1, 0x00e2, 0x00e3, 0x00e4, 0x00e5, 0x00e6, 0x00e7, 0x00e8, 0x00e9, 0x00ea, 0x00eb,
+        0x00ec, 0x00ed, 0x00ee, 0x00ef, 0x011f, 0x00f1, 0x00f2, 0x00f3, 0x00f4, 0x00f5, 0x00f6, 0x00f7,
+        0x00f8, 0x00f9, 0x00fa, 0x00fb, 0x00fc, 0x0131, 0x015f, 0x00ff,
+    },
+    {  // 1255
+        0x20ac, 0xfffd, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021, 0x02c6, 0x2030, 0xfffd, 0x2039,
+        0xfffd, 0xfffd, 0xfffd, 0xfffd, 0xfffd, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+        0x02dc, 0x2122, 0xfffd, 0x203a, 0xfffd, 0xfffd, 0xfffd, 0xfffd, 0x00a0, 0x00a1, 0x00a2, 0x00a3,
+        0x20aa, 0x00a5, 0x00a6, 0x00a7, 0x00a8, 0x00a9, 0x00d7, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x00af,
+        0x00b0, 0x00b1, 0x00b2, 0x00b3, 0x00b4, 0x00b5, 0x00b6, 0x00b7, 0x00b8, 0x00b9, 0x00f7, 0x00bb,
+        0x00bc, 0x00bd, 0x00be, 0x00bf, 0x05b0, 0x05b1, 0x05b2, 0x05b3, 0x05b4, 0x05b5, 0x05b6, 0x05b7,
+        0x05b8, 0x05b9, 0xfffd, 0x05bb, 0x05bc, 0x05bd, 0x05be, 0x05bf, 0x05c0, 0x05c1, 0x05c2, 0x05c3,
+        0x05f0, 0x05f1, 0x05f2, 0x05f3, 0x05f4, 0xfffd, 0xfffd, 0xfffd, 0xfffd, 0xfffd, 0xfffd, 0xfffd,
+        0x05d0, 0x05d1, 0x05d2, 0x05d3, 0x05d4, 0x05d5, 0x05d6, 0x05d7, 0x05d8, 0x05d9, 0x05da, 0x05db,
+        0x05dc, 0x05dd, 0x05de, 0x05df, 0x05e0, 0x05e1, 0x05e2, 0x05e3, 0x05e4, 0x05e5, 0x05e6, 0x05e7,
+        0x05e8, 0x05e9, 0x05ea, 0xfffd, 0xfffd, 0x200e, 0x200f, 0xfffd,
+    },
+    {  // 1256
+        0x20ac, 0x067e, 0x201a, 0x0192, 0x201e, 0x2026, 0x2020, 0x2021, 0x02c6, 0x2030, 0x0679, 0x2039,
+        0x0152, 0x0686, 0x0698, 0x0688, 0x06af, 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014,
+        0x06a9, 0x2122, 0x0691, 0x203a, 0x0153, 0x200c, 0x200d, 0x06ba, 0x00a0, 0x060c, 0x00a2, 0x00a3,
+        0x00a4, 0x00a5, 0x00a6, 0x00a7, 0x00a8, 0x00a9, 0x06be, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x00af,
+        0x00b0, 0x00b1, 0x00b2, 0x00b3, 0x00b4, 0x00b5, 0x00b6, 0x00b7, 0x00b8, 0x00b9, 0x061b, 0x00bb,
+        0x00bc, 0x00bd, 0x00be, 0x061f, 0x06c1, 0x0621, 0x0622, 0x0623, 0x0624, 0x0625, 0x0626, 0x0627,
+        0x0628, 0x0629, 0x062a, 0x062b, 0x062c, 0x062d, 0x062e, 0x062f, 0x0630, 0x0631, 0x0632, 0x0633,
+        0x0634, 0x0635, 0x0636, 0x00d7, 0x0637, 0x0638, 0x0639, 0x063a, 0x0640, 0x0641, 0x0642, 0x0643,
+        0x00e0, 0x0644, 0x00e2, 0x0645, 0x0646, 0x0647, 0x0648, 0x00e7, 0x00e8, 0x00e9, 0x00ea, 0x00eb,
+        0x0649, 0x064a, 0x00ee, 0x00ef, 0x064b, 0x064c, 0x064d, 0x064e, 0x00f4, 0x064f, 0x0650, 0x00f7,
+        0x0651, 0x00f9, 0x0652, 0x00fb, 0x00fc, 0x200e, 0x200f, 0x06d2,
+    },
+};
+
+void appendUtf8(std::string &out, uint32_t c) {
+  if (c < 0x80) {
+    out += static_cast<char>(c);
+  } else if (c < 0x800) {
+    out += static_cast<char>(0xc0 | c >> 6);
+    out += static_cast<char>(0x80 | (c & 0x3f));
+  } else if (c < 0x10000) {
+    out += static_cast<char>(0xe0 | c >> 12);
+    out += static_cast<char>(0x80 | (c >> 6 & 0x3f));
+    out += static_cast<char>(0x80 | (c & 0x3f));
+  } else {
+    out += static_cast<char>(0xf0 | c >> 18);
+    out += static_cast<char>(0x80 | (c >> 12 & 0x3f));
+    out += static_cast<char>(0x80 | (c >> 6 & 0x3f));
+    out += static_cast<char>(0x80 | (c & 0x3f));
+  }
+}
+
+bool validUtf8(std::string_view str) {
+  auto p = reinterpret_cast<const uint8_t *>(str.data());
+  auto end = p + str.size();
+  while (p < end) {
+    if (*p < 0x80) {
+      p++;
+      continue;
+    }
+    int n;
+    uint32_t c, min;
+    if ((*p & 0xe0) == 0xc0) n = 1, c = *p & 0x1f, min = 0x80;
+    else if ((*p & 0xf0) == 0xe0) n = 2, c = *p & 0x0f, min = 0x800;
+    else if ((*p & 0xf8) == 0xf0) n = 3, c = *p & 0x07, min = 0x10000;
+    else return false;
+    if (end - p <= n) return false;
+    for (int i = 1; i <= n; i++) {
+      if ((p[i] & 0xc0) != 0x80) return false;
+      c = c << 6 | (p[i] & 0x3f);
+    }
+    if (c < min || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) return false;
+    p += n + 1;
+  }
+  return true;
+}
+
+// Guesses BOM-less UTF-16 from where the zero bytes of ASCII characters fall. 0: not UTF-16.
+int utf16Order(std::string_view data) {
+  size_t n = std::min<size_t>(data.size(), 4096) & ~size_t(1);
+  if (n < 16) return 0;
+  size_t even = 0, odd = 0;
+  for (size_t i = 0; i < n; i += 2) {
+    even += data[i] == 0;
+    odd += data[i + 1] == 0;
+  }
+  size_t pairs = n / 2;
+  if (odd > pairs * 2 / 5 && even < pairs / 20) return 1;  // little endian
+  if (even > pairs * 2 / 5 && odd < pairs / 20) return 2;  // big endian
+  return 0;
+}
+
+std::string decodeUtf16(std::string_view data, bool be) {
+  std::string out;
+  out.reserve(data.size());
+  auto unit = [&](size_t i) -> uint32_t {
+    auto b0 = static_cast<uint8_t>(data[i]), b1 = static_cast<uint8_t>(data[i + 1]);
+    return be ? b0 << 8 | b1 : b1 << 8 | b0;
+  };
+  for (size_t i = 0; i + 1 < data.size(); i += 2) {
+    uint32_t c = unit(i);
+    if (c >= 0xd800 && c <= 0xdbff && i + 3 < data.size()) {
+      uint32_t low = unit(i + 2);
+      if (low >= 0xdc00 && low <= 0xdfff) {
+        c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+        i += 2;
+      } else {
+        c = 0xfffd;
+      }
+    } else if (c >= 0xd800 && c <= 0xdfff) {
+      c = 0xfffd;
+    }
+    appendUtf8(out, c);
+  }
+  return out;
+}
+
+std::string decodeCodepage(std::string_view data, const uint16_t *table) {
+  std::string out;
+  out.reserve(data.size() + data.size() / 2);
+  for (char ch : data) {
+    auto b = static_cast<uint8_t>(ch);
+    if (b < 0x80)
+      out += ch;
+    else
+      appendUtf8(out, table[b - 0x80]);
+  }
+  return out;
+}
+
+struct Cue {
+  int64_t start, end;  // ms
+  std::string text;
+};
+
+std::string_view trim(std::string_view str) {
+  while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) str.remove_prefix(1);
+  while (!str.empty() && (str.back() == ' ' || str.back() == '\t' || str.back() == '\r')) str.remove_suffix(1);
+  return str;
+}
+
+bool numeric(std::string_view str) {
+  return !str.empty() && std::all_of(str.begin(), str.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// [h:]m:s[,.]ms, ms is a decimal fraction of one to three digits
+int64_t parseTime(std::string_view str) {
+  int64_t fields[3] = {0, 0, 0};
+  int count = 0;
+  size_t i = 0;
+  while (true) {
+    size_t start = i;
+    int64_t value = 0;
+    while (i < str.size() && str[i] >= '0' && str[i] <= '9' && i - start < 3) value = value * 10 + (str[i++] - '0');
+    if (i == start || count == 3) return -1;
+    fields[count++] = value;
+    if (i < str.size() && str[i] == ':') {
+      i++;
+      continue;
+    }
+    break;
+  }
+  if (count < 2) return -1;
+  int64_t ms = 0;
+  if (i < str.size() && (str[i] == ',' || str[i] == '.')) {
+    int64_t scale = 100;
+    for (i++; i < str.size() && str[i] >= '0' && str[i] <= '9'; i++, scale /= 10) ms += (str[i] - '0') * scale;
+  }
+  if (i != str.size()) return -1;
+  int64_t h = count == 3 ? fields[0] : 0, m = fields[count - 2], s = fields[count - 1];
+  if (m >= 60 || s >= 60) return -1;
+  return ((h * 60 + m) * 60 + s) * 1000 + ms;
+}
+
+bool parseTiming(std::string_view line, int64_t &start, int64_t &end) {
+  auto arrow = line.find("->");
+  if (arrow == std::string_view::npos) return false;
+  auto left = trim(line.substr(0, arrow));
+  if (!left.empty() && left.back() == '-') left = trim(left.substr(0, left.size() - 1));
+  auto right = trim(line.substr(arrow + 2));
+  right = right.substr(0, right.find_first_of(" \t"));  // drop position hints
+  start = parseTime(left);
+  end = parseTime(right);
+  return start >= 0 && end >= 0;
+}
+
+bool looksLikeSrt(std::string_view text) {
+  int lines = 0;
+  for (size_t pos = 0; pos < text.size() && lines < 4;) {
+    auto eol = std::min(text.find('\n', pos), text.size());
+    auto line = trim(text.substr(pos, eol - pos));
+    pos = eol + 1;
+    if (line.empty()) continue;
+    if (line.starts_with("WEBVTT")) return false;
+    int64_t start, end;
+    if (parseTiming(line, start, end)) return true;
+    lines++;
+  }
+  return false;
+}
+
+std::string formatTime(int64_t ms) {
+  return fmt::format("{:02}:{:02}:{:02},{:03}", ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, ms % 1000);
+}
+
+// Cues are taken from timing lines, so missing or wrong indexes and blank lines are tolerated:
+// a number right before a timing line is its index, any other text after a blank line belongs
+// to the previous cue.
+std::string repairSrt(std::string_view text, int &repairs) {
+  std::vector<Cue> cues;
+  std::string index;  // a numeric line that may be the next cue's index
+  bool gap = false;
+  auto appendText = [&](std::string_view line) {
+    if (cues.empty()) return;
+    auto &cue = cues.back();
+    if (gap && !cue.text.empty()) repairs++;
+    if (!cue.text.empty()) cue.text += '\n';
+    cue.text += line;
+    gap = false;
+  };
+
+  for (size_t pos = 0; pos < text.size();) {
+    auto eol = std::min(text.find('\n', pos), text.size());
+    auto raw = text.substr(pos, eol - pos);
+    pos = eol + 1;
+    if (!raw.empty() && raw.back() == '\r') raw.remove_suffix(1);
+    auto line = trim(raw);
+
+    int64_t start, end;
+    if (parseTiming(line, start, end)) {
+      // the blank line before this cue is missing, its index ended up in the previous text;
+      // after a blank line or a pending index the previous text is complete, numbers included
+      if (!cues.empty() && index.empty() && !gap) {
+        auto &prev = cues.back().text;
+        auto nl = prev.rfind('\n');
+        if (nl != std::string::npos && numeric(trim(std::string_view(prev).substr(nl + 1)))) {
+          prev.resize(nl);
+          repairs++;
+        }
+      }
+      cues.push_back({start, end, {}});
+      index.clear();
+      gap = false;
+    } else if (line.empty()) {
+      if (!index.empty()) appendText(index), index.clear();
+      gap = true;
+    } else if (numeric(line) && (gap || cues.empty()) && index.empty()) {
+      index = line;
+    } else {
+      if (!index.empty()) appendText(index), index.clear();
+      appendText(raw);
+    }
+  }
+
+  auto empty = std::remove_if(cues.begin(), cues.end(), [](const Cue &cue) { return cue.text.empty(); });
+  repairs += (int)(cues.end() - empty);
+  cues.erase(empty, cues.end());
+  if (!std::is_sorted(cues.begin(), cues.end(), [](auto &a, auto &b) { return a.start < b.start; })) {
+    std::stable_sort(cues.begin(), cues.end(), [](auto &a, auto &b) { return a.start < b.start; });
+    repairs++;
+  }
+  for (size_t i = 0; i < cues.size(); i++) {
+    auto &cue = cues[i];
+    if (cue.end > cue.start) continue;
+    // no usable end time, show it until the next cue, at most a few seconds
+    cue.end = cue.start + 3000;
+    if (i + 1 < cues.size() && cues[i + 1].start > cue.start) cue.end = std::min(cue.end, cues[i + 1].start);
+    repairs++;
+  }
+
+  std::string out;
+  out.reserve(text.size());
+  for (size_t i = 0; i < cues.size(); i++) {
+    out += fmt::format("{}\n{} --> {}\n", i + 1, formatTime(cues[i].start), formatTime(cues[i].end));
+    out += cues[i].text;
+    out += "\n\n";
+  }
+  return out;
+}
+}  // namespace
+
+Result normalize(std::string_view data, int codepage) {
+  Result result;
+  if (data.starts_with("\xef\xbb\xbf")) {
+    result.encoding = Encoding::Utf8Bom;
+    result.text = data.substr(3);
+  } else if (data.starts_with("\xff\xfe") || data.starts_with("\xfe\xff")) {
+    bool be = data[0] == '\xfe';
+    result.encoding = be ? Encoding::Utf16Be : Encoding::Utf16Le;
+    result.text = decodeUtf16(data.substr(2), be);
+  } else if (int order = utf16Order(data)) {
+    result.encoding = order == 2 ? Encoding::Utf16Be : Encoding::Utf16Le;
+    result.text = decodeUtf16(data, order == 2);
+  } else if (validUtf8(data)) {
+    result.encoding = Encoding::Utf8;
+    result.text = data;
+  } else if (codepage >= 1250 && codepage <= 1256) {
+    result.encoding = Encoding::Codepage;
+    result.codepage = codepage;
+    result.text = decodeCodepage(data, Codepages[codepage - 1250]);
+  } else {
+    result.text = data;  // left to mpv's own detection
+    return result;
+  }
+
+  if (looksLikeSrt(result.text)) {
+    int repairs = 0;
+    auto text = repairSrt(result.text, repairs);
+    if (!text.empty()) {  // no cue survived, better left alone
+      result.srt = true;
+      result.repairs = repairs;
+      result.text = std::move(text);
+    }
+  }
+  result.changed = result.text != data;
+  return result;
+}
+
+const char *encodingName(Encoding encoding) {
+  switch (encoding) {
+    case Encoding::Utf8:
+      return "UTF-8";
+    case Encoding::Utf8Bom:
+      return "UTF-8 BOM";
+    case Encoding::Utf16Le:
+      return "UTF-16LE";
+    case Encoding::Utf16Be:
+      return "UTF-16BE";
+    case Encoding::Codepage:
+      return "Codepage";
+    default:
+      return "Unknown";
+  }
+}
+}  // namespace ImPlay::SubtitleText
@@ -0,0 +1,44 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <vector>
+#include "helpers/startup.h"
+#include "helpers/trace.h"
+#include "helpers/task_graph.h"
+
+namespace ImPlay {
+TaskGraph::~TaskGraph() {
+  for (auto &node : nodes)
+    if (node.thread.joinable()) node.thread.join();
+}
+
+TaskGraph::Task TaskGraph::add(const char *name, std::function<void()> fn, std::initializer_list<Task> deps) {
+  std::vector<std::shared_future<void>> waits;
+  for (auto dep : deps) waits.push_back(nodes.at(dep).done);
+
+  std::promise<void> promise;
+  auto &node = nodes.emplace_back(Node{name, promise.get_future().share()});
+  node.thread = std::thread([name, fn = std::move(fn), waits = std::move(waits), promise = std::move(promise)]() mutable {
+    TRACE_THREAD(name);
+    try {
+      for (auto &dep : waits) dep.get();
+      double begin = Startup::now();
+      {
+        TRACE_ZONE(name);
+        fn();
+      }
+      Startup::task(name, begin);
+      promise.set_value();
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  });
+  return nodes.size() - 1;
+}
+
+void TaskGraph::wait(Task task) {
+  auto &node = nodes.at(task);
+  if (node.thread.joinable()) node.thread.join();
+  node.done.get();
+}
+}  // namespace ImPlay
@@ -0,0 +1,101 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include "helpers/trace.h"
+#ifdef IMPLAY_TRACING
+#include <array>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+
+namespace ImPlay::Trace {
+std::atomic<bool> recording = false;
+
+namespace {
+struct Event {
+  const char *name;
+  int64_t begin;
+  int64_t end;
+};
+
+// Single-writer ring, owned by the registry so it outlives its thread and can still be exported.
+struct Buffer {
+  static constexpr size_t Size = 1 << 15;
+
+  int tid = 0;
+  std::string name;
+  std::atomic<uint64_t> head = 0;
+  std::array<Event, Size> events;
+};
+
+std::mutex registryLock;
+std::vector<std::unique_ptr<Buffer>> registry;
+int64_t epoch = now();
+
+Buffer *threadBuffer() {
+  thread_local Buffer *buffer = nullptr;
+  if (buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(registryLock);
+    auto &b = registry.emplace_back(std::make_unique<Buffer>());
+    b->tid = (int)registry.size();
+    b->name = fmt::format("Thread {}", b->tid);
+    buffer = b.get();
+  }
+  return buffer;
+}
+}  // namespace
+
+void record(const char *name, int64_t begin, int64_t end) {
+  auto buffer = threadBuffer();
+  auto head = buffer->head.load(std::memory_order_relaxed);
+  buffer->events[head % Buffer::Size] = {name, begin, end};
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void setThreadName(const char *name) {
+  auto buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(registryLock);
+  buffer->name = name;
+}
+
+void start() {
+  {
+    std::lock_guard<std::mutex> lock(registryLock);
+    for (auto &b : registry) b->head.store(0, std::memory_order_relaxed);
+  }
+  recording = true;
+}
+
+void stop() { recording = false; }
+
+bool dump(const std::filesystem::path &path) {
+  bool active = recording.exchange(false);
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    recording = active;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(registryLock);
+  file << R"({"displayTimeUnit":"ms","traceEvents":[)";
+  file << R"({"name":"process_name","ph":"M","pid":1,"args":{"name":"PlayTorrioPlayer"}})";
+  for (auto &b : registry) {
+    file << fmt::format(R"(,{{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})", b->tid,
+                        b->name);
+    uint64_t head = b->head.load(std::memory_order_acquire);
+    uint64_t first = head > Buffer::Size ? head - Buffer::Size : 0;
+    for (uint64_t i = first; i < head; i++) {
+      auto &e = b->events[i % Buffer::Size];
+      file << fmt::format(R"(,{{"name":"{}","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f}}})", e.name, b->tid,
+                          (e.begin - epoch) / 1000.0, (e.end - e.begin) / 1000.0);
+    }
+  }
+  file << "]}\n";
+  recording = active;
+  return file.good();
+}
+}  // namespace ImPlay::Trace
+#endif
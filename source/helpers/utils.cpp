@@ -12,6 +12,9 @@
 #include <limits.h>
 #include <sysdir.h>
 #include <glob.h>
+#include <malloc/malloc.h>
+#elif defined(__linux__)
+#include <malloc.h>
 #endif
 #include "helpers/utils.h"
 
@@ -154,6 +157,16 @@ void revealInFolder(std::string path) {
 #endif
 }
 
+void releaseMemory() {
+#ifdef _WIN32
+  SetProcessWorkingSetSize(GetCurrentProcess(), (SIZE_T)-1, (SIZE_T)-1);
+#elif defined(__APPLE__)
+  malloc_zone_pressure_relief(nullptr, 0);
+#elif defined(__GLIBC__)
+  malloc_trim(0);
+#endif
+}
+
 std::filesystem::path dataPath() {
   std::string dataDir;
 #ifdef _WIN32
@@ -200,9 +213,26 @@ std::vector<std::string> split(const std::string& str, const std::string& sep) {
   return v;
 }
 
-bool findCase(std::string haystack, std::string needle) {
-  auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
-                        [](char ch1, char ch2) { return std::toupper(ch1) == std::toupper(ch2); });
-  return it != haystack.end();
+// Case-folded key whose plain byte order is natural order: each digit run becomes '0', its length
+// without leading zeros, then the digits, so shorter numbers sort first.
+std::string naturalKey(std::string_view str) {
+  std::string key;
+  key.reserve(str.size() + 8);
+  for (size_t i = 0; i < str.size();) {
+    char c = str[i];
+    if (c < '0' || c > '9') {
+      key.push_back(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+      i++;
+      continue;
+    }
+    while (i < str.size() - 1 && str[i] == '0' && str[i + 1] >= '0' && str[i + 1] <= '9') i++;
+    size_t end = i;
+    while (end < str.size() && str[end] >= '0' && str[end] <= '9') end++;
+    key.push_back('0');
+    key.push_back(static_cast<char>(std::min<size_t>(end - i, 255)));
+    key.append(str.substr(i, end - i));
+    i = end;
+  }
+  return key;
 }
 }  // namespace ImPlay
\ No newline at end of file
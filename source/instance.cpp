@@ -0,0 +1,354 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include <fmt/format.h>
+#include <fmt/color.h>
+#include <nlohmann/json.hpp>
+#include "helpers/startup.h"
+#include "helpers/trace.h"
+#include "instance.h"
+
+namespace ImPlay {
+namespace {
+constexpr int TimeoutMs = 2000;
+
+#ifdef _WIN32
+using Handle = HANDLE;
+
+bool readAll(Handle h, void *data, size_t size) {
+  auto p = static_cast<char *>(data);
+  while (size > 0) {
+    DWORD n = 0;
+    if (!ReadFile(h, p, (DWORD)size, &n, nullptr) || n == 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool writeAll(Handle h, const void *data, size_t size) {
+  auto p = static_cast<const char *>(data);
+  while (size > 0) {
+    DWORD n = 0;
+    if (!WriteFile(h, p, (DWORD)size, &n, nullptr)) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+#else
+using Handle = int;
+
+bool readAll(Handle fd, void *data, size_t size) {
+  auto p = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t n = ::read(fd, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool writeAll(Handle fd, const void *data, size_t size) {
+#ifdef MSG_NOSIGNAL
+  constexpr int flags = MSG_NOSIGNAL;
+#else
+  constexpr int flags = 0;
+#endif
+  auto p = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t n = ::send(fd, p, size, flags);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+void setTimeout(int fd, int ms) {
+  timeval tv{ms / 1000, (ms % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+int openSocket() {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd != -1) fcntl(fd, F_SETFD, FD_CLOEXEC);
+  return fd;
+}
+
+socklen_t toAddr(const std::string &address, sockaddr_un &addr) {
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  size_t len = std::min(address.size(), sizeof(addr.sun_path) - 1);
+  std::memcpy(addr.sun_path, address.data(), len);
+  return (socklen_t)(offsetof(sockaddr_un, sun_path) + len + (address[0] == '\0' ? 0 : 1));
+}
+#endif
+
+std::string frame(uint32_t magic, const std::string &payload) {
+  std::string buf(8, '\0');
+  uint32_t size = (uint32_t)payload.size();
+  for (int i = 0; i < 4; i++) {
+    buf[i] = (char)(magic >> (i * 8));
+    buf[4 + i] = (char)(size >> (i * 8));
+  }
+  return buf + payload;
+}
+
+uint32_t le32(const unsigned char *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+// Reads one frame, returns false on a short read, a wrong magic or an oversized payload.
+bool readFrame(Handle h, uint32_t magic, uint32_t max, std::string &payload) {
+  unsigned char head[8];
+  if (!readAll(h, head, sizeof(head)) || le32(head) != magic) return false;
+  uint32_t size = le32(head + 4);
+  if (size > max) return false;
+  payload.resize(size);
+  return size == 0 || readAll(h, payload.data(), size);
+}
+
+// Paths are resolved against the working directory of the launcher, not of the running instance.
+std::string absolute(const std::string &path) {
+  if (path == "-" || path.find("://") != std::string::npos) return path;
+  std::error_code ec;
+  auto p = std::filesystem::path(reinterpret_cast<const char8_t *>(path.c_str()));
+  if (!p.is_relative()) return path;
+  auto abs = std::filesystem::absolute(p, ec);
+  if (ec) return path;
+  auto str = abs.lexically_normal().u8string();
+  return std::string(reinterpret_cast<const char *>(str.data()), str.size());
+}
+}  // namespace
+
+Instance::~Instance() {
+  quit = true;
+#ifdef _WIN32
+  if (worker.joinable()) {
+    // unblock ConnectNamedPipe
+    HANDLE h = CreateFileA(address().c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+    worker.join();
+    if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
+  }
+  if (pipe != nullptr) CloseHandle(pipe);
+#else
+  if (wakeFd[1] != -1) (void)!write(wakeFd[1], "q", 1);
+  if (worker.joinable()) worker.join();
+  if (listenFd != -1) {
+    ::close(listenFd);
+    auto addr = address();
+    if (addr[0] != '\0') unlink(addr.c_str());
+  }
+  for (int fd : wakeFd)
+    if (fd != -1) ::close(fd);
+#endif
+}
+
+std::string Instance::address() {
+#ifdef _WIN32
+  DWORD session = 0;
+  ProcessIdToSessionId(GetCurrentProcessId(), &session);
+  return fmt::format("\\\\.\\pipe\\playtorrioplayer-{}", session);
+#elif defined(__linux__)
+  // abstract namespace: nothing to clean up after a crash
+  return fmt::format("{}playtorrioplayer-{}", '\0', getuid());
+#else
+  auto dir = getenv("TMPDIR");
+  std::string tmp = dir != nullptr && dir[0] != '\0' ? dir : "/tmp";
+  if (tmp.back() != '/') tmp += '/';
+  return fmt::format("{}playtorrioplayer-{}.sock", tmp, getuid());
+#endif
+}
+
+std::string Instance::encode(const OptionParser &request) {
+  nlohmann::json j;
+  auto &paths = j["paths"] = nlohmann::json::array();
+  for (auto &path : request.paths) paths.push_back(absolute(path));
+  j["options"] = request.options;
+  auto &providers = j["subtitle-providers"] = nlohmann::json::array();
+  for (auto &p : request.subtitleProviders) {
+    auto subs = nlohmann::json::array();
+    for (auto &s : p.subtitles) subs.push_back({{"name", s.name}, {"url", s.url}});
+    providers.push_back({{"name", p.name}, {"subtitles", subs}});
+  }
+  if (Startup::enabled()) {
+    std::u8string output;
+    if (auto path = Startup::output(); !path.empty()) output = std::filesystem::absolute(path).u8string();
+    j["startup-trace"] = {{"output", std::string(reinterpret_cast<const char *>(output.data()), output.size())},
+                          {"launched", Startup::launchTime()}};
+  }
+  return j.dump();
+}
+
+bool Instance::decode(const std::string &payload, OptionParser &request) {
+  try {
+    auto j = nlohmann::json::parse(payload);
+    request.paths = j.at("paths").get<std::vector<std::string>>();
+    request.options = j.at("options").get<std::map<std::string, std::string>>();
+    for (auto &p : j.at("subtitle-providers")) {
+      CmdSubtitleProvider provider{p.at("name").get<std::string>(), {}};
+      for (auto &s : p.at("subtitles"))
+        provider.subtitles.push_back({s.at("name").get<std::string>(), s.at("url").get<std::string>()});
+      request.subtitleProviders.push_back(std::move(provider));
+    }
+    if (auto it = j.find("startup-trace"); it != j.end()) {
+      request.traceOutput = it->at("output").get<std::string>();
+      request.traceLaunched = it->at("launched").get<double>();
+    }
+    return true;
+  } catch (const nlohmann::json::exception &e) {
+    fmt::print(fg(fmt::color::red), "Invalid instance request: {}\n", e.what());
+    return false;
+  }
+}
+
+bool Instance::forward(const OptionParser &request) {
+  TRACE_FUNC();
+  if (std::find(request.paths.begin(), request.paths.end(), "-") != request.paths.end()) return false;
+  auto data = frame(Magic, encode(request));
+  uint8_t status = 0;
+#ifdef _WIN32
+  auto addr = address();
+  HANDLE h = CreateFileA(addr.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+  if (h == INVALID_HANDLE_VALUE && GetLastError() == ERROR_PIPE_BUSY && WaitNamedPipeA(addr.c_str(), TimeoutMs))
+    h = CreateFileA(addr.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+  if (h == INVALID_HANDLE_VALUE) return false;
+  bool ok = writeAll(h, data.data(), data.size()) && readAll(h, &status, 1);
+  CloseHandle(h);
+#else
+  int fd = openSocket();
+  if (fd == -1) return false;
+  sockaddr_un addr;
+  socklen_t len = toAddr(address(), addr);
+  if (connect(fd, (sockaddr *)&addr, len) == -1) {
+    ::close(fd);
+    return false;
+  }
+  setTimeout(fd, TimeoutMs);
+  bool ok = writeAll(fd, data.data(), data.size()) && readAll(fd, &status, 1);
+  ::close(fd);
+#endif
+  if (ok && status != Status_Ok) fmt::print(fg(fmt::color::red), "Running instance rejected the request\n");
+  return ok && status == Status_Ok;
+}
+
+bool Instance::listen(Handler handler_) {
+  handler = std::move(handler_);
+#ifdef _WIN32
+  pipe = CreateNamedPipeA(address().c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                          PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                          PIPE_UNLIMITED_INSTANCES, 4096, 4096, 0, nullptr);
+  if (pipe == INVALID_HANDLE_VALUE) {
+    pipe = nullptr;
+    fmt::print(fg(fmt::color::red), "Failed to create instance pipe: {}\n", GetLastError());
+    return false;
+  }
+#else
+  auto address_ = address();
+  listenFd = openSocket();
+  if (listenFd == -1) return false;
+  sockaddr_un addr;
+  socklen_t len = toAddr(address_, addr);
+  bool bound = bind(listenFd, (sockaddr *)&addr, len) == 0;
+  if (!bound && errno == EADDRINUSE && address_[0] != '\0') {
+    // a socket file left behind by an instance that is no longer running
+    int probe = openSocket();
+    bool alive = probe != -1 && connect(probe, (sockaddr *)&addr, len) == 0;
+    if (probe != -1) ::close(probe);
+    if (!alive) bound = unlink(address_.c_str()) == 0 && bind(listenFd, (sockaddr *)&addr, len) == 0;
+  }
+  if (!bound || ::listen(listenFd, 8) == -1) {
+    fmt::print(fg(fmt::color::red), "Failed to listen for other instances: {}\n", strerror(errno));
+    ::close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+  if (::pipe(wakeFd) == 0) {
+    for (int fd : wakeFd) fcntl(fd, F_SETFD, FD_CLOEXEC);
+  } else {
+    wakeFd[0] = wakeFd[1] = -1;
+  }
+#endif
+  worker = std::thread(&Instance::run, this);
+  return true;
+}
+
+std::vector<OptionParser> Instance::take() {
+  std::lock_guard<std::mutex> l(lock);
+  return std::move(requests);
+}
+
+uint8_t Instance::receive(const std::string &payload) {
+  TRACE_FUNC();
+  OptionParser request;
+  if (!decode(payload, request)) return Status_Invalid;
+  {
+    std::lock_guard<std::mutex> l(lock);
+    requests.push_back(std::move(request));
+  }
+  if (handler) handler();
+  return Status_Ok;
+}
+
+void Instance::run() {
+  TRACE_THREAD("Instance listener");
+  std::string payload;
+#ifdef _WIN32
+  while (!quit) {
+    if (pipe == nullptr) {
+      pipe = CreateNamedPipeA(address().c_str(), PIPE_ACCESS_DUPLEX,
+                              PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                              PIPE_UNLIMITED_INSTANCES, 4096, 4096, 0, nullptr);
+      if (pipe == INVALID_HANDLE_VALUE) {
+        pipe = nullptr;
+        break;
+      }
+    }
+    bool connected = ConnectNamedPipe(pipe, nullptr) || GetLastError() == ERROR_PIPE_CONNECTED;
+    if (connected && !quit) {
+      uint8_t status =
+          readFrame(pipe, Magic, MaxFrame, payload) ? receive(payload) : static_cast<uint8_t>(Status_Invalid);
+      writeAll(pipe, &status, 1);
+      FlushFileBuffers(pipe);
+    }
+    DisconnectNamedPipe(pipe);
+    CloseHandle(pipe);
+    pipe = nullptr;
+  }
+#else
+  while (!quit) {
+    pollfd fds[] = {{listenFd, POLLIN, 0}, {wakeFd[0], POLLIN, 0}};
+    if (poll(fds, wakeFd[0] != -1 ? 2 : 1, wakeFd[0] != -1 ? -1 : 500) < 0 && errno != EINTR) break;
+    if (quit) break;
+    if (!(fds[0].revents & POLLIN)) continue;
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd == -1) continue;
+    setTimeout(fd, TimeoutMs);
+    uint8_t status = readFrame(fd, Magic, MaxFrame, payload) ? receive(payload) : static_cast<uint8_t>(Status_Invalid);
+    writeAll(fd, &status, 1);
+    ::close(fd);
+  }
+#endif
+}
+}  // namespace ImPlay
@@ -0,0 +1,608 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <fmt/format.h>
+#include <fmt/color.h>
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#include "helpers/trace.h"
+#include "helpers/utils.h"
+#include "library.h"
+
+namespace ImPlay {
+static constexpr char Separator = static_cast<char>(std::filesystem::path::preferred_separator);
+static constexpr size_t MaxDelta = 4096;
+
+static std::string toKey(const std::filesystem::path &path) {
+  auto str = path.lexically_normal().u8string();
+  std::string key(reinterpret_cast<const char *>(str.data()), str.size());
+  while (key.size() > 1 && key.back() == Separator) key.pop_back();
+  return key;
+}
+
+static std::filesystem::path fromKey(std::string_view key) {
+  return std::filesystem::path(std::u8string(reinterpret_cast<const char8_t *>(key.data()), key.size()));
+}
+
+static int64_t toTime(std::filesystem::file_time_type time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+static void lowercase(std::string &str) {
+  for (auto &c : str) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+static bool isMedia(MediaType type) {
+  return type == MediaType::Video || type == MediaType::Audio || type == MediaType::Image;
+}
+
+// Sort key of a path relative to a folder, giving the order the folder scanner plays in:
+// the files of a folder first, then each subfolder, all in natural order.
+static std::string folderKey(std::string_view path) {
+  std::string key;
+  for (size_t start = 0;;) {
+    size_t end = path.find(Separator, start);
+    bool last = end == std::string_view::npos;
+    key.push_back(last ? '\1' : '\2');
+    key.append(naturalKey(path.substr(start, last ? std::string_view::npos : end - start)));
+    if (last) return key;
+    key.push_back('\0');
+    start = end + 1;
+  }
+}
+
+MediaLibrary::MediaLibrary(Config *config) : config(config) {}
+
+MediaLibrary::~MediaLibrary() {
+  {
+    std::lock_guard<std::mutex> l(waitLock);
+    quit = true;
+  }
+  cond.notify_all();
+#ifdef __linux__
+  if (wakeFd[1] != -1) (void)!write(wakeFd[1], "q", 1);
+#endif
+  if (worker.joinable()) worker.join();
+#ifdef __linux__
+  if (inotifyFd != -1) ::close(inotifyFd);
+  for (int fd : wakeFd)
+    if (fd != -1) ::close(fd);
+#endif
+}
+
+void MediaLibrary::start() {
+  {
+    std::lock_guard<std::mutex> l(waitLock);
+    for (auto &folder : config->Data.Library.Folders) folders.emplace_back(fromKey(folder));
+  }
+  {
+    std::unique_lock<std::shared_mutex> l(lock);
+    openIndex();
+  }
+#ifdef __linux__
+  inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (pipe2(wakeFd, O_NONBLOCK | O_CLOEXEC) != 0) wakeFd[0] = wakeFd[1] = -1;
+#endif
+  worker = std::thread(&MediaLibrary::run, this);
+}
+
+void MediaLibrary::rescan() {
+  {
+    std::lock_guard<std::mutex> l(waitLock);
+    pending = true;
+  }
+  cond.notify_all();
+#ifdef __linux__
+  if (wakeFd[1] != -1) (void)!write(wakeFd[1], "r", 1);
+#endif
+}
+
+void MediaLibrary::addFolder(const std::filesystem::path &folder) {
+  auto key = toKey(folder);
+  auto &list = config->Data.Library.Folders;
+  if (std::find(list.begin(), list.end(), key) != list.end()) return;
+  list.push_back(key);
+  {
+    std::lock_guard<std::mutex> l(waitLock);
+    folders.emplace_back(fromKey(key));
+  }
+  rescan();
+}
+
+std::optional<std::vector<std::string>> MediaLibrary::folder(const std::filesystem::path &folder) const {
+  if (busy) return std::nullopt;
+
+  auto key = toKey(folder);
+  std::vector<std::pair<std::string, std::string>> items;
+  {
+    std::shared_lock<std::shared_mutex> l(lock);
+    auto entry = find(key);
+    if (!entry || entry->type != DirectoryType) return std::nullopt;
+    forEach(key + Separator, [&](std::string_view path, const Entry &e) {
+      if (e.type != DirectoryType) items.emplace_back(folderKey(path.substr(key.size() + 1)), path);
+    });
+  }
+
+  parallelSort(items.begin(), items.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+  std::vector<std::string> paths;
+  paths.reserve(items.size());
+  for (auto &[_, path] : items) paths.push_back(std::move(path));
+  return paths;
+}
+
+std::vector<MediaLibrary::Item> MediaLibrary::search(std::string_view query, size_t limit) const {
+  std::vector<std::string> words;
+  for (auto &word : split(tolower(std::string(query)), " "))
+    if (!word.empty()) words.push_back(word);
+  if (words.empty() || limit == 0) return {};
+
+  std::vector<std::pair<int, Item>> hits;
+  auto match = [&](std::string_view path, std::string_view lower, const Entry &e) {
+    size_t name = lower.rfind(Separator);
+    name = name == std::string_view::npos ? 0 : name + 1;
+
+    int rank = 0;
+    for (auto &word : words) {
+      auto pos = lower.find(word);
+      if (pos == std::string_view::npos) return;
+      if (pos < name) rank = 1;
+    }
+    hits.push_back({rank, {std::string(path), e.size, e.mtime, e.duration, static_cast<MediaType>(e.type)}});
+  };
+  {
+    std::shared_lock<std::shared_mutex> l(lock);
+    // mapped records match against the lowercased blob, only the (small) delta is lowercased here
+    for (size_t i = 0, n = count(); i < n; i++) {
+      auto r = record(i);
+      if (r.type == DirectoryType || r.pathOffset + r.pathLength > names.size()) continue;
+      auto path = recordPath(r);
+      if (delta.find(path) != delta.end()) continue;
+      auto lower = std::string_view(names).substr(r.pathOffset, r.pathLength);
+      match(path, lower, Entry{r.type, r.size, r.mtime, r.duration});
+    }
+    std::string lower;
+    for (auto &[path, e] : delta) {
+      if (!e || e->type == DirectoryType) continue;
+      lower.assign(path);
+      lowercase(lower);
+      match(path, lower, *e);
+    }
+  }
+
+  auto less = [](const auto &a, const auto &b) {
+    return a.first != b.first ? a.first < b.first : a.second.path < b.second.path;
+  };
+  size_t n = std::min(limit, hits.size());
+  std::partial_sort(hits.begin(), hits.begin() + n, hits.end(), less);
+  std::vector<Item> items;
+  items.reserve(n);
+  for (size_t i = 0; i < n; i++) items.push_back(std::move(hits[i].second));
+  return items;
+}
+
+void MediaLibrary::setDuration(const std::string &path, double duration) {
+  auto key = toKey(fromKey(path));
+  std::unique_lock<std::shared_mutex> l(lock);
+  auto entry = find(key);
+  if (!entry || entry->type == DirectoryType || entry->duration == duration) return;
+  entry->duration = duration;
+  delta[key] = entry;
+}
+
+size_t MediaLibrary::count() const {
+  if (!index.valid() || index.size() < sizeof(Header)) return 0;
+  Header header;
+  std::memcpy(&header, index.data(), sizeof(Header));
+  return header.count;
+}
+
+MediaLibrary::Record MediaLibrary::record(size_t i) const {
+  Record r;
+  std::memcpy(&r, index.data() + sizeof(Header) + i * sizeof(Record), sizeof(Record));
+  return r;
+}
+
+std::string_view MediaLibrary::recordPath(const Record &r) const {
+  size_t blob = sizeof(Header) + count() * sizeof(Record);
+  if (r.pathOffset + r.pathLength > index.size() - blob) return {};
+  return {reinterpret_cast<const char *>(index.data()) + blob + r.pathOffset, r.pathLength};
+}
+
+size_t MediaLibrary::lowerBound(std::string_view path) const {
+  size_t lo = 0, hi = count();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (recordPath(record(mid)) < path)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+std::optional<MediaLibrary::Entry> MediaLibrary::find(std::string_view path) const {
+  if (auto it = delta.find(path); it != delta.end()) return it->second;
+  size_t i = lowerBound(path);
+  if (i == count()) return std::nullopt;
+  auto r = record(i);
+  if (recordPath(r) != path) return std::nullopt;
+  return Entry{r.type, r.size, r.mtime, r.duration};
+}
+
+// Visits every entry whose path starts with prefix, unordered: mapped records first, then the delta.
+template <typename Fn>
+void MediaLibrary::forEach(std::string_view prefix, Fn fn) const {
+  for (size_t i = lowerBound(prefix), n = count(); i < n; i++) {
+    auto r = record(i);
+    auto path = recordPath(r);
+    if (!path.starts_with(prefix)) break;
+    if (delta.find(path) == delta.end()) fn(path, Entry{r.type, r.size, r.mtime, r.duration});
+  }
+  for (auto it = delta.lower_bound(prefix); it != delta.end(); ++it) {
+    if (!it->first.starts_with(prefix)) break;
+    if (it->second) fn(it->first, *it->second);
+  }
+}
+
+void MediaLibrary::put(const std::string &path, std::optional<Entry> entry) {
+  std::unique_lock<std::shared_mutex> l(lock);
+  auto old = find(path);
+  if (!old && !entry) return;
+  bool wasFile = old && old->type != DirectoryType;
+  bool isFile = entry && entry->type != DirectoryType;
+  delta[path] = entry;
+  if (wasFile != isFile) isFile ? files++ : files--;
+}
+
+void MediaLibrary::removeTree(const std::string &path) {
+  std::vector<std::string> children;
+  {
+    std::shared_lock<std::shared_mutex> l(lock);
+    forEach(path + Separator, [&](std::string_view child, const Entry &) { children.emplace_back(child); });
+  }
+  for (auto &child : children) put(child, std::nullopt);
+  put(path, std::nullopt);
+}
+
+void MediaLibrary::run() {
+  TRACE_THREAD("Media library");
+  bool force = false;
+  while (!quit) {
+    busy = true;
+    {
+      TRACE_ZONE("MediaLibrary::reconcile");
+      for (auto &root : roots()) {
+        if (quit) break;
+        reconcile(root, force);
+      }
+    }
+    compact();
+    busy = false;
+    force = false;
+
+#ifdef __linux__
+    if (inotifyFd != -1 && wakeFd[0] != -1) {
+      bool dirty = false;
+      while (!quit) {
+        pollfd fds[] = {{inotifyFd, POLLIN, 0}, {wakeFd[0], POLLIN, 0}};
+        // changes are merged into the index once the tree has been quiet for a moment
+        int ret = poll(fds, 2, dirty ? 2000 : -1);
+        if (ret < 0 && errno != EINTR) break;
+        if (ret == 0) {
+          compact();
+          dirty = false;
+          continue;
+        }
+        if (fds[1].revents & POLLIN) {
+          char buf[64];
+          while (read(wakeFd[0], buf, sizeof(buf)) > 0) {
+          }
+          std::lock_guard<std::mutex> l(waitLock);
+          if (pending) break;
+        }
+        if (fds[0].revents & POLLIN) {
+          if (!handleEvents()) {
+            force = true;  // queue overflow, events were lost
+            break;
+          }
+          dirty = true;
+          std::shared_lock<std::shared_mutex> l(lock);
+          if (delta.size() > MaxDelta) {
+            l.unlock();
+            compact();
+            dirty = false;
+          }
+        }
+      }
+      std::lock_guard<std::mutex> l(waitLock);
+      pending = false;
+      continue;
+    }
+#endif
+    waitForChanges();
+  }
+}
+
+void MediaLibrary::waitForChanges() {
+  std::unique_lock<std::mutex> l(waitLock);
+  cond.wait(l, [this] { return quit || pending; });
+  pending = false;
+}
+
+// Brings the index of dir and everything below it in line with the disk. A folder is only
+// listed when its mtime differs from the indexed one, unless force is set; otherwise its
+// children are as indexed and only the indexed subfolders are visited.
+void MediaLibrary::reconcile(const std::filesystem::path &dir, bool force) {
+  if (quit) return;
+  auto key = toKey(dir);
+  std::error_code ec;
+  auto mtime = std::filesystem::last_write_time(dir, ec);
+  if (ec || !std::filesystem::is_directory(dir, ec)) {
+    removeTree(key);
+    return;
+  }
+#ifdef __linux__
+  watch(dir);
+#endif
+
+  std::optional<Entry> known;
+  {
+    std::shared_lock<std::shared_mutex> l(lock);
+    known = find(key);
+  }
+  auto prefix = key + Separator;
+  std::vector<std::filesystem::path> subdirs;
+  if (!force && known && known->type == DirectoryType && known->mtime == toTime(mtime)) {
+    std::shared_lock<std::shared_mutex> l(lock);
+    forEach(prefix, [&](std::string_view path, const Entry &e) {
+      if (e.type == DirectoryType && path.find(Separator, prefix.size()) == std::string_view::npos)
+        subdirs.push_back(fromKey(path));
+    });
+  } else {
+    std::vector<std::filesystem::path> entries;
+    auto options = std::filesystem::directory_options::skip_permission_denied;
+    for (std::filesystem::directory_iterator it(dir, options, ec), end; !ec && it != end; it.increment(ec)) {
+      std::error_code err;
+      if (it->is_directory(err) && !it->is_symlink(err))
+        subdirs.push_back(it->path());
+      else if (it->is_regular_file(err))
+        entries.push_back(it->path());
+    }
+
+    std::set<std::string> present;
+    for (auto &path : entries) present.insert(toKey(path));
+    for (auto &path : subdirs) present.insert(toKey(path));
+
+    std::vector<std::pair<std::string, bool>> gone;
+    {
+      std::shared_lock<std::shared_mutex> l(lock);
+      forEach(prefix, [&](std::string_view path, const Entry &e) {
+        if (path.find(Separator, prefix.size()) != std::string_view::npos) return;  // not a direct child
+        if (!present.contains(std::string(path))) gone.emplace_back(path, e.type == DirectoryType);
+      });
+    }
+    for (auto &[path, isDir] : gone) isDir ? removeTree(path) : put(path, std::nullopt);
+    for (auto &path : entries) updateFile(path);
+    // written last: a folder record marks its files as complete
+    put(key, Entry{DirectoryType, 0, toTime(mtime), 0});
+  }
+
+  for (auto &path : subdirs) reconcile(path, force);
+}
+
+void MediaLibrary::updateFile(const std::filesystem::path &path) {
+  auto key = toKey(path);
+  auto type = mediaTypeOf(path);
+  if (type == MediaType::None && config->Data.Mpv.SniffMedia) type = sniffMediaType(path);
+  if (!isMedia(type)) {
+    put(key, std::nullopt);
+    return;
+  }
+
+  std::error_code ec;
+  uint64_t size = std::filesystem::file_size(path, ec);
+  if (ec) return put(key, std::nullopt);
+  int64_t mtime = toTime(std::filesystem::last_write_time(path, ec));
+  if (ec) return put(key, std::nullopt);
+
+  std::optional<Entry> old;
+  {
+    std::shared_lock<std::shared_mutex> l(lock);
+    old = find(key);
+  }
+  Entry entry{static_cast<uint32_t>(type), size, mtime, 0};
+  if (old && old->size == size && old->mtime == mtime) {
+    if (old->type == entry.type) return;
+    entry.duration = old->duration;
+  }
+  put(key, entry);
+}
+
+// Keeps the recorded mtime of a folder current after applying watch events to it,
+// so that the next startup does not relist it.
+void MediaLibrary::updateFolder(const std::filesystem::path &dir) {
+  std::error_code ec;
+  auto mtime = std::filesystem::last_write_time(dir, ec);
+  if (!ec) put(toKey(dir), Entry{DirectoryType, 0, toTime(mtime), 0});
+}
+
+// Merges the delta into a new index file and swaps it in. Entries outside of the configured
+// folders are dropped on the way.
+void MediaLibrary::compact() {
+  TRACE_ZONE("MediaLibrary::compact");
+  std::vector<std::string> prefixes;
+  for (auto &root : roots()) prefixes.push_back(toKey(root));
+  auto inRoots = [&](std::string_view path) {
+    for (auto &prefix : prefixes)
+      if (path.starts_with(prefix) && (path.size() == prefix.size() || path[prefix.size()] == Separator)) return true;
+    return false;
+  };
+
+  // Readers keep going while the new index is built and written, the exclusive lock is only
+  // taken to swap it in.
+  std::vector<Record> records;
+  std::string blob;
+  size_t total = 0;
+  std::map<std::string, std::optional<Entry>, std::less<>> merged;
+  {
+    std::shared_lock<std::shared_mutex> l(lock);
+    if (delta.empty() && index.valid()) {
+      // still drop removed folders
+      bool stale = false;
+      for (size_t i = 0, n = count(); i < n && !stale; i++) stale = !inRoots(recordPath(record(i)));
+      if (!stale) return;
+    }
+    merged = delta;
+
+    auto add = [&](std::string_view path, const Entry &e) {
+      if (!inRoots(path)) return;
+      records.push_back({blob.size(), static_cast<uint32_t>(path.size()), e.type, e.size, e.mtime, e.duration});
+      blob.append(path);
+      if (e.type != DirectoryType) total++;
+    };
+
+    size_t i = 0, n = count();
+    auto it = merged.begin();
+    records.reserve(n + merged.size());
+    while (i < n || it != merged.end()) {
+      auto r = i < n ? record(i) : Record{};
+      auto path = i < n ? recordPath(r) : std::string_view{};
+      if (it != merged.end() && (i == n || std::string_view(it->first) <= path)) {
+        if (i < n && it->first == path) i++;
+        if (it->second) add(it->first, *it->second);
+        ++it;
+      } else {
+        add(path, Entry{r.type, r.size, r.mtime, r.duration});
+        i++;
+      }
+    }
+  }
+
+  auto target = indexPath();
+  auto tmp = target;
+  tmp += ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    Header header{Magic, Version, records.size()};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(Record));
+    file.write(blob.data(), blob.size());
+    if (!file) {
+      fmt::print(fg(fmt::color::red), "Failed to write media library index: {}\n", tmp.string());
+      return;
+    }
+  }
+  lowercase(blob);
+
+  std::unique_lock<std::shared_mutex> l(lock);
+  index.close();
+  std::error_code ec;
+  std::filesystem::rename(tmp, target, ec);
+  if (ec) {
+    fmt::print(fg(fmt::color::red), "Failed to replace media library index: {}\n", ec.message());
+    std::filesystem::remove(tmp, ec);
+    openIndex();
+    return;  // the delta still holds every change on top of the old index
+  }
+  if (!openIndex(std::move(blob))) {
+    fmt::print(fg(fmt::color::red), "Failed to map media library index\n");
+    return;
+  }
+  // durations set while the file was written are not in it yet
+  for (auto &[path, entry] : merged)
+    if (auto it = delta.find(path); it != delta.end() && it->second == entry) delta.erase(it);
+  files = total;
+}
+
+// Maps the index file, discarding it when the header does not check out. names is the lowercased
+// path blob when the caller has it already. Call with lock held.
+bool MediaLibrary::openIndex(std::string names) {
+  this->names.clear();
+  if (!index.open(indexPath())) return false;
+  Header header{};
+  if (index.size() >= sizeof(Header)) std::memcpy(&header, index.data(), sizeof(Header));
+  if (header.magic != Magic || header.version != Version ||
+      header.count > (index.size() - sizeof(Header)) / sizeof(Record)) {
+    index.close();
+    return false;
+  }
+  if (names.empty()) {
+    size_t blob = sizeof(Header) + header.count * sizeof(Record);
+    names.assign(reinterpret_cast<const char *>(index.data()) + blob, index.size() - blob);
+    lowercase(names);
+  }
+  this->names = std::move(names);
+  size_t total = 0;
+  for (size_t i = 0; i < header.count; i++)
+    if (record(i).type != DirectoryType) total++;
+  files = total;
+  return true;
+}
+
+std::filesystem::path MediaLibrary::indexPath() const { return dataPath() / "library.idx"; }
+
+std::vector<std::filesystem::path> MediaLibrary::roots() const {
+  std::lock_guard<std::mutex> l(waitLock);
+  return folders;
+}
+
+#ifdef __linux__
+void MediaLibrary::watch(const std::filesystem::path &dir) {
+  if (inotifyFd == -1) return;
+  uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_ONLYDIR;
+  int wd = inotify_add_watch(inotifyFd, dir.c_str(), mask);
+  if (wd >= 0) watches[wd] = dir;
+}
+
+// Applies queued inotify events to the delta. Returns false when the kernel queue overflowed.
+bool MediaLibrary::handleEvents() {
+  TRACE_ZONE("MediaLibrary::handleEvents");
+  alignas(inotify_event) char buf[64 * 1024];
+  bool ok = true;
+  for (;;) {
+    ssize_t len = read(inotifyFd, buf, sizeof(buf));
+    if (len <= 0) break;
+    for (char *p = buf; p < buf + len;) {
+      auto *event = reinterpret_cast<inotify_event *>(p);
+      p += sizeof(inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        ok = false;
+        continue;
+      }
+      auto it = watches.find(event->wd);
+      if (it == watches.end()) continue;
+      if (event->mask & IN_IGNORED) {
+        watches.erase(it);
+        continue;
+      }
+      if (event->len == 0) continue;
+
+      auto dir = it->second;
+      auto path = dir / event->name;
+      if (event->mask & IN_ISDIR) {
+        if (event->mask & (IN_CREATE | IN_MOVED_TO))
+          reconcile(path);
+        else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+          removeTree(toKey(path));
+      } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+        updateFile(path);
+      } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        put(toKey(path), std::nullopt);
+      } else {
+        continue;
+      }
+      updateFolder(dir);
+    }
+  }
+  return ok;
+}
+#endif
+}  // namespace ImPlay
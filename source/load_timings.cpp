@@ -0,0 +1,201 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include "helpers/trace.h"
+#include "load_timings.h"
+
+namespace ImPlay {
+LoadTimings::LoadTimings(Mpv *mpv) : mpv(mpv) {}
+
+LoadTimings::~LoadTimings() {
+  quit = true;
+  if (client != nullptr) mpv_wakeup(client);
+  if (worker.joinable()) worker.join();
+  if (client != nullptr) mpv_destroy(client);
+}
+
+void LoadTimings::start(const std::filesystem::path &log) {
+  logPath = log;
+  client = mpv->createClient("load-timings");
+  if (client == nullptr) return;
+  mpv_request_log_messages(client, "v");
+  worker = std::thread(&LoadTimings::run, this);
+}
+
+void LoadTimings::videoRendered() {
+  if (!awaitingFrame.load(std::memory_order_relaxed) || !awaitingFrame.exchange(false)) return;
+  record(Stage_FirstFrame, std::chrono::steady_clock::now());
+  mpv_wakeup(client);  // let the worker see the item is complete
+}
+
+std::vector<LoadTimings::Item> LoadTimings::items() {
+  std::lock_guard<std::mutex> l(lock);
+  return {finished.begin(), finished.end()};
+}
+
+std::map<std::string, LoadTimings::Stats> LoadTimings::stats() {
+  std::lock_guard<std::mutex> l(lock);
+  return sources;
+}
+
+const char *LoadTimings::stageName(Stage_ stage) {
+  static const char *names[] = {"connect", "probe", "loaded", "video-reconfig", "first-frame", "first-audio"};
+  return names[stage];
+}
+
+std::string LoadTimings::sourceOf(const std::string &path) {
+  auto scheme = path.find("://");
+  if (scheme == std::string::npos || path.compare(0, scheme, "file") == 0) return "local";
+  auto protocol = path.substr(0, scheme);
+  if (protocol != "http" && protocol != "https") return protocol;
+  auto host = path.substr(scheme + 3, path.find_first_of("/?#", scheme + 3) - scheme - 3);
+  if (auto at = host.rfind('@'); at != std::string::npos) host.erase(0, at + 1);
+  return protocol + "://" + host;
+}
+
+std::string LoadTimings::redact(const std::string &path) {
+  auto scheme = path.find("://");
+  if (scheme == std::string::npos) return path;
+  auto url = path.substr(0, path.find_first_of("?#", scheme + 3));
+  auto authority = url.find('/', scheme + 3);
+  if (auto at = url.rfind('@', authority); at != std::string::npos && at > scheme)
+    url.erase(scheme + 3, at - scheme - 2);
+  return url;
+}
+
+void LoadTimings::run() {
+  while (!quit) {
+    mpv_event *event = mpv_wait_event(client, 1);
+    auto now = std::chrono::steady_clock::now();
+    switch (event->event_id) {
+      case MPV_EVENT_SHUTDOWN:
+        return;
+      case MPV_EVENT_START_FILE: {
+        char *path = mpv_get_property_string(client, "path");
+        std::lock_guard<std::mutex> l(lock);
+        if (active) finish("aborted");
+        current = {path ? path : "", "", "", {}};
+        current.ms.fill(-1);
+        mpv_free(path);
+        started = now;
+        active = true;
+        expectVideo = expectAudio = false;
+        awaitingFrame = false;
+        mpv_observe_property(client, AudioPtsId, "audio-pts", MPV_FORMAT_DOUBLE);
+        break;
+      }
+      case MPV_EVENT_LOG_MESSAGE: {
+        auto msg = static_cast<mpv_event_log_message *>(event->data);
+        if (strcmp(msg->prefix, "demux") != 0) break;
+        if (strncmp(msg->text, "Trying demuxers", 15) == 0) record(Stage_Connect, now);
+        if (strncmp(msg->text, "Detected file format", 20) == 0) record(Stage_Probe, now);
+        break;
+      }
+      case MPV_EVENT_FILE_LOADED: {
+        char *path = mpv_get_property_string(client, "path");
+        char *vid = mpv_get_property_string(client, "vid");
+        char *aid = mpv_get_property_string(client, "aid");
+        {
+          std::lock_guard<std::mutex> l(lock);
+          if (path) current.path = path;  // redirects and playlists resolve to the real URL
+          expectVideo = vid && strcmp(vid, "no") != 0;
+          expectAudio = aid && strcmp(aid, "no") != 0;
+        }
+        mpv_free(path);
+        mpv_free(vid);
+        mpv_free(aid);
+        record(Stage_Loaded, now);
+        break;
+      }
+      case MPV_EVENT_VIDEO_RECONFIG: {
+        std::lock_guard<std::mutex> l(lock);
+        if (!active || current.ms[Stage_VideoConfig] >= 0) break;
+        current.ms[Stage_VideoConfig] = std::chrono::duration<double, std::milli>(now - started).count();
+        awaitingFrame = true;
+        break;
+      }
+      case MPV_EVENT_PROPERTY_CHANGE: {
+        auto prop = static_cast<mpv_event_property *>(event->data);
+        if (event->reply_userdata != AudioPtsId || prop->format != MPV_FORMAT_DOUBLE) break;
+        record(Stage_FirstAudio, now);
+        mpv_unobserve_property(client, AudioPtsId);
+        break;
+      }
+      case MPV_EVENT_END_FILE: {
+        auto end = static_cast<mpv_event_end_file *>(event->data);
+        std::lock_guard<std::mutex> l(lock);
+        if (!active) break;
+        if (end->reason == MPV_END_FILE_REASON_ERROR)
+          finish("error");
+        else
+          finish(end->reason == MPV_END_FILE_REASON_EOF ? "ok" : "aborted");
+        break;
+      }
+      default:
+        break;
+    }
+
+    std::lock_guard<std::mutex> l(lock);
+    if (!active) continue;
+    auto &ms = current.ms;
+    if (ms[Stage_Loaded] >= 0 && (!expectVideo || ms[Stage_FirstFrame] >= 0) &&
+        (!expectAudio || ms[Stage_FirstAudio] >= 0))
+      finish("ok");
+    else if (now - started > std::chrono::seconds(TimeoutSecs))
+      finish("timeout");
+  }
+}
+
+void LoadTimings::record(Stage_ stage, std::chrono::steady_clock::time_point at) {
+  std::lock_guard<std::mutex> l(lock);
+  if (!active || current.ms[stage] >= 0) return;
+  current.ms[stage] = std::chrono::duration<double, std::milli>(at - started).count();
+}
+
+void LoadTimings::finish(const char *result) {
+  TRACE_FUNC();
+  active = false;
+  awaitingFrame = false;
+  mpv_unobserve_property(client, AudioPtsId);
+
+  current.result = result;
+  current.source = sourceOf(current.path);
+  auto &stats = sources[current.source];
+  stats.count++;
+  for (int i = 0; i < Stage_COUNT; i++) {
+    if (current.ms[i] < 0) continue;
+    stats.reached[i]++;
+    stats.total[i] += current.ms[i];
+    stats.worst[i] = std::max(stats.worst[i], current.ms[i]);
+  }
+  write(current);
+  finished.push_back(std::move(current));
+  if (finished.size() > MaxItems) finished.pop_front();
+}
+
+void LoadTimings::write(const Item &item) {
+  if (logPath.empty()) return;
+  std::error_code ec;
+  // file_size is (uintmax_t)-1 on error, a missing log must not be rotated
+  if (auto size = std::filesystem::file_size(logPath, ec); !ec && size > MaxLogSize) {
+    auto old = logPath;
+    std::filesystem::rename(logPath, old.concat(".1"), ec);
+  }
+
+  using namespace std::chrono;
+  auto startedAt = system_clock::now() - duration_cast<system_clock::duration>(steady_clock::now() - started);
+  nlohmann::json j;
+  j["time"] = duration_cast<milliseconds>(startedAt.time_since_epoch()).count();
+  j["path"] = redact(item.path);
+  j["source"] = item.source;
+  j["result"] = item.result;
+  for (int i = 0; i < Stage_COUNT; i++)
+    j[stageName((Stage_)i)] = item.ms[i] >= 0 ? nlohmann::json(item.ms[i]) : nlohmann::json(nullptr);
+  std::ofstream file(logPath, std::ios::app);
+  file << j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << '\n';
+}
+}  // namespace ImPlay
@@ -8,14 +8,11 @@
 #include <ctime>
 #ifdef _WIN32
 #include <windows.h>
-#else
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <sys/un.h>
 #endif
-#include <nlohmann/json.hpp>
+#include "helpers/startup.h"
+#include "helpers/trace.h"
 #include "helpers/utils.h"
+#include "instance.h"
 #include "window.h"
 
 // Dummy log file for compatibility (logging disabled in release)
@@ -40,6 +37,10 @@ static const char* usage =
     " - Subtitles are NOT loaded automatically, only shown in the menu\n"
     "\n"
     "Basic options:\n"
+    " --trace=<file>    record tracing zones and write a Chrome trace to file on exit\n"
+    " --startup-trace[=<file>]\n"
+    "                   print startup phase timings, or write them as JSON to file\n"
+    " --daemon          start hidden and stay resident, later launches open in it\n"
     " --start=<time>    seek to given (percent, seconds, or hh:mm:ss) position\n"
     " --no-audio        do not play sound\n"
     " --no-video        do not play video\n"
@@ -76,52 +77,6 @@ static int run_headless(ImPlay::OptionParser& parser) {
   return 0;
 }
 
-static std::string build_ipc_cmd(std::string path) {
-  nlohmann::json j = {{"command", {"loadfile", path, "append-play"}}};
-  return fmt::format("{}\n", j.dump());
-}
-
-#ifdef _WIN32
-static bool send_ipc(std::string sock, std::vector<std::string> paths) {
-  HANDLE hPipe = CreateFile(sock.c_str(), GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
-  if (hPipe == INVALID_HANDLE_VALUE) return false;
-
-  for (auto& path : paths) {
-    std::string payload = build_ipc_cmd(path);
-    if (!WriteFile(hPipe, payload.c_str(), payload.size(), NULL, NULL)) {
-      fmt::print("WriteFile failed: {}, payload: {}\n", GetLastError(), payload);
-    }
-  }
-
-  CloseHandle(hPipe);
-  return true;
-}
-#else
-static bool send_ipc(std::string sock, std::vector<std::string> paths) {
-  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
-  if (fd == -1) return false;
-
-  struct sockaddr_un addr;
-  addr.sun_family = AF_UNIX;
-  strncpy(addr.sun_path, sock.c_str(), sizeof(addr.sun_path) - 1);
-
-  if ((connect(fd, (struct sockaddr*)&addr, sizeof(addr))) == -1) {
-    close(fd);
-    return false;
-  }
-
-  for (auto& path : paths) {
-    std::string payload = build_ipc_cmd(path);
-    if (write(fd, payload.c_str(), payload.size()) == -1) {
-      fmt::print("write failed: {}, payload: {}\n", errno, payload);
-    }
-  }
-
-  close(fd);
-  return true;
-}
-#endif
-
 int main(int argc, char* argv[]) {
 #ifdef _WIN32
   SetProcessDPIAware();
@@ -140,21 +95,45 @@ int main(int argc, char* argv[]) {
       return run_headless(parser);
     }
 
-    ImPlay::Config config;
-    config.load();
-
-    if (config.Data.Window.Single && send_ipc(config.ipcSocket(), parser.paths)) {
+    std::filesystem::path tracePath;
+    if (auto it = parser.options.find("trace"); it != parser.options.end()) {
+      tracePath = reinterpret_cast<const char8_t*>(it->second.c_str());
+      parser.options.erase(it);
+      ImPlay::Trace::start();
+    }
+    if (auto it = parser.options.find("startup-trace"); it != parser.options.end()) {
+      std::filesystem::path output;
+      if (it->second != "yes") output = reinterpret_cast<const char8_t*>(it->second.c_str());
+      parser.options.erase(it);
+      ImPlay::Startup::enable(output, !parser.paths.empty());
+    }
+    ImPlay::Startup::mark("parse-options");
+
+    bool daemon = parser.options.erase("daemon") > 0;
+    // only a daemon or an instance running with Window.Single listens, so this needs no config
+    if (!daemon && ImPlay::Instance::forward(parser)) {
+      ImPlay::Startup::mark("instance-handoff");
+      // a trace written to a file is finished by the instance that plays the media
+      if (ImPlay::Startup::output().empty()) ImPlay::Startup::report();
       return 0;
     }
+    ImPlay::Startup::mark("instance-check");
+
+    ImPlay::Config config;
+    config.load();
+    ImPlay::Startup::mark("load-config");
 
     ImPlay::Window window(&config);
     
-    if (!window.init(parser)) {
+    if (!window.init(parser, daemon)) {
       return 1;
     }
 
     window.run();
-    
+    ImPlay::Startup::report();
+    if (!tracePath.empty() && !ImPlay::Trace::dump(tracePath))
+      fmt::print(fg(fmt::color::red), "Failed to write trace: {}\n", tracePath.string());
+
     return 0;
   } catch (const std::exception& e) {
     fmt::print(fg(fmt::color::red), "Error: {}\n", e.what());
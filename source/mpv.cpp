@@ -8,6 +8,7 @@
 #include <cstring>
 #include <atomic>
 #include <nlohmann/json.hpp>
+#include "helpers/trace.h"
 #include "mpv.h"
 
 namespace ImPlay {
@@ -20,7 +21,7 @@ Mpv::Mpv() {
 
 Mpv::~Mpv() {
   if (renderCtx != nullptr) mpv_render_context_free(renderCtx);
-  mpv_unobserve_property(mpv, 0);
+  for (const auto &[id, format, handler] : propertyEvents) mpv_unobserve_property(mpv, id);
   mpv_destroy(main);
   mpv_destroy(mpv);
 }
@@ -35,21 +36,115 @@ int Mpv::commandv(const char *arg, ...) {
   return mpv_command_async(mpv, 0, args.data());
 }
 
+int Mpv::loadfile(const char *url, const char *flags, const std::map<std::string, std::string> &options) {
+  std::vector<mpv_node> values;
+  std::vector<char *> keys;
+  for (auto &[key, value] : options) {
+    mpv_node node{};
+    node.format = MPV_FORMAT_STRING;
+    node.u.string = const_cast<char *>(value.c_str());
+    values.push_back(node);
+    keys.push_back(const_cast<char *>(key.c_str()));
+  }
+  mpv_node_list optionList{(int)values.size(), values.data(), keys.data()};
+
+  mpv_node args[4]{};
+  const char *argNames[] = {"name", "url", "flags", "options"};
+  const char *argValues[] = {"loadfile", url, flags};
+  for (int i = 0; i < 3; i++) {
+    args[i].format = MPV_FORMAT_STRING;
+    args[i].u.string = const_cast<char *>(argValues[i]);
+  }
+  args[3].format = MPV_FORMAT_NODE_MAP;
+  args[3].u.list = &optionList;
+  mpv_node_list argList{4, args, const_cast<char **>(argNames)};
+
+  mpv_node cmd{};
+  cmd.format = MPV_FORMAT_NODE_MAP;
+  cmd.u.list = &argList;
+  return mpv_command_node_async(mpv, 0, &cmd);
+}
+
+int Mpv::subprocess(const std::vector<std::string> &args, const std::atomic<bool> &cancel, std::string *output) {
+  std::vector<mpv_node> argv(args.size());
+  for (size_t i = 0; i < args.size(); i++) {
+    argv[i].format = MPV_FORMAT_STRING;
+    argv[i].u.string = const_cast<char *>(args[i].c_str());
+  }
+  mpv_node_list argList{(int)argv.size(), argv.data(), nullptr};
+
+  mpv_node values[4]{};
+  const char *keys[] = {"name", "args", "playback_only", "capture_stdout"};
+  values[0].format = MPV_FORMAT_STRING;
+  values[0].u.string = const_cast<char *>("subprocess");
+  values[1].format = MPV_FORMAT_NODE_ARRAY;
+  values[1].u.list = &argList;
+  values[2].format = MPV_FORMAT_FLAG;
+  values[2].u.flag = 0;
+  values[3].format = MPV_FORMAT_FLAG;
+  values[3].u.flag = output != nullptr;
+  mpv_node_list cmdList{4, values, const_cast<char **>(keys)};
+  mpv_node cmd{};
+  cmd.format = MPV_FORMAT_NODE_MAP;
+  cmd.u.list = &cmdList;
+
+  // a client of its own, so the reply is not dispatched by waitEvent and can be waited for here
+  mpv_handle *client = createClient(nullptr);
+  if (client == nullptr) return -1;
+  int64_t status = -1;
+  if (mpv_command_node_async(client, 1, &cmd) >= 0) {
+    bool aborted = false;
+    while (true) {
+      mpv_event *event = mpv_wait_event(client, 0.1);
+      if (event->event_id == MPV_EVENT_SHUTDOWN) break;
+      if (event->event_id == MPV_EVENT_COMMAND_REPLY) {
+        auto &result = static_cast<mpv_event_command *>(event->data)->result;
+        if (event->error >= 0 && !aborted && result.format == MPV_FORMAT_NODE_MAP) {
+          for (int i = 0; i < result.u.list->num; i++) {
+            auto &value = result.u.list->values[i];
+            if (strcmp(result.u.list->keys[i], "status") == 0 && value.format == MPV_FORMAT_INT64) status = value.u.int64;
+            if (strcmp(result.u.list->keys[i], "stdout") == 0 && value.format == MPV_FORMAT_BYTE_ARRAY && output)
+              output->assign((const char *)value.u.ba->data, value.u.ba->size);
+          }
+        }
+        break;
+      }
+      if (cancel && !aborted) {
+        mpv_abort_async_command(client, 1);
+        aborted = true;
+      }
+    }
+  }
+  mpv_destroy(client);
+  return (int)status;
+}
+
 void Mpv::waitEvent(double timeout) {
+  TRACE_FUNC();
   while (mpv) {
     mpv_event *event = mpv_wait_event(mpv, timeout);
     if (event->event_id == MPV_EVENT_NONE) break;
     switch (event->event_id) {
       case MPV_EVENT_PROPERTY_CHANGE: {
         auto *prop = (mpv_event_property *)event->data;
-        for (const auto &[name, format, handler] : propertyEvents)
-          if (name == prop->name && format == prop->format) handler(prop->data);
+        for (const auto &[id, format, handler] : propertyEvents) {
+          if (id == event->reply_userdata && format == prop->format) {
+            handler(prop->data);
+            break;
+          }
+        }
         break;
       }
       case MPV_EVENT_LOG_MESSAGE: {
         mpv_event_log_message *msg = (mpv_event_log_message *)event->data;
         if (logHandler) logHandler(msg->prefix, msg->level, msg->text);
       } break;
+      case MPV_EVENT_HOOK: {
+        auto hook = static_cast<mpv_event_hook *>(event->data);
+        for (const auto &[id, handler] : hooks)
+          if (id == event->reply_userdata) handler();
+        mpv_hook_continue(mpv, hook->id);
+      } break;
       default:
         for (const auto &[event_id, handler] : events)
           if (event_id == event->event_id) handler(event->data);
@@ -58,6 +153,17 @@ void Mpv::waitEvent(double timeout) {
   }
 }
 
+void Mpv::observeHook(const char *name, int priority, const std::function<void()> &handler) {
+  uint64_t id = ++propertyEventId;
+  hooks.emplace_back(id, handler);
+  mpv_hook_add(mpv, id, name, priority);
+}
+
+void Mpv::unobserveProperty(uint64_t id) {
+  std::erase_if(propertyEvents, [=](const auto &e) { return std::get<0>(e) == id; });
+  mpv_unobserve_property(mpv, id);
+}
+
 void Mpv::requestLog(const char *level, LogHandler handler) {
   this->logHandler = handler;
   mpv_request_log_messages(mpv, level);
@@ -101,9 +207,14 @@ void Mpv::reportSwap() {
 
 static void *get_proc_address(void *ctx, const char *name) { return ((GLAddrLoadFunc)ctx)(name); }
 
-void Mpv::init(GLAddrLoadFunc load, int64_t wid) {
+void Mpv::initCore(int64_t wid_) {
+  TRACE_FUNC();
+  wid = wid_;
   if (mpv_set_property(mpv, "wid", MPV_FORMAT_INT64, &wid) < 0) throw std::runtime_error("could not set mpv wid");
   if (mpv_initialize(mpv) < 0) throw std::runtime_error("could not initialize mpv context");
+}
+
+void Mpv::init(GLAddrLoadFunc load) {
   if (wid == 0) {
     mpv_opengl_init_params gl_init_params{get_proc_address, (void *)load};
     mpv_render_param params[]{
@@ -183,6 +294,7 @@ void Mpv::observeProperties() {
 }
 
 void Mpv::initPlaylist(mpv_node &node) {
+  TRACE_FUNC();
   if (node.format != MPV_FORMAT_NODE_ARRAY) return;
   playlist.clear();
   for (int i = 0; i < node.u.list->num; i++) {
@@ -203,6 +315,7 @@ void Mpv::initPlaylist(mpv_node &node) {
 }
 
 void Mpv::initChapters(mpv_node &node) {
+  TRACE_FUNC();
   if (node.format != MPV_FORMAT_NODE_ARRAY) return;
   chapters.clear();
   for (int i = 0; i < node.u.list->num; i++) {
@@ -223,6 +336,7 @@ void Mpv::initChapters(mpv_node &node) {
 }
 
 void Mpv::initTracks(mpv_node &node) {
+  TRACE_FUNC();
   if (node.format != MPV_FORMAT_NODE_ARRAY) return;
   tracks.clear();
   for (int i = 0; i < node.u.list->num; i++) {
@@ -248,6 +362,7 @@ void Mpv::initTracks(mpv_node &node) {
 }
 
 void Mpv::initAudioDevices(mpv_node &node) {
+  TRACE_FUNC();
   if (node.format != MPV_FORMAT_NODE_ARRAY) return;
   audioDevices.clear();
   for (int i = 0; i < node.u.list->num; i++) {
@@ -267,6 +382,7 @@ void Mpv::initAudioDevices(mpv_node &node) {
 }
 
 void Mpv::initBindings(mpv_node &node) {
+  TRACE_FUNC();
   if (node.format != MPV_FORMAT_NODE_ARRAY) return;
   bindings.clear();
   for (int i = 0; i < node.u.list->num; i++) {
@@ -291,9 +407,11 @@ void Mpv::initBindings(mpv_node &node) {
     }
     bindings.emplace_back(t);
   }
+  bindingsVersion++;
 }
 
 void Mpv::initProfiles(const char *payload) {
+  TRACE_FUNC();
   if (payload == nullptr) return;
   profiles.clear();
   auto j = nlohmann::json::parse(payload);
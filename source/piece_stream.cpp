@@ -0,0 +1,209 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <thread>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "piece_stream.h"
+
+namespace ImPlay {
+#ifdef __linux__
+// not FUTEX_PRIVATE_FLAG: the words live in a file mapping shared with the producer process
+static void futexWait(uint32_t *word, uint32_t expected) {
+  timespec timeout{0, 100 * 1000 * 1000};  // cancellation is checked in between
+  syscall(SYS_futex, word, FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+static void futexWake(uint32_t *word) { syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0); }
+#else
+static void futexWait(uint32_t *, uint32_t) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); }
+static void futexWake(uint32_t *) {}
+#endif
+
+bool PieceCache::open(const std::filesystem::path &dir) {
+  std::error_code ec;
+  auto statePath = dir / "pieces.state", dataPath = dir / "pieces.data";
+  if (!std::filesystem::is_regular_file(statePath, ec) || !std::filesystem::is_regular_file(dataPath, ec)) return false;
+  // writable for the priority bytes, the producer owns everything else
+  if (!state.open(statePath, true) || state.size() < HeaderSize) return false;
+
+  auto header = state.data();
+  uint32_t version, pieceLen, pieces;
+  uint64_t totalSize;
+  memcpy(&version, header + 4, 4);
+  memcpy(&totalSize, header + 8, 8);
+  memcpy(&pieceLen, header + 16, 4);
+  memcpy(&pieces, header + 20, 4);
+  if (memcmp(header, "PTPC", 4) != 0 || version != 1 || pieceLen == 0) return false;
+  if (pieces != (totalSize + pieceLen - 1) / pieceLen || state.size() < HeaderSize + pieces * 5ull) return false;
+
+  if (!content.open(dataPath) || content.size() < totalSize) return false;
+  total = (int64_t)totalSize;
+  length = pieceLen;
+  count = pieces;
+  return true;
+}
+
+uint32_t *PieceCache::haveWord(int64_t piece) const {
+  return reinterpret_cast<uint32_t *>(const_cast<std::byte *>(state.data()) + HeaderSize) + piece;
+}
+
+uint8_t *PieceCache::priorityByte(int64_t piece) const {
+  return reinterpret_cast<uint8_t *>(haveWord(count)) + piece;
+}
+
+bool PieceCache::have(int64_t piece) const {
+  return std::atomic_ref<uint32_t>(*haveWord(piece)).load(std::memory_order_acquire) != 0;
+}
+
+bool PieceCache::wait(int64_t piece, const std::atomic<bool> &cancel) {
+  auto word = haveWord(piece);
+  while (!have(piece)) {
+    if (cancel) return false;
+    // the producer may have reset it, or rewritten all hints, since the last wake up
+    if (std::atomic_ref<uint8_t>(*priorityByte(piece)).exchange(Priority_Now) != Priority_Now) publishHints();
+    futexWait(word, 0);
+  }
+  return true;
+}
+
+void PieceCache::setPriority(int64_t piece, Priority priority) {
+  std::atomic_ref<uint8_t>(*priorityByte(piece)).store(priority);
+}
+
+void PieceCache::publishHints() {
+  auto seq = reinterpret_cast<uint32_t *>(const_cast<std::byte *>(state.data()) + 24);
+  std::atomic_ref<uint32_t>(*seq).fetch_add(1, std::memory_order_release);
+  futexWake(seq);
+}
+
+PieceCache::Priority PieceStream::Window::wanted(int64_t piece) const {
+  if (piece == now) return PieceCache::Priority_Now;
+  if (first < 0 || piece < first || piece > last) return PieceCache::Priority_None;
+  return piece < first + NextPieces ? PieceCache::Priority_Next : PieceCache::Priority_Readahead;
+}
+
+void PieceStream::Reader::hint(int64_t piece, int64_t blocked) {
+  if (piece == window.first && blocked == window.now) return;
+  auto old = window;
+  window = {piece, piece < 0 ? -1 : std::min(piece + ReadaheadPieces, cache.pieceCount() - 1), blocked};
+
+  std::lock_guard<std::mutex> guard(wants->lock);
+  auto &counts = wants->counts;
+  auto update = [&](int64_t i) {
+    if (i < 0 || i >= (int64_t)counts.size()) return;
+    auto before = old.wanted(i), after = window.wanted(i);
+    if (before == after) return;
+    if (before != PieceCache::Priority_None) counts[i][before]--;
+    if (after != PieceCache::Priority_None) counts[i][after]++;
+    int level = PieceCache::Priority_Now;
+    while (level > PieceCache::Priority_None && counts[i][level] == 0) level--;
+    cache.setPriority(i, static_cast<PieceCache::Priority>(level));
+  };
+
+  // every piece either window covers exactly once, the counts move by the difference
+  auto covered = [&](int64_t i, int64_t first, int64_t last) { return first >= 0 && i >= first && i <= last; };
+  for (int64_t i = old.first; covered(i, old.first, old.last); i++) update(i);
+  for (int64_t i = window.first; covered(i, window.first, window.last); i++)
+    if (!covered(i, old.first, old.last)) update(i);
+  auto outside = [&](int64_t i) {
+    return i >= 0 && !covered(i, old.first, old.last) && !covered(i, window.first, window.last);
+  };
+  if (outside(old.now)) update(old.now);
+  if (outside(window.now) && window.now != old.now) update(window.now);
+  cache.publishHints();
+}
+
+int PieceStream::add(Mpv *mpv) { return mpv->addProtocol(Protocol, nullptr, &PieceStream::open); }
+
+int PieceStream::open(void *, char *uri, mpv_stream_cb_info *info) {
+  std::string path = uri;
+  auto prefix = std::string(Protocol) + "://";
+  if (!path.starts_with(prefix)) return MPV_ERROR_LOADING_FAILED;
+
+  auto reader = new Reader();
+  std::filesystem::path dir(path.substr(prefix.size()));
+  if (!reader->cache.open(dir)) {
+    delete reader;
+    return MPV_ERROR_LOADING_FAILED;
+  }
+  {
+    std::error_code ec;
+    auto key = std::filesystem::weakly_canonical(dir, ec).string();
+    std::lock_guard<std::mutex> guard(lock);
+    auto &shared = wantsByCache[key.empty() ? dir.string() : key];
+    reader->wants = shared.lock();
+    if (!reader->wants) {
+      reader->wants = std::make_shared<Wants>();
+      shared = reader->wants;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> guard(reader->wants->lock);
+    auto &counts = reader->wants->counts;
+    if ((int64_t)counts.size() < reader->cache.pieceCount()) counts.resize(reader->cache.pieceCount());
+  }
+  info->cookie = reader;
+  info->read_fn = &PieceStream::read;
+  info->seek_fn = &PieceStream::seek;
+  info->size_fn = &PieceStream::size;
+  info->close_fn = &PieceStream::close;
+  info->cancel_fn = &PieceStream::cancel;
+  return 0;
+}
+
+int64_t PieceStream::read(void *cookie, char *buf, uint64_t nbytes) {
+  auto reader = static_cast<Reader *>(cookie);
+  auto &cache = reader->cache;
+  if (reader->pos >= cache.size()) return 0;
+
+  int64_t piece = reader->pos / cache.pieceLength();
+  if (cache.have(piece)) {
+    reader->hint(piece, -1);
+  } else {
+    reader->hint(piece, piece);
+    if (!cache.wait(piece, reader->cancelled)) return -1;
+    reader->hint(piece, -1);
+  }
+
+  // up to the request or the first missing piece, whichever comes first
+  int64_t end = std::min(reader->pos + (int64_t)std::min<uint64_t>(nbytes, INT64_MAX), cache.size());
+  int64_t available = (piece + 1) * cache.pieceLength();
+  while (available < end && cache.have(available / cache.pieceLength())) available += cache.pieceLength();
+  end = std::min(end, available);
+
+  // the one copy of the stream_cb adaptation of zero-copy: mpv owns buf
+  auto n = end - reader->pos;
+  memcpy(buf, cache.data() + reader->pos, n);
+  reader->pos = end;
+  return n;
+}
+
+int64_t PieceStream::seek(void *cookie, int64_t offset) {
+  auto reader = static_cast<Reader *>(cookie);
+  if (offset < 0 || offset > reader->cache.size()) return MPV_ERROR_GENERIC;
+  reader->pos = offset;
+  return offset;
+}
+
+int64_t PieceStream::size(void *cookie) { return static_cast<Reader *>(cookie)->cache.size(); }
+
+void PieceStream::close(void *cookie) {
+  auto reader = static_cast<Reader *>(cookie);
+  reader->clearHints();
+  reader->wants.reset();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    std::erase_if(wantsByCache, [](auto &it) { return it.second.expired(); });
+  }
+  delete reader;
+}
+
+void PieceStream::cancel(void *cookie) { static_cast<Reader *>(cookie)->cancelled = true; }
+}  // namespace ImPlay
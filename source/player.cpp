@@ -1,8 +1,12 @@
 // Copyright (c) 2022-2025 tsl0922. All rights reserved.
 // SPDX-License-Identifier: GPL-2.0-only
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <set>
+#include <string_view>
 #include <thread>
 #include <romfs/romfs.hpp>
 #include <imgui.h>
@@ -12,6 +16,8 @@
 #include <fonts/fontawesome.h>
 #include <fonts/unifont.h>
 #include <strnatcmp.h>
+#include "helpers/startup.h"
+#include "helpers/trace.h"
 #include "theme.h"
 #include "player.h"
 
@@ -20,15 +26,46 @@ Player::Player(Config *config) : config(config) {
   mpv = new Mpv();
   debug = new Views::Debug(config, mpv);
   playerOverlay = new Views::PlayerOverlay(config, mpv);
+  scanner = new FolderScanner(mpv, [this](const std::filesystem::path &path) {
+    return isMediaFile(path, this->config->Data.Mpv.SniffMedia);  // runs on the scanner thread
+  });
+  playerOverlay->setScanner(scanner);
+  library = new MediaLibrary(config);
+  playerOverlay->setLibrary(library);
+  resume = new ResumeStore();
+  instance = new Instance();
+  subtitles = new SubtitleCache(mpv);
+  playerOverlay->setSubtitleCache(subtitles);
+  debug->setSubtitleCache(subtitles);
+  cache = new CacheController(config, mpv);
+  playerOverlay->setCacheController(cache);
+  timings = new LoadTimings(mpv);
+  debug->setLoadTimings(timings);
+  prefetch = new PlaylistPrefetch(config, mpv, cache);
+  debug->setPlaylistPrefetch(prefetch);
+  diskCache = new DiskCache(config, mpv);
+  debug->setDiskCache(diskCache);
 }
 
 Player::~Player() {
+  delete readahead;
+  delete prefetch;
+  delete timings;
+  delete cache;
+  delete subtitles;
+  delete instance;
+  delete resume;
+  delete library;
+  delete scanner;
   delete debug;
   delete playerOverlay;
   delete mpv;
+  delete diskCache;  // after mpv, whose teardown closes the streams reading through it
 }
 
-bool Player::init(std::map<std::string, std::string> &options) {
+// Configures and initializes the mpv core. Needs no window or GL context, so it runs on a
+// worker thread while the window is being created.
+bool Player::initMpv(std::map<std::string, std::string> &options) {
   // Basic mpv options - keep it simple and stable
   mpv->option("config", "yes");
   mpv->option("input-default-bindings", "yes");
@@ -42,9 +79,16 @@ bool Player::init(std::map<std::string, std::string> &options) {
   // Hardware decoding for native performance (auto-safe is stable)
   mpv->option("hwdec", "auto-safe");
 
+  resume->open(dataPath() / "resume.db");
+  subtitles->open(dataPath() / "subtitles");
+  if (config->Data.Cache.Disk) diskCache->open(dataPath() / "streams");
+
   if (!config->Data.Mpv.UseConfig) {
+    // a task, not a mark: this usually runs on a worker, between the marks of the UI thread
+    double begin = Startup::now();
     writeMpvConf();
     mpv->option("config-dir", config->dir().c_str());
+    Startup::task("write-mpv-conf", begin);
   }
 
   if (config->Data.Window.Single) mpv->option("input-ipc-server", config->ipcSocket().c_str());
@@ -57,18 +101,43 @@ bool Player::init(std::map<std::string, std::string> &options) {
   }
 
   debug->init();
+  mpv->initCore(GetWid());
+  PieceStream::add(mpv);
+  FollowStream::add(mpv);
+  return true;
+}
 
+// The GL dependent part of initialization, after initMpv has completed.
+bool Player::init() {
   {
     ContextGuard guard(this);
     logoTexture = ImGui::LoadTexture("icon.png");
-    mpv->init(GetGLAddrFunc(), GetWid());
+    mpv->init(GetGLAddrFunc());
   }
+  Startup::mark("mpv-render-init");
 
   SetWindowDecorated(mpv->property<int, MPV_FORMAT_FLAG>("border"));
   mpv->property<int64_t, MPV_FORMAT_INT64>("volume", config->Data.Mpv.Volume);
   if (config->Data.Recent.SpaceToPlayLast) mpv->command("keybind SPACE 'script-message-to implay play-pause'");
   
   initObservers();
+  library->start();
+  timings->start(dataPath() / "ttff.jsonl");
+  // requests arrive on the listener thread, the client message brings them to this one
+  if (config->Data.Window.Single || daemon) {
+    bool listening =
+        instance->listen([this] { mpv->commandv("script-message-to", "implay", "instance-request", nullptr); });
+    if (daemon && !listening) {
+      fmt::print(fg(fmt::color::red), "Another instance is already running\n");
+      return false;
+    }
+  }
+  // every default quit binding parks the daemon instead
+  if (daemon) {
+    for (auto key : {"q", "Q", "ctrl+w", "CLOSE_WIN", "STOP", "POWER"})
+      mpv->command(fmt::format("keybind {} 'script-message-to implay close'", key).c_str());
+  }
+  Startup::mark("init-observers");
 
   return true;
 }
@@ -87,6 +156,89 @@ void Player::setExternalSubtitleProviders(const std::vector<CmdSubtitleProvider>
     overlayProviders.push_back(sp);
   }
   playerOverlay->setExternalProviders(overlayProviders);
+
+  // prefetch in language preference order, ties keep the command line order
+  auto langs = SubtitleCache::languages(mpv->property("slang"), config->Data.Interface.Lang);
+  std::vector<std::pair<size_t, SubtitleCache::Item>> items;
+  for (const auto& p : providers)
+    for (const auto& s : p.subtitles) items.push_back({SubtitleCache::rank(s.name, langs), {s.url, s.name}});
+  std::stable_sort(items.begin(), items.end(), [](auto& a, auto& b) { return a.first < b.first; });
+  std::vector<SubtitleCache::Item> ordered;
+  for (auto& [rank, item] : items) ordered.push_back(std::move(item));
+  subtitles->prefetch(ordered);
+}
+
+// Options that are only read while mpv starts up, a running instance can not apply them.
+static const std::set<std::string_view> StartupOptions = {
+    "config", "config-dir", "include", "input-ipc-server", "input-conf", "load-scripts", "script", "scripts",
+    "log-file", "msg-level", "terminal", "idle", "force-window", "wid", "vo", "gpu-api", "gpu-context", "profile",
+    "player-operation-mode"};
+
+// Player-wide options, set on the instance instead of scoped to the handed over files.
+static const std::set<std::string_view> GlobalOptions = {
+    "fs", "fullscreen", "ontop", "border", "window-maximized", "window-minimized", "window-scale", "geometry",
+    "autofit", "volume", "mute", "loop-playlist", "keep-open", "sub-auto", "audio-file-auto",
+    "save-position-on-quit"};
+
+void Player::handoff(const OptionParser &request) {
+  TRACE_FUNC();
+  if (request.traceLaunched >= 0)
+    Startup::adopt(reinterpret_cast<const char8_t *>(request.traceOutput.c_str()), !request.paths.empty(),
+                   request.traceLaunched);
+  std::map<std::string, std::string> local;
+  for (auto &[key, value] : request.options) {
+    if (StartupOptions.contains(key)) {
+      fmt::print(fg(fmt::color::red), "Ignoring --{} for the running instance, it only applies at startup\n", key);
+    } else if (GlobalOptions.contains(key)) {
+      if (int err = mpv->property(key.c_str(), value.c_str()); err < 0)
+        fmt::print(fg(fmt::color::red), "mpv: {} [{}={}]\n", mpv_error_string(err), key, value);
+    } else {
+      local.emplace(key, value);
+    }
+  }
+  for (auto &path : request.paths) mpv->loadfile(path.c_str(), "append-play", local);
+  if (!request.subtitleProviders.empty()) setExternalSubtitleProviders(request.subtitleProviders);
+  parked = false;
+  RaiseWindow();
+}
+
+void Player::park() {
+  TRACE_FUNC();
+  if (!mpv->fullscreen) saveState();
+  mpv->property("fullscreen", "no");
+  mpv->command("stop");
+  playerOverlay->setExternalProviders({});
+  subtitles->prefetch({});
+  releaseVideo();
+  HideWindow();
+  parked = true;
+  trimmed = false;
+  parkedAt = std::chrono::steady_clock::now();
+}
+
+double Player::parkedTick() {
+  using namespace std::chrono;
+  auto idleFor = steady_clock::now() - parkedAt;
+  auto trimAt = seconds(config->Data.Daemon.TrimDelay);
+  if (!trimmed && idleFor >= trimAt) {
+    TRACE_ZONE("trim memory");
+    resume->flush();
+    releaseMemory();
+    trimmed = true;
+  }
+
+  double next = -1;
+  if (!trimmed) next = duration<double>(trimAt - idleFor).count();
+  if (int timeout = config->Data.Daemon.IdleTimeout; timeout > 0) {
+    auto exitAt = minutes(timeout);
+    if (idleFor >= exitAt) {
+      SetWindowShouldClose(true);
+      return 0;
+    }
+    double left = duration<double>(exitAt - idleFor).count();
+    next = next < 0 ? left : std::min(next, left);
+  }
+  return next;
 }
 
 void Player::draw() {
@@ -100,8 +252,10 @@ void Player::draw() {
     // Idle - show PlayTorrioPlayer welcome screen
     playerOverlay->drawIdleScreen();
   }
+  playerOverlay->drawScanProgress();
 
-  // Only draw dialogs (not the old UI views)
+  // Only draw dialogs (not the old UI views), debug stays hidden until toggled by the metrics command
+  debug->draw();
   drawOpenURL();
   drawDialog();
 }
@@ -122,6 +276,8 @@ void Player::drawVideo() {
 void Player::render() {
   auto g = ImGui::GetCurrentContext();
   if (g != nullptr && g->WithinFrameScope) return;
+  TRACE_FUNC();
+  auto start = std::chrono::steady_clock::now();
 
   {
     ContextGuard guard(this);
@@ -150,7 +306,10 @@ void Player::render() {
   }
 #endif
 
-  draw();
+  {
+    TRACE_ZONE("draw");
+    draw();
+  }
 
 #if defined(_WIN32) && defined(IMGUI_HAS_VIEWPORT)
   if (config->Data.Mpv.UseWid && mpv->ontop) {
@@ -177,8 +336,16 @@ void Player::render() {
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     
     SetSwapInterval(config->Data.Interface.Fps > 60 ? 0 : 1);
-    SwapBuffers();
-    mpv->reportSwap();
+    auto swap = std::chrono::steady_clock::now();
+    {
+      TRACE_ZONE("SwapBuffers");
+      SwapBuffers();
+      mpv->reportSwap();
+    }
+    Startup::framePresented(!idle);
+    auto end = std::chrono::steady_clock::now();
+    debug->addTiming(Views::Debug::Timing_Swap, std::chrono::duration<float, std::milli>(end - swap).count());
+    debug->addTiming(Views::Debug::Timing_Frame, std::chrono::duration<float, std::milli>(end - start).count());
 
 #ifdef IMGUI_HAS_VIEWPORT
     if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
@@ -190,7 +357,9 @@ void Player::render() {
 }
 
 void Player::renderVideo() {
+  TRACE_FUNC();
   ContextGuard guard(this);
+  auto start = std::chrono::steady_clock::now();
 
   glBindFramebuffer(GL_FRAMEBUFFER, fbo);
   glBindTexture(GL_TEXTURE_2D, tex);
@@ -202,6 +371,31 @@ void Player::renderVideo() {
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
   mpv->render(width, height, fbo, false);
+  Startup::videoRendered();
+  timings->videoRendered();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  debug->addTiming(Views::Debug::Timing_Video, std::chrono::duration<float, std::milli>(elapsed).count());
+}
+
+// Frees the video texture storage, renderVideo allocates it again for the next frame.
+void Player::releaseVideo() {
+  ContextGuard guard(this);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Player::processEvents() {
+  auto start = std::chrono::steady_clock::now();
+  mpv->waitEvent();
+  auto now = std::chrono::steady_clock::now();
+  debug->addTiming(Views::Debug::Timing_Events, std::chrono::duration<float, std::milli>(now - start).count());
+
+  if (!resumeKey.empty() && now - resumeCheckpoint >= std::chrono::seconds(5)) {
+    resumeCheckpoint = now;
+    resumeLast = resumeState();
+    resume->checkpoint(resumeKey, resumeLast);
+  }
 }
 
 void Player::initGui() {
@@ -212,6 +406,7 @@ void Player::initGui() {
 #else
   if (!gladLoadGL((GLADloadfunc)GetGLAddrFunc())) throw std::runtime_error("Failed to load GL!");
 #endif
+  Startup::mark("load-gl");
   SetSwapInterval(1);  // Enable VSync
 
   IMGUI_CHECKVERSION();
@@ -229,6 +424,7 @@ void Player::initGui() {
 #endif
 
   loadFonts();
+  Startup::mark("load-fonts");
 
   // Create FBO for video rendering
   glGenFramebuffers(1, &fbo);
@@ -252,6 +448,7 @@ void Player::initGui() {
 #else
   ImGui_ImplOpenGL3_Init("#version 130");
 #endif
+  Startup::mark("init-gui");
 }
 
 void Player::exitGui() {
@@ -291,6 +488,7 @@ void Player::restoreState() {
 }
 
 void Player::loadFonts() {
+  TRACE_FUNC();
   auto interface = config->Data.Interface;
   float baseFontSize = config->Data.Font.Size;
   float scale = interface.Scale;
@@ -328,8 +526,17 @@ void Player::loadFonts() {
 
   const ImWchar *font_range = config->buildGlyphRanges();
   
+  // decompressed by prepareFonts when available, the atlas keeps its own copy
+  auto addFont = [&](const std::vector<unsigned char> &ttf, const unsigned int *data, unsigned int size, float px,
+                     const ImWchar *range) {
+    if (ttf.empty()) return io.Fonts->AddFontFromMemoryCompressedTTF(data, size, px, &cfg, range);
+    ImFontConfig c = cfg;
+    c.FontDataOwnedByAtlas = false;
+    return io.Fonts->AddFontFromMemoryTTF((void *)ttf.data(), (int)ttf.size(), px, &c, range);
+  };
+
   // Use Cascadia as primary font (modern, clean look)
-  auto* font1 = io.Fonts->AddFontFromMemoryCompressedTTF(cascadia_compressed_data, cascadia_compressed_size, fontSize, &cfg, font_range);
+  auto* font1 = addFont(cascadiaFont, cascadia_compressed_data, cascadia_compressed_size, fontSize, font_range);
   if (font1 == nullptr) {
     io.Fonts->AddFontDefault();
   }
@@ -338,7 +545,7 @@ void Player::loadFonts() {
   cfg.MergeMode = true;
   cfg.GlyphMinAdvanceX = iconSize;  // Consistent icon width
   static ImWchar fa_range[] = {ICON_MIN_FA, ICON_MAX_FA, 0};
-  io.Fonts->AddFontFromMemoryCompressedTTF(fa_compressed_data, fa_compressed_size, iconSize, &cfg, fa_range);
+  addFont(iconFont, fa_compressed_data, fa_compressed_size, iconSize, fa_range);
   
   // Add unifont as fallback for international characters
   cfg.MergeMode = true;
@@ -346,14 +553,64 @@ void Player::loadFonts() {
   if (fileExists(config->Data.Font.Path)) {
     io.Fonts->AddFontFromFileTTF(config->Data.Font.Path.c_str(), fontSize, &cfg, font_range);
   } else {
-    io.Fonts->AddFontFromMemoryCompressedTTF(unifont_compressed_data, unifont_compressed_size, fontSize, &cfg, font_range);
+    addFont(unifontFont, unifont_compressed_data, unifont_compressed_size, fontSize, font_range);
   }
   
   // Build font atlas
   io.Fonts->Build();
 }
 
-void Player::shutdown() { mpv->command(config->Data.Mpv.WatchLater ? "quit-watch-later" : "quit"); }
+// Decompresses the embedded fonts once, off the UI thread. Font reloads reuse the result.
+void Player::prepareFonts() {
+  cascadiaFont = ImGui::DecompressTTF(cascadia_compressed_data, cascadia_compressed_size);
+  iconFont = ImGui::DecompressTTF(fa_compressed_data, fa_compressed_size);
+  if (!fileExists(config->Data.Font.Path))
+    unifontFont = ImGui::DecompressTTF(unifont_compressed_data, unifont_compressed_size);
+}
+
+void Player::shutdown() {
+  if (!resumeKey.empty()) {
+    resume->checkpoint(resumeKey, resumeState());
+    resume->flush();
+    resumeKey.clear();
+  }
+  if (daemon)
+    park();
+  else
+    mpv->command("quit");
+}
+
+ResumeStore::State Player::resumeState() {
+  ResumeStore::State state;
+  state.position = mpv->property<double, MPV_FORMAT_DOUBLE>("time-pos");
+  state.audioDelay = mpv->audioDelay;
+  state.subDelay = mpv->subDelay;
+  state.lastPlayed = std::chrono::duration_cast<std::chrono::seconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+  state.aid = mpv->aid;
+  state.vid = mpv->vid;
+  state.sid = mpv->sid;
+  return state;
+}
+
+// Applies the saved state as file-local options before the file is opened, so playback starts at the
+// position rather than seeking there after the first frames. Called from the on_load hook.
+void Player::restoreResume(const std::string &key) {
+  if (key.empty()) return;
+  auto state = resume->find(key);
+  if (!state) return;
+  auto local = [&](const char *name, const std::string &value) {
+    mpv->property(fmt::format("file-local-options/{}", name).c_str(), value.c_str());
+  };
+  // a start given on the command line or with the playlist entry wins
+  if (state->position > 0 && mpv->property("start") == "none") local("start", fmt::format("{}", state->position));
+  if (state->aid != "") local("aid", state->aid);
+  if (state->vid != "") local("vid", state->vid);
+  if (state->sid != "") local("sid", state->sid);
+  local("audio-delay", fmt::format("{}", state->audioDelay));
+  local("sub-delay", fmt::format("{}", state->subDelay));
+}
 
 void Player::onCursorEvent(double x, double y) {
   std::string xs = std::to_string((int)x);
@@ -404,10 +661,52 @@ void Player::initObservers() {
   mpv->observeEvent(MPV_EVENT_FILE_LOADED, [this](void *data) {
     auto path = mpv->property("path");
     if (path != "" && path != "bd://" && path != "dvd://") config->addRecentFile(path, mpv->property("media-title"));
+    if (auto duration = mpv->property<double, MPV_FORMAT_DOUBLE>("duration"); duration > 0)
+      library->setDuration(path, duration);
+    if (config->Data.Mpv.WatchLater && path != "") {
+      resumeKey = path;
+      resumeLast = resumeState();
+      resumeCheckpoint = std::chrono::steady_clock::now();
+    }
     mpv->property("force-media-title", "");
     mpv->property("start", "none");
   });
 
+  // the next local item gets its head and index read while this one plays
+  mpv->observeEvent(MPV_EVENT_START_FILE, [this](void *data) {
+    if (!config->Data.Mpv.Readahead) return;
+    auto pos = mpv->property<int64_t, MPV_FORMAT_INT64>("playlist-playing-pos");
+    if (pos < 0 || pos + 1 >= mpv->property<int64_t, MPV_FORMAT_INT64>("playlist-count")) return;
+    auto next = mpv->property(fmt::format("playlist/{}/filename", pos + 1).c_str());
+    if (!next.empty() && next.find("://") == std::string::npos) warm(std::filesystem::u8path(next));
+  });
+
+  mpv->observeEvent(MPV_EVENT_END_FILE, [this](void *data) {
+    if (resumeKey.empty()) return;
+    auto event = static_cast<mpv_event_end_file *>(data);
+    if (event->reason == MPV_END_FILE_REASON_EOF) {
+      resume->remove(resumeKey);  // watched to the end, start over next time
+    } else {
+      // the properties are gone by now, keep the last checkpoint with the last known position
+      if (mpv->timePos > 0) resumeLast.position = (double)mpv->timePos;
+      resume->checkpoint(resumeKey, resumeLast);
+    }
+    resumeKey.clear();
+  });
+
+  mpv->observeHook("on_load", 30, [this]() {
+    if (config->Data.Mpv.WatchLater) restoreResume(mpv->property("path"));
+  });
+
+  // local files still being downloaded are read through follow:// so playback waits at the written end
+  mpv->observeHook("on_load", 40, [this]() {
+    if (!config->Data.Mpv.FollowGrowing) return;
+    auto url = mpv->property("stream-open-filename");
+    if (url.empty() || url.find("://") != std::string::npos) return;
+    if (FollowStream::growing(std::filesystem::u8path(url)))
+      mpv->property("stream-open-filename", fmt::format("{}://{}", FollowStream::Protocol, url).c_str());
+  });
+
   mpv->observeEvent(MPV_EVENT_CLIENT_MESSAGE, [this](void *data) {
     auto msg = static_cast<mpv_event_client_message *>(data);
     execute(msg->num_args, msg->args);
@@ -432,6 +731,10 @@ void Player::initObservers() {
     if (w > 0 && h > 0) SetWindowSize((int)(w * scale), (int)(h * scale));
   });
   mpv->observeProperty<int, MPV_FORMAT_FLAG>("fullscreen", [this](int flag) { SetWindowFullscreen(flag); });
+
+  cache->init();
+  prefetch->init();
+  diskCache->init();
 }
 
 void Player::writeMpvConf() {
@@ -450,6 +753,7 @@ void Player::writeMpvConf() {
     auto content = romfs::get("mpv/input.conf");
     file.write(reinterpret_cast<const char *>(content.data()), content.size()) << "\n";
     file << "`            script-message-to implay metrics\n";
+    file << "~            script-message-to implay hud\n";
   }
 }
 
@@ -468,6 +772,11 @@ void Player::execute(int n_args, const char **args_) {
       {"playlist-add-files", [&](int n, const char **args) { openFilesDlg(mediaFilters, true); }},
       {"playlist-add-folder", [&](int n, const char **args) { openFolderDlg(true); }},
       {"playlist-sort", [&](int n, const char **args) { playlistSort(n > 0 && strcmp(args[0], "true") == 0); }},
+      {"library-add-folder",
+       [&](int n, const char **args) {
+         if (auto res = NFD::openFolder()) library->addFolder(*res);
+       }},
+      {"library-rescan", [&](int n, const char **args) { library->rescan(); }},
       {"play-pause",
        [&](int n, const char **args) {
          auto count = mpv->property<int64_t, MPV_FORMAT_INT64>("playlist-count");
@@ -484,6 +793,21 @@ void Player::execute(int n_args, const char **args_) {
          }
        }},
       {"metrics", [&](int n, const char **args) { debug->show(); }},
+      {"hud", [&](int n, const char **args) { debug->toggleHud(); }},
+      {"trace-start", [&](int n, const char **args) { Trace::start(); }},
+      {"trace-stop", [&](int n, const char **args) { Trace::stop(); }},
+      {"trace-dump",
+       [&](int n, const char **args) {
+         auto name = fmt::format("trace-{:%Y%m%d-%H%M%S}.json", fmt::localtime(std::time(nullptr)));
+         auto path = n > 0 ? std::filesystem::path(reinterpret_cast<const char8_t *>(args[0])) : dataPath() / name;
+         if (!Trace::dump(path)) throw std::runtime_error(fmt::format("failed to write {}", path.string()));
+         mpv->commandv("show-text", path.string().c_str(), nullptr);
+       }},
+      {"close", [&](int n, const char **args) { shutdown(); }},
+      {"instance-request",
+       [&](int n, const char **args) {
+         for (auto &request : instance->take()) handoff(request);
+       }},
       {"show-message",
        [&](int n, const char **args) {
          if (n > 1) messageBox(args[0], args[1]);
@@ -539,37 +863,81 @@ void Player::openBluray(std::filesystem::path path) {
 }
 
 void Player::playlistSort(bool reverse) {
-  if (mpv->playlist.empty()) return;
-  std::vector<Mpv::PlayItem> items(mpv->playlist);
-  std::sort(items.begin(), items.end(), [&](const auto &a, const auto &b) {
-    std::string str1 = a.title != "" ? a.title : a.filename();
-    std::string str2 = b.title != "" ? b.title : b.filename();
-    return strnatcasecmp(str1.c_str(), str2.c_str()) < 0;
+  TRACE_FUNC();
+  auto &playlist = mpv->playlist;
+  if (playlist.empty()) return;
+  int n = (int)playlist.size();
+
+  std::vector<std::string> keys(n);
+  for (int i = 0; i < n; i++) {
+    auto &item = playlist[i];
+    keys[i] = naturalKey(item.title != "" ? item.title : item.filename());
+  }
+  std::vector<int> order(n);  // order[target position] = current index
+  for (int i = 0; i < n; i++) order[i] = i;
+  parallelSort(order.begin(), order.end(), [&](int a, int b) {
+    int c = keys[a].compare(keys[b]);
+    return c != 0 ? c < 0 : a < b;
   });
-  if (reverse) std::reverse(items.begin(), items.end());
-
-  int64_t timePos = mpv->timePos;
-  int64_t pos = -1;
-  for (int i = 0; i < items.size(); i++) {
-    if (items[i].id == mpv->playlistPos) {
-      pos = i;
-      break;
+  if (reverse) std::reverse(order.begin(), order.end());
+
+  std::vector<int> target(n);
+  for (int i = 0; i < n; i++) target[order[i]] = i;
+
+  // entries on a longest increasing run of targets can stay where they are
+  std::vector<int> tails, tailIndex, prev(n, -1);
+  for (int i = 0; i < n; i++) {
+    int k = (int)(std::lower_bound(tails.begin(), tails.end(), target[i]) - tails.begin());
+    if (k == (int)tails.size()) {
+      tails.push_back(target[i]);
+      tailIndex.push_back(i);
+    } else {
+      tails[k] = target[i];
+      tailIndex[k] = i;
+    }
+    if (k > 0) prev[i] = tailIndex[k - 1];
+  }
+  std::vector<bool> keep(n, false);
+  for (int i = tailIndex.empty() ? -1 : tailIndex.back(); i >= 0; i = prev[i]) keep[i] = true;
+  int moves = n - (int)tails.size();
+  if (moves == 0) return;
+
+  if (moves <= 128) {
+    // move each misplaced entry right after its sorted predecessor, the playing entry keeps its place
+    std::vector<int> current(n);
+    for (int i = 0; i < n; i++) current[i] = i;
+    for (int t = 0; t < n; t++) {
+      int id = order[t];
+      if (keep[id]) continue;
+      int from = (int)(std::find(current.begin(), current.end(), id) - current.begin());
+      int to = t == 0 ? 0 : (int)(std::find(current.begin(), current.end(), order[t - 1]) - current.begin()) + 1;
+      if (from == to || from + 1 == to) continue;
+      mpv->commandv("playlist-move", std::to_string(from).c_str(), std::to_string(to).c_str(), nullptr);
+      current.erase(current.begin() + from);
+      current.insert(current.begin() + (from < to ? to - 1 : to), id);
     }
+    return;
   }
-  std::vector<std::string> playlist = {"#EXTM3U"};
-  for (auto &item : items) {
-    if (item.title != "") playlist.push_back(fmt::format("#EXTINF:-1,{}", item.title));
-    playlist.push_back(item.path.string());
+
+  // too many moves for mpv's array playlist: rebuild around the playing entry, which playlist-clear keeps
+  int playing = mpv->playing() ? (int)mpv->playlistPlayingPos : -1;
+  std::string m3u = "memory://#EXTM3U";
+  for (int id : order) {
+    if (id == playing) continue;
+    auto &item = playlist[id];
+    if (item.title != "") m3u.append("\n#EXTINF:-1,").append(item.title);
+    m3u.append("\n").append(reinterpret_cast<const char *>(item.path.u8string().c_str()));
   }
-  mpv->property<int64_t, MPV_FORMAT_INT64>("playlist-start", pos);
-  mpv->property("start", fmt::format("+{}", timePos).c_str());
-  if (!mpv->playing()) mpv->command("playlist-clear");
-  mpv->commandv("loadlist", fmt::format("memory://{}", join(playlist, "\n")).c_str(),
-                mpv->playing() ? "replace" : "append", nullptr);
+  mpv->command("playlist-clear");
+  mpv->commandv("loadlist", m3u.c_str(), "append", nullptr);
+  if (playing >= 0 && target[playing] > 0)
+    mpv->commandv("playlist-move", "0", std::to_string(target[playing] + 1).c_str(), nullptr);
 }
 
 void Player::load(std::vector<std::filesystem::path> files, bool append, bool disk) {
+  TRACE_FUNC();
   int i = 0;
+  std::vector<std::filesystem::path> folders;
   for (auto &file : files) {
     if (std::filesystem::is_directory(file)) {
       if (disk) {
@@ -579,14 +947,13 @@ void Player::load(std::vector<std::filesystem::path> files, bool append, bool di
           openDvd(file);
         break;
       }
-      for (const auto &entry : std::filesystem::recursive_directory_iterator(file)) {
-        auto path = entry.path().string();
-        if (isMediaFile(path)) {
-          const char *action = append ? "append" : (i > 0 ? "append-play" : "replace");
-          mpv->commandv("loadfile", path.c_str(), action, nullptr);
-          i++;
-        }
+      if (auto indexed = library->folder(file)) {
+        // already in the media library, no need to walk the tree
+        loadPlaylist(*indexed, append || i > 0);
+        i++;
+        continue;
       }
+      folders.push_back(file);  // expanded in the background, after the loose files
     } else {
       if (file.extension() == ".iso") {
         if ((double)std::filesystem::file_size(file) / 1000 / 1000 / 1000 > 4.7)
@@ -594,15 +961,37 @@ void Player::load(std::vector<std::filesystem::path> files, bool append, bool di
         else
           openDvd(file);
         break;
-      } else if (isSubtitleFile(file.string())) {
-        mpv->commandv("sub-add", file.string().c_str(), append ? "auto" : "select", nullptr);
+      } else if (mediaTypeOf(file) == MediaType::Subtitle) {
+        subtitles->addFile(file, append ? "auto" : "select");
       } else {
         const char *action = append ? "append" : (i > 0 ? "append-play" : "replace");
+        // only what plays first, the rest is warmed once it is next in line
+        if (!append && i == 0) warm(file);
         mpv->commandv("loadfile", file.string().c_str(), action, nullptr);
       }
       i++;
     }
   }
+  if (!folders.empty()) scanner->start(std::move(folders), append || i > 0);
+}
+
+void Player::loadPlaylist(const std::vector<std::string> &paths, bool append) {
+  std::string m3u = "memory://#EXTM3U";
+  size_t count = 0;
+  for (auto &path : paths) {
+    if (path.find_first_of("\r\n") != std::string::npos) continue;  // not representable in M3U
+    m3u.append("\n").append(path);
+    count++;
+  }
+  if (count == 0) return;
+  if (!append) warm(std::filesystem::u8path(paths.front()));
+  mpv->commandv("loadlist", m3u.c_str(), append ? "append" : "replace", nullptr);
+}
+
+void Player::warm(const std::filesystem::path &path) {
+  if (!config->Data.Mpv.Readahead) return;
+  if (readahead == nullptr) readahead = new Readahead();
+  readahead->queue(path);
 }
 
 void Player::drawOpenURL() {
@@ -663,21 +1052,9 @@ void Player::messageBox(std::string title, std::string msg) {
   m_dialog = true;
 }
 
-bool Player::isMediaFile(std::string file) {
-  auto ext = std::filesystem::path(file).extension().string();
-  if (ext.empty()) return false;
-  if (ext[0] == '.') ext = ext.substr(1);
-  if (std::find(videoTypes.begin(), videoTypes.end(), ext) != videoTypes.end()) return true;
-  if (std::find(audioTypes.begin(), audioTypes.end(), ext) != audioTypes.end()) return true;
-  if (std::find(imageTypes.begin(), imageTypes.end(), ext) != imageTypes.end()) return true;
-  return false;
-}
-
-bool Player::isSubtitleFile(std::string file) {
-  auto ext = std::filesystem::path(file).extension().string();
-  if (ext.empty()) return false;
-  if (ext[0] == '.') ext = ext.substr(1);
-  if (std::find(subtitleTypes.begin(), subtitleTypes.end(), ext) != subtitleTypes.end()) return true;
-  return false;
+bool Player::isMediaFile(const std::filesystem::path &file, bool sniff) {
+  auto type = mediaTypeOf(file);
+  if (type == MediaType::None && sniff) type = sniffMediaType(file);
+  return type == MediaType::Video || type == MediaType::Audio || type == MediaType::Image;
 }
 }  // namespace ImPlay
\ No newline at end of file
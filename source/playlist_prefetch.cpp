@@ -0,0 +1,175 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <fmt/format.h>
+#include "helpers/trace.h"
+#include "playlist_prefetch.h"
+
+namespace ImPlay {
+#ifdef _WIN32
+static const char *NullDevice = "NUL";
+#else
+static const char *NullDevice = "/dev/null";
+#endif
+
+PlaylistPrefetch::PlaylistPrefetch(Config *config, Mpv *mpv, CacheController *cache)
+    : config(config), mpv(mpv), cache(cache) {}
+
+PlaylistPrefetch::~PlaylistPrefetch() {
+  cancel();
+  for (auto &old : retired) old->thread.join();  // aborted, they return within a poll interval
+}
+
+void PlaylistPrefetch::init() {
+  mpv->observeEvent(MPV_EVENT_START_FILE, [this](void *) { startFile(); });
+  mpv->observeEvent(MPV_EVENT_END_FILE, [this](void *data) { endFile(static_cast<mpv_event_end_file *>(data)); });
+  mpv->observeEvent(MPV_EVENT_PLAYBACK_RESTART, [this](void *) { restarted(); });
+  mpv->observeProperty<int64_t, MPV_FORMAT_INT64>("time-remaining", [this](int64_t value) { tick(value); });
+  mpv->observeHook("on_load", 50, [this]() { onLoad(); });
+}
+
+PlaylistPrefetch::Warmup PlaylistPrefetch::warmup() {
+  std::lock_guard<std::mutex> l(lock);
+  return current;
+}
+
+const char *PlaylistPrefetch::stateName(State state) {
+  switch (state) {
+    case State::Running:
+      return "running";
+    case State::Done:
+      return "done";
+    case State::Failed:
+      return "failed";
+    default:
+      return "idle";
+  }
+}
+
+void PlaylistPrefetch::tick(int64_t remaining) {
+  if (!armed) {
+    if (!config->Data.Prefetch.Enabled || remaining > config->Data.Prefetch.Lead) return;
+    armed = true;
+    auto url = nextUrl();
+    if (url.starts_with("http://") || url.starts_with("https://")) {
+      warming = url;
+      start(url);
+    }
+    return;
+  }
+
+  // current still holds the result for an earlier item until a warm-up is started for this one
+  if (applied || warming.empty()) return;
+  auto warm = warmup();
+  if (warm.url != warming || (warm.state != State::Done && warm.state != State::Failed)) return;
+  applied = true;
+  if (warm.state == State::Failed) return;
+  if (warm.resolved != warm.url) {
+    // mpv would prefetch the original URL and drop it once on_load swaps in the resolved one
+    redirectFrom = warm.url;
+    redirectTo = warm.resolved;
+  } else {
+    mpv->commandv("set", "prefetch-playlist", "yes", nullptr);
+    prefetching = true;
+  }
+}
+
+void PlaylistPrefetch::startFile() {
+  auto now = std::chrono::steady_clock::now();
+  if (gapPending && now - gapStart > std::chrono::seconds(1)) gapPending = false;  // not an automatic advance
+
+  auto path = mpv->property("path");
+  auto warm = warmup();
+  next = {path, 0, applied && warm.state == State::Done && warm.url == path, false, prefetching};
+  armed = applied = false;
+  warming.clear();
+}
+
+void PlaylistPrefetch::endFile(mpv_event_end_file *event) {
+  gapPending = event->reason == MPV_END_FILE_REASON_EOF;
+  gapStart = std::chrono::steady_clock::now();
+}
+
+void PlaylistPrefetch::onLoad() {
+  if (redirectFrom.empty() || mpv->property("stream-open-filename") != redirectFrom) return;
+  mpv->property("stream-open-filename", redirectTo.c_str());
+  next.redirected = true;
+}
+
+void PlaylistPrefetch::restarted() {
+  // open finished, a signed URL must not outlive the item it was resolved for
+  redirectFrom.clear();
+  redirectTo.clear();
+  if (prefetching) {
+    mpv->commandv("set", "prefetch-playlist", "no", nullptr);
+    prefetching = false;
+  }
+
+  if (!gapPending) return;
+  gapPending = false;
+  next.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gapStart).count();
+  recent.push_back(next);
+  if (recent.size() > MaxGaps) recent.pop_front();
+}
+
+std::string PlaylistPrefetch::nextUrl() {
+  auto pos = mpv->property<int64_t, MPV_FORMAT_INT64>("playlist-playing-pos");
+  auto count = mpv->property<int64_t, MPV_FORMAT_INT64>("playlist-count");
+  if (pos < 0) return "";
+  auto index = pos + 1;
+  if (index >= count) {
+    if (mpv->property("loop-playlist") == "no" || count < 2) return "";
+    index = 0;
+  }
+  return mpv->property(fmt::format("playlist/{}/filename", index).c_str());
+}
+
+void PlaylistPrefetch::start(const std::string &url) {
+  TRACE_FUNC();
+  cancel();
+  // curl paces itself, mpv's prefetch-playlist waits for the current file to be fully cached
+  auto share = cache->status().throughput * std::clamp(config->Data.Prefetch.Share, 1, 100) / 100;
+  auto rate = std::max(MinRate, (int64_t)share);
+  job = std::make_unique<Job>();
+  job->id = ++jobs;
+  {
+    std::lock_guard<std::mutex> l(lock);
+    current = {State::Running, url, "", 0};
+    currentJob = job->id;
+  }
+  job->thread = std::thread(&PlaylistPrefetch::run, this, job.get(), url, rate);
+}
+
+void PlaylistPrefetch::cancel() {
+  if (job) {
+    job->cancelled = true;
+    retired.push_back(std::move(job));
+  }
+  std::erase_if(retired, [](auto &old) {
+    if (!old->finished) return false;
+    old->thread.join();
+    return true;
+  });
+}
+
+void PlaylistPrefetch::run(Job *job, std::string url, int64_t rate) {
+  auto started = std::chrono::steady_clock::now();
+  std::vector<std::string> args = {
+      "curl", "-fsSL", "-o", NullDevice, "-r", fmt::format("0-{}", WarmBytes - 1), "--max-time",
+      std::to_string(WarmTimeout), "--limit-rate", std::to_string(rate), "-w", "%{url_effective}", url,
+  };
+  std::string resolved;
+  int status = mpv->subprocess(args, job->cancelled, &resolved);
+
+  {
+    std::lock_guard<std::mutex> l(lock);
+    if (job->id == currentJob) {  // not replaced by a later warm-up
+      current.state = status == 0 && !resolved.empty() ? State::Done : State::Failed;
+      current.resolved = resolved;
+      current.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    }
+  }
+  job->finished = true;
+}
+}  // namespace ImPlay
@@ -0,0 +1,110 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cstring>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "helpers/trace.h"
+#include "readahead.h"
+
+namespace ImPlay {
+#ifndef _WIN32
+static void advise(int fd, int64_t offset, int64_t length) {
+  if (length <= 0) return;
+#ifdef __APPLE__
+  radvisory ra{(off_t)offset, (int)std::min<int64_t>(length, INT32_MAX)};
+  fcntl(fd, F_RDADVISE, &ra);
+#else
+  posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+#endif
+}
+
+static uint64_t bigEndian(const unsigned char *p, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) value = value << 8 | p[i];
+  return value;
+}
+
+// Offset and length of the top level moov box of an MP4/MOV, false if there is none to be
+// found in the first few boxes.
+static bool findMoov(int fd, int64_t size, int64_t &offset, int64_t &length) {
+  int64_t pos = 0;
+  for (int i = 0; i < 16 && pos + 8 <= size; i++) {
+    unsigned char header[16];
+    if (pread(fd, header, sizeof(header), pos) < 8) return false;
+    int64_t box = (int64_t)bigEndian(header, 4);
+    if (box == 1) box = (int64_t)bigEndian(header + 8, 8);  // 64 bit largesize
+    if (box == 0) box = size - pos;                       // up to the end of the file
+    if (box < 8) return false;
+    if (i == 0 && memcmp(header + 4, "ftyp", 4) != 0) return false;
+    if (memcmp(header + 4, "moov", 4) == 0) {
+      offset = pos;
+      length = std::min(box, size - pos);
+      return true;
+    }
+    pos += box;
+  }
+  return false;
+}
+#endif
+
+Readahead::Readahead() { worker = std::thread(&Readahead::run, this); }
+
+Readahead::~Readahead() {
+  {
+    std::lock_guard<std::mutex> l(lock);
+    quit = true;
+  }
+  cond.notify_all();
+  worker.join();
+}
+
+void Readahead::queue(const std::filesystem::path &path) {
+  {
+    std::lock_guard<std::mutex> l(lock);
+    if (path == last || pending.size() >= MaxPending) return;
+    last = path;
+    pending.push_back(path);
+  }
+  cond.notify_one();
+}
+
+void Readahead::run() {
+  while (true) {
+    std::filesystem::path path;
+    {
+      std::unique_lock<std::mutex> l(lock);
+      cond.wait(l, [this] { return quit || !pending.empty(); });
+      if (quit) return;
+      path = std::move(pending.front());
+      pending.pop_front();
+    }
+    warm(path);
+  }
+}
+
+void Readahead::warm(const std::filesystem::path &path) {
+#ifndef _WIN32
+  TRACE_FUNC();
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(path, ec)) return;
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return;
+  int64_t size = (int64_t)std::filesystem::file_size(path, ec);
+  if (!ec && size > 0) {
+    advise(fd, 0, std::min(size, HeadBytes));
+    int64_t offset, length;
+    if (findMoov(fd, size, offset, length)) {
+      // the head is already on its way, a faststart moov is in it
+      if (offset + length > HeadBytes) advise(fd, offset, std::min(length, MaxIndexBytes));
+    } else if (size > HeadBytes) {
+      advise(fd, std::max(HeadBytes, size - TailBytes), std::min(TailBytes, size - HeadBytes));
+    }
+  }
+  close(fd);
+#endif
+}
+}  // namespace ImPlay
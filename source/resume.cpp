@@ -0,0 +1,300 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <fmt/format.h>
+#include <fmt/color.h>
+#include "helpers/trace.h"
+#include "resume.h"
+
+namespace ImPlay {
+static constexpr uint64_t fnv1a(std::string_view str) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (char c : str) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+ResumeStore::~ResumeStore() {
+  {
+    std::lock_guard<std::mutex> l(waitLock);
+    quit = true;
+  }
+  cond.notify_all();
+  if (worker.joinable()) worker.join();
+  flush();
+}
+
+bool ResumeStore::open(const std::filesystem::path &path_) {
+  TRACE_FUNC();
+  path = path_;
+  {
+    std::lock_guard<std::mutex> l(fileLock);
+    size_t initial = sizeof(Header) + InitialSlots * sizeof(uint64_t);
+    if (!file.open(path, true, initial)) {
+      fmt::print(fg(fmt::color::red), "Failed to open resume database: {}\n", path.string());
+      return false;
+    }
+    auto h = header();
+    if (h.magic == 0 && h.end == 0) {  // new file
+      setHeader({Magic, Version, InitialSlots, 0, initial, 0});
+    } else if (h.magic != Magic || h.version != Version || h.end > file.size() || h.slotCount == 0 ||
+               (h.slotCount & (h.slotCount - 1)) != 0 ||
+               h.end < sizeof(Header) + (uint64_t)h.slotCount * sizeof(uint64_t)) {
+      fmt::print(fg(fmt::color::red), "Discarding invalid resume database: {}\n", path.string());
+      file.close();
+      std::error_code ec;
+      std::filesystem::remove(path, ec);
+      if (!file.open(path, true, initial)) return false;
+      setHeader({Magic, Version, InitialSlots, 0, initial, 0});
+    }
+  }
+  worker = std::thread(&ResumeStore::run, this);
+  return true;
+}
+
+std::optional<ResumeStore::State> ResumeStore::find(std::string_view key) {
+  {
+    std::lock_guard<std::mutex> l(waitLock);
+    if (auto it = pending.find(std::string(key)); it != pending.end()) return it->second;
+  }
+
+  std::lock_guard<std::mutex> l(fileLock);
+  if (!file.valid()) return std::nullopt;
+  int64_t index = probe(key, fnv1a(key), nullptr);
+  if (index < 0) return std::nullopt;
+  uint64_t offset = slot((uint32_t)index);
+  auto r = record(offset);
+  if (!r || r->flags & Flags_Removed) return std::nullopt;
+
+  State state{r->position, r->audioDelay, r->subDelay, r->lastPlayed};
+  auto str = reinterpret_cast<const char *>(file.data()) + offset + sizeof(Record) + r->keyLength;
+  state.aid.assign(str, r->aidLength);
+  state.vid.assign(str += r->aidLength, r->vidLength);
+  state.sid.assign(str += r->vidLength, r->sidLength);
+  return state;
+}
+
+void ResumeStore::checkpoint(const std::string &key, State state) {
+  {
+    std::lock_guard<std::mutex> l(waitLock);
+    pending[key] = std::move(state);
+  }
+  cond.notify_one();
+}
+
+void ResumeStore::remove(const std::string &key) {
+  {
+    std::lock_guard<std::mutex> l(waitLock);
+    pending[key] = std::nullopt;
+  }
+  cond.notify_one();
+}
+
+void ResumeStore::flush() {
+  std::lock_guard<std::mutex> l(fileLock);
+  drain();
+}
+
+size_t ResumeStore::size() {
+  std::lock_guard<std::mutex> l(fileLock);
+  return file.valid() ? header().slotsUsed : 0;
+}
+
+void ResumeStore::run() {
+  TRACE_THREAD("Resume store");
+  std::unique_lock<std::mutex> l(waitLock);
+  while (!quit) {
+    cond.wait(l, [this] { return quit || !pending.empty(); });
+    if (quit) break;
+    l.unlock();
+    {
+      std::lock_guard<std::mutex> f(fileLock);
+      drain();
+    }
+    l.lock();
+  }
+}
+
+// Writes out the queued changes. Call with fileLock held.
+void ResumeStore::drain() {
+  std::map<std::string, std::optional<State>> batch;
+  {
+    std::lock_guard<std::mutex> l(waitLock);
+    batch.swap(pending);
+  }
+  if (batch.empty() || !file.valid()) return;
+
+  TRACE_ZONE("ResumeStore::drain");
+  for (auto &[key, state] : batch) write(key, state);
+  file.flush();
+}
+
+ResumeStore::Header ResumeStore::header() const {
+  Header h{};
+  if (file.size() >= sizeof(Header)) std::memcpy(&h, file.data(), sizeof(Header));
+  return h;
+}
+
+void ResumeStore::setHeader(const Header &h) { std::memcpy(file.data(), &h, sizeof(Header)); }
+
+uint64_t ResumeStore::slot(uint32_t index) const {
+  uint64_t offset;
+  std::memcpy(&offset, file.data() + sizeof(Header) + index * sizeof(uint64_t), sizeof(offset));
+  return offset;
+}
+
+void ResumeStore::setSlot(uint32_t index, uint64_t offset) {
+  std::memcpy(file.data() + sizeof(Header) + index * sizeof(uint64_t), &offset, sizeof(offset));
+}
+
+std::optional<ResumeStore::Record> ResumeStore::record(uint64_t offset) const {
+  auto h = header();
+  if (offset + sizeof(Record) > h.end) return std::nullopt;
+  Record r;
+  std::memcpy(&r, file.data() + offset, sizeof(Record));
+  if (r.size < sizeof(Record) || offset + r.size > h.end) return std::nullopt;
+  if (sizeof(Record) + (size_t)r.keyLength + r.aidLength + r.vidLength + r.sidLength > r.size) return std::nullopt;
+  return r;
+}
+
+std::string_view ResumeStore::recordKey(const Record &r, uint64_t offset) const {
+  return {reinterpret_cast<const char *>(file.data()) + offset + sizeof(Record), r.keyLength};
+}
+
+// Index of the slot holding key, or -1 with *free set to the slot it would go in.
+int64_t ResumeStore::probe(std::string_view key, uint64_t hash, uint32_t *free) const {
+  auto h = header();
+  uint32_t mask = h.slotCount - 1;
+  for (uint32_t i = hash & mask, n = 0; n < h.slotCount; i = (i + 1) & mask, n++) {
+    uint64_t offset = slot(i);
+    if (offset == 0) {
+      if (free != nullptr) *free = i;
+      return -1;
+    }
+    auto r = record(offset);
+    if (r && r->hash == hash && recordKey(*r, offset) == key) return i;
+  }
+  if (free != nullptr) *free = UINT32_MAX;
+  return -1;
+}
+
+// Appends a record for key and points its slot at it. Call with fileLock held.
+void ResumeStore::write(const std::string &key, const std::optional<State> &state) {
+  if (key.size() > UINT16_MAX) return;
+  uint64_t hash = fnv1a(key);
+  uint32_t free = UINT32_MAX;
+  int64_t index = probe(key, hash, &free);
+  if (index < 0 && !state) return;  // nothing to remove
+
+  auto h = header();
+  if (index < 0 && (h.slotsUsed + 1) * 2 > h.slotCount) {
+    if (!rebuild(h.slotCount * 2)) return;
+    h = header();
+    probe(key, hash, &free);
+  }
+  if (index < 0 && free == UINT32_MAX) return;
+
+  std::string aid = state ? state->aid.substr(0, UINT16_MAX) : "";
+  std::string vid = state ? state->vid.substr(0, UINT16_MAX) : "";
+  std::string sid = state ? state->sid.substr(0, UINT16_MAX) : "";
+  Record r{};
+  r.hash = hash;
+  r.size = (uint32_t)(sizeof(Record) + key.size() + aid.size() + vid.size() + sid.size());
+  r.size = (r.size + 7) & ~7u;
+  r.flags = state ? Flags_None : Flags_Removed;
+  if (state) {
+    r.position = state->position;
+    r.audioDelay = state->audioDelay;
+    r.subDelay = state->subDelay;
+    r.lastPlayed = state->lastPlayed;
+  }
+  r.keyLength = (uint16_t)key.size();
+  r.aidLength = (uint16_t)aid.size();
+  r.vidLength = (uint16_t)vid.size();
+  r.sidLength = (uint16_t)sid.size();
+
+  if (h.end + r.size > file.size() && !file.resize(std::max<size_t>(file.size() * 2, h.end + r.size))) {
+    fmt::print(fg(fmt::color::red), "Failed to grow resume database: {}\n", path.string());
+    return;
+  }
+
+  // the record goes in first, the slot and header only point at complete records
+  uint64_t offset = h.end;
+  auto dst = file.data() + offset;
+  std::memset(dst, 0, r.size);
+  std::memcpy(dst, &r, sizeof(Record));
+  dst += sizeof(Record);
+  for (auto *str : std::initializer_list<const std::string *>{&key, &aid, &vid, &sid}) {
+    std::memcpy(dst, str->data(), str->size());
+    dst += str->size();
+  }
+  h.end += r.size;
+  if (index >= 0) {
+    if (auto old = record(slot((uint32_t)index))) h.garbage += old->size;
+  } else {
+    h.slotsUsed++;
+    index = free;
+  }
+  setHeader(h);
+  setSlot((uint32_t)index, offset);
+
+  uint64_t tableEnd = sizeof(Header) + (uint64_t)h.slotCount * sizeof(uint64_t);
+  if (h.garbage > MinGarbage && h.garbage * 2 > h.end - tableEnd) rebuild(h.slotCount);
+}
+
+// Rewrites the file with only the live records, into a table of slotCount slots.
+// Call with fileLock held.
+bool ResumeStore::rebuild(uint32_t slotCount) {
+  TRACE_FUNC();
+  auto h = header();
+  std::vector<std::pair<uint64_t, uint64_t>> live;  // hash, offset
+  uint64_t liveBytes = 0;
+  for (uint32_t i = 0; i < h.slotCount; i++) {
+    uint64_t offset = slot(i);
+    auto r = offset != 0 ? record(offset) : std::nullopt;
+    if (!r || r->flags & Flags_Removed) continue;
+    live.emplace_back(r->hash, offset);
+    liveBytes += r->size;
+  }
+  while (live.size() * 2 > slotCount) slotCount *= 2;
+
+  uint64_t tableEnd = sizeof(Header) + (uint64_t)slotCount * sizeof(uint64_t);
+  std::vector<std::byte> buf(tableEnd + liveBytes);
+  uint64_t end = tableEnd;
+  for (auto &[hash, offset] : live) {
+    auto r = *record(offset);
+    std::memcpy(buf.data() + end, file.data() + offset, r.size);
+    uint32_t i = hash & (slotCount - 1);
+    for (uint64_t s;; i = (i + 1) & (slotCount - 1)) {
+      std::memcpy(&s, buf.data() + sizeof(Header) + i * sizeof(uint64_t), sizeof(s));
+      if (s == 0) break;
+    }
+    std::memcpy(buf.data() + sizeof(Header) + i * sizeof(uint64_t), &end, sizeof(end));
+    end += r.size;
+  }
+  Header nh{Magic, Version, slotCount, (uint32_t)live.size(), end, 0};
+  std::memcpy(buf.data(), &nh, sizeof(Header));
+
+  auto tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+    if (!out) {
+      fmt::print(fg(fmt::color::red), "Failed to write resume database: {}\n", tmp.string());
+      return false;
+    }
+  }
+  file.close();
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) fmt::print(fg(fmt::color::red), "Failed to replace resume database: {}\n", ec.message());
+  // leave room to append before the next resize
+  return file.open(path, true, buf.size() + std::max<size_t>(liveBytes, 64 * 1024)) && !ec;
+}
+}  // namespace ImPlay
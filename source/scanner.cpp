@@ -0,0 +1,106 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <strnatcmp.h>
+#include "helpers/trace.h"
+#include "helpers/utils.h"
+#include "scanner.h"
+
+namespace ImPlay {
+static std::string toUtf8(const std::filesystem::path &path) {
+  auto str = path.u8string();
+  return std::string(reinterpret_cast<const char *>(str.data()), str.size());
+}
+
+FolderScanner::FolderScanner(Mpv *mpv, Filter filter) : mpv(mpv), filter(std::move(filter)) {}
+
+FolderScanner::~FolderScanner() {
+  cancel();
+  if (worker.joinable()) worker.join();
+}
+
+void FolderScanner::start(std::vector<std::filesystem::path> roots, bool append_) {
+  cancel();
+  if (worker.joinable()) worker.join();
+
+  cancelled = false;
+  files = 0;
+  folders = 0;
+  append = append_;
+  sent = false;
+  batch.clear();
+  active = true;
+  worker = std::thread(&FolderScanner::run, this, std::move(roots));
+}
+
+std::string FolderScanner::currentFolder() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return current;
+}
+
+void FolderScanner::run(std::vector<std::filesystem::path> roots) {
+  TRACE_THREAD("Folder scanner");
+  TRACE_ZONE("FolderScanner::run");
+  lastFlush = std::chrono::steady_clock::now();
+  for (auto &root : roots) {
+    if (cancelled) break;
+    scan(root);
+  }
+  flush();
+  active = false;
+}
+
+void FolderScanner::scan(const std::filesystem::path &dir) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    current = toUtf8(dir);
+  }
+
+  std::vector<std::pair<std::string, std::filesystem::path>> entries, subdirs;
+  std::error_code ec;
+  auto options = std::filesystem::directory_options::skip_permission_denied;
+  for (std::filesystem::directory_iterator it(dir, options, ec), end; !ec && it != end; it.increment(ec)) {
+    if (cancelled) return;
+    std::error_code err;
+    // symlinked folders are not followed, like recursive_directory_iterator
+    if (it->is_directory(err) && !it->is_symlink(err))
+      subdirs.emplace_back(toUtf8(it->path().filename()), it->path());
+    else if (filter(it->path()))
+      entries.emplace_back(toUtf8(it->path().filename()), it->path());
+  }
+  folders++;
+
+  auto natural = [](const auto &a, const auto &b) { return strnatcasecmp(a.first.c_str(), b.first.c_str()) < 0; };
+  std::sort(entries.begin(), entries.end(), natural);
+  std::sort(subdirs.begin(), subdirs.end(), natural);
+
+  for (auto &[name, path] : entries) add(path);
+  for (auto &[name, path] : subdirs) {
+    if (cancelled) return;
+    scan(path);
+  }
+}
+
+void FolderScanner::add(const std::filesystem::path &path) {
+  auto str = toUtf8(path);
+  if (str.find_first_of("\r\n") != std::string::npos) return;  // not representable in M3U
+  batch.push_back(std::move(str));
+  files++;
+
+  auto now = std::chrono::steady_clock::now();
+  if (!sent || batch.size() >= BatchSize || now - lastFlush >= BatchInterval) flush();
+}
+
+void FolderScanner::flush() {
+  lastFlush = std::chrono::steady_clock::now();
+  if (cancelled) batch.clear();  // a superseded scan must not append to the new listing
+  if (batch.empty()) return;
+
+  std::string playlist = "memory://#EXTM3U";
+  for (auto &path : batch) playlist.append("\n").append(path);
+  mpv->commandv("loadlist", playlist.c_str(), sent || append ? "append" : "replace", nullptr);
+  sent = true;
+  batch.clear();
+}
+}  // namespace ImPlay
@@ -0,0 +1,544 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <fmt/format.h>
+#include <fmt/color.h>
+#include "helpers/media_types.h"
+#include "helpers/subtitle_text.h"
+#include "helpers/trace.h"
+#include "subtitle_cache.h"
+
+namespace ImPlay {
+namespace {
+struct Language {
+  std::string_view code, code3, name;
+  int codepage;  // legacy Windows codepage of old subtitles, 0 when it is not a single byte one
+};
+
+// Provider subtitle names carry either a code or the English name, match both.
+constexpr Language Languages[] = {
+    {"en", "eng", "english", 1252},   {"es", "spa", "spanish", 1252},    {"fr", "fre", "french", 1252},
+    {"de", "ger", "german", 1252},    {"it", "ita", "italian", 1252},    {"pt", "por", "portuguese", 1252},
+    {"ru", "rus", "russian", 1251},   {"zh", "chi", "chinese", 0},       {"ja", "jpn", "japanese", 0},
+    {"ko", "kor", "korean", 0},       {"ar", "ara", "arabic", 1256},     {"nl", "dut", "dutch", 1252},
+    {"pl", "pol", "polish", 1250},    {"tr", "tur", "turkish", 1254},    {"sv", "swe", "swedish", 1252},
+    {"uk", "ukr", "ukrainian", 1251}, {"hi", "hin", "hindi", 0},         {"he", "heb", "hebrew", 1255},
+    {"el", "gre", "greek", 1253},     {"cs", "cze", "czech", 1250},      {"ro", "rum", "romanian", 1250},
+    {"hu", "hun", "hungarian", 1250}, {"fi", "fin", "finnish", 1252},    {"da", "dan", "danish", 1252},
+    {"no", "nor", "norwegian", 1252}, {"id", "ind", "indonesian", 1252}, {"vi", "vie", "vietnamese", 0},
+    {"th", "tha", "thai", 0},
+};
+
+std::string lower(std::string_view str) {
+  std::string ret(str);
+  std::transform(ret.begin(), ret.end(), ret.begin(), [](unsigned char c) { return std::tolower(c); });
+  return ret;
+}
+
+const Language *findLanguage(std::string_view code) {
+  for (auto &lang : Languages)
+    if (code == lang.code || code == lang.code3 || code == lang.name) return &lang;
+  return nullptr;
+}
+
+std::vector<std::string> words(std::string_view text) {
+  std::vector<std::string> ret;
+  auto str = lower(text);
+  for (size_t i = 0; i < str.size();) {
+    if (!std::isalnum(static_cast<unsigned char>(str[i]))) {
+      i++;
+      continue;
+    }
+    size_t start = i;
+    while (i < str.size() && std::isalnum(static_cast<unsigned char>(str[i]))) i++;
+    ret.push_back(str.substr(start, i - start));
+  }
+  return ret;
+}
+
+// Codepage for the language a name mentions: "Arabic", "ara" or, as in movie.ar.srt, a two
+// letter code near the end. Short codes elsewhere are too likely to be ordinary words.
+int codepageOf(std::string_view name) {
+  auto list = words(name);
+  for (auto &word : list)
+    for (auto &lang : Languages)
+      if (word == lang.name || word == lang.code3) return lang.codepage;
+  for (size_t i = list.size() > 2 ? list.size() - 2 : 0; i < list.size(); i++)
+    for (auto &lang : Languages)
+      if (list[i] == lang.code) return lang.codepage;
+  return 0;
+}
+
+std::string readFile(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream data;
+  data << file.rdbuf();
+  return data.str();
+}
+
+uint64_t fnv1a(const std::string &data) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (char c : data) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+std::string contentKey(const std::string &data) { return fmt::format("{:016x}-{}", fnv1a(data), data.size()); }
+
+// Normalized copies depend on the codepage hint as much as on the content.
+std::string normalizedKey(const std::string &key, int codepage) {
+  return codepage != 0 ? fmt::format("{}~cp{}", key, codepage) : key;
+}
+
+// Whether a subtitle is text that can be converted. .sub is either MicroDVD text, lines like
+// {100}{200}Text, or the picture half of VobSub; without an extension, as behind a provider
+// download link, anything without NUL bytes is.
+bool isText(const std::string &ext, std::string_view data) {
+  static constexpr std::string_view Text[] = {".srt", ".ass", ".ssa", ".vtt", ".smi", ".sami", ".txt"};
+  if (std::find(std::begin(Text), std::end(Text), ext) != std::end(Text)) return true;
+  if (ext.empty()) {
+    if (data.starts_with("\xff\xfe") || data.starts_with("\xfe\xff")) return true;  // UTF-16
+    return data.substr(0, 4096).find('\0') == std::string_view::npos;
+  }
+  if (ext != ".sub") return false;
+
+  if (data.starts_with("\xef\xbb\xbf")) data.remove_prefix(3);
+  while (!data.empty() && std::isspace(static_cast<unsigned char>(data.front()))) data.remove_prefix(1);
+  for (int field = 0; field < 2; field++) {
+    if (data.empty() || data.front() != '{') return false;
+    data.remove_prefix(1);
+    size_t digits = 0;
+    while (digits < data.size() && std::isdigit(static_cast<unsigned char>(data[digits]))) digits++;
+    if ((digits == 0 && field == 0) || digits >= data.size() || data[digits] != '}') return false;
+    data.remove_prefix(digits + 1);
+  }
+  return true;
+}
+
+// The LRU order of the cache is the modification time, refreshed on every use.
+void touch(const std::filesystem::path &path) {
+  std::error_code ec;
+  std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+}
+}  // namespace
+
+SubtitleCache::SubtitleCache(Mpv *mpv) : mpv(mpv) {}
+
+SubtitleCache::~SubtitleCache() {
+  {
+    std::lock_guard<std::mutex> l(lock);
+    quit = true;
+  }
+  cond.notify_all();
+  for (auto &worker : workers) worker.join();
+}
+
+bool SubtitleCache::open(const std::filesystem::path &dir_) {
+  TRACE_FUNC();
+  dir = dir_;
+  std::error_code ec;
+  std::filesystem::remove_all(dir / "tmp", ec);
+  std::filesystem::create_directories(dir / "objects", ec);
+  std::filesystem::create_directories(dir / "normalized", ec);
+  std::filesystem::create_directories(dir / "tmp", ec);
+  if (ec) {
+    fmt::print(fg(fmt::color::red), "Failed to create subtitle cache: {}\n", dir.string());
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> l(lock);
+    std::ifstream index(dir / "index.tsv");
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(index, line)) {
+      lines++;
+      auto tab = line.find('\t');
+      if (tab == std::string::npos) continue;
+      auto path = dir / "objects" / line.substr(0, tab);
+      if (!std::filesystem::exists(path, ec)) continue;
+      auto &entry = entries[line.substr(tab + 1)];
+      entry.state = State::Ready;
+      entry.path = path;
+      entry.object = line.substr(0, tab);
+      // the name is not known yet, prefetch has it normalized again when it hints a codepage
+      if (auto found = normalized(path.stem().string(), path.extension().string()); !found.empty())
+        entry.path = found.extension() == ".clean" ? path : found;
+    }
+    // appending leaves a line per download, also for URLs downloaded again
+    index.close();
+    if (lines > entries.size()) writeIndex();
+    ready = true;
+  }
+
+  evict();
+  return true;
+}
+
+void SubtitleCache::prefetch(const std::vector<Item> &items) {
+  std::lock_guard<std::mutex> l(lock);
+  queue.clear();
+  for (auto &[url, entry] : entries) {
+    if (entry.state == State::Queued) entry.state = State::Unknown;
+    entry.selectPending = false;
+  }
+  if (!ready || noCurl) return;
+
+  for (auto &item : items) {
+    if (item.url.find("://") == std::string::npos) continue;  // local files need no caching
+    auto &entry = entries[item.url];
+    entry.name = item.name;
+    bool rehint = entry.state == State::Ready && !entry.object.empty() && entry.codepage != codepageOf(item.name);
+    if (entry.state != State::Unknown && entry.state != State::Failed && !rehint) continue;
+    entry.state = State::Queued;
+    queue.push_back(item.url);
+  }
+  startWorkers();
+  cond.notify_all();
+}
+
+SubtitleCache::State SubtitleCache::state(const std::string &url) {
+  std::lock_guard<std::mutex> l(lock);
+  auto it = entries.find(url);
+  return it != entries.end() ? it->second.state : State::Unknown;
+}
+
+void SubtitleCache::select(const std::string &url, const std::string &title) {
+  std::unique_lock<std::mutex> l(lock);
+  if (auto it = entries.find(url); it != entries.end()) {
+    auto &entry = it->second;
+    std::error_code ec;
+    switch (entry.state) {
+      case State::Ready:
+        if (std::filesystem::exists(entry.path, ec)) {
+          touch(entry.path);
+          auto path = entry.path.string();
+          l.unlock();
+          add(path, title);
+          return;
+        }
+        entry.state = State::Unknown;  // removed from under us
+        break;
+      case State::Queued:
+        queue.erase(std::find(queue.begin(), queue.end(), url));
+        queue.push_front(url);
+        [[fallthrough]];
+      case State::Fetching:
+        entry.selectPending = true;
+        entry.title = title;
+        return;
+      default:
+        break;
+    }
+  }
+  l.unlock();
+  add(url, title);
+}
+
+void SubtitleCache::addFile(const std::filesystem::path &path, const char *flag) {
+  {
+    std::lock_guard<std::mutex> l(lock);
+    if (ready) {
+      locals.push_back({path, flag});
+      startWorkers();
+      cond.notify_one();
+      return;
+    }
+  }
+  add(path.string(), "", flag);
+}
+
+std::vector<SubtitleCache::Report> SubtitleCache::reports() {
+  std::lock_guard<std::mutex> l(lock);
+  return {history.begin(), history.end()};
+}
+
+void SubtitleCache::startWorkers() {
+  size_t wanted = std::min<size_t>(MaxConnections, running + queue.size() + locals.size());
+  while (workers.size() < wanted) workers.emplace_back(&SubtitleCache::run, this, (int)workers.size());
+}
+
+void SubtitleCache::run(int worker) {
+  std::unique_lock<std::mutex> l(lock);
+  while (true) {
+    cond.wait(l, [this] { return quit || !queue.empty() || !locals.empty(); });
+    if (quit) return;
+    running++;
+    if (!locals.empty()) {
+      auto file = std::move(locals.front());
+      locals.pop_front();
+      l.unlock();
+      addLocal(file);
+    } else {
+      auto url = std::move(queue.front());
+      queue.pop_front();
+      entries[url].state = State::Fetching;
+      l.unlock();
+      fetch(url, worker);
+    }
+    l.lock();
+    running--;
+    if (cachedBytes > MaxCacheBytes) {
+      l.unlock();
+      evict();
+      l.lock();
+    }
+  }
+}
+
+void SubtitleCache::fetch(const std::string &url, int worker) {
+  TRACE_ZONE("fetch subtitle");
+  std::string name;
+  std::filesystem::path object;
+  {
+    std::lock_guard<std::mutex> l(lock);
+    auto &entry = entries[url];
+    name = entry.name;
+    if (!entry.object.empty()) object = dir / "objects" / entry.object;
+  }
+
+  std::error_code ec;
+  std::filesystem::path path;
+  if (!object.empty() && std::filesystem::exists(object, ec)) {
+    // downloaded before, only to be normalized for the codepage its name hints
+    path = prepare(object, readFile(object), name);
+  } else {
+    auto download = dir / "tmp" / fmt::format("{}.part", worker);
+    std::filesystem::remove(download, ec);
+    int status = mpv->subprocess({"curl", "-fsSL", "--connect-timeout", "5", "--max-time", "30", "--max-filesize",
+                                  std::to_string(MaxFileSize), "-o", download.string(), url},
+                                 quit);
+    if (status < 0 && !quit && !noCurl.exchange(true))
+      fmt::print(fg(fmt::color::red), "Failed to run curl, provider subtitles are no longer downloaded ahead\n");
+    if (status == 0) {
+      auto data = readFile(download);
+      if (auto stored = store(url, download, data); !stored.empty()) path = prepare(stored, data, name);
+    }
+    std::filesystem::remove(download, ec);
+  }
+
+  std::string title;
+  {
+    std::lock_guard<std::mutex> l(lock);
+    auto &entry = entries[url];
+    entry.state = path.empty() ? State::Failed : State::Ready;
+    entry.path = path;
+    entry.codepage = codepageOf(name);
+    if (!entry.selectPending || quit) return;
+    entry.selectPending = false;
+    title = entry.title;
+  }
+  add(path.empty() ? url : path.string(), title);
+}
+
+std::filesystem::path SubtitleCache::store(const std::string &url, const std::filesystem::path &download,
+                                           const std::string &data) {
+  if (data.empty()) return {};
+
+  // keep a subtitle extension from the URL, mpv picks the demuxer by it before probing
+  std::string_view name(url);
+  name = name.substr(0, name.find_first_of("?#"));
+  std::string ext;
+  if (mediaTypeOf(name) == MediaType::Subtitle) ext = lower(name.substr(name.rfind('.')));
+
+  auto object = contentKey(data) + ext;
+  auto path = dir / "objects" / object;
+  std::error_code ec;
+  bool added = !std::filesystem::exists(path, ec);
+  if (added) {
+    std::filesystem::rename(download, path, ec);
+    if (ec) return {};
+  } else {
+    touch(path);
+  }
+
+  std::lock_guard<std::mutex> l(lock);
+  if (added) cachedBytes += data.size();
+  if (url.find_first_of("\t\n") == std::string::npos) {
+    entries[url].object = object;
+    std::ofstream index(dir / "index.tsv", std::ios::app);
+    index << object << '\t' << url << '\n';
+  }
+  return path;
+}
+
+std::filesystem::path SubtitleCache::prepare(const std::filesystem::path &source, const std::string &data,
+                                             const std::string &name) {
+  TRACE_FUNC();
+  auto t0 = std::chrono::steady_clock::now();
+  auto ext = lower(source.extension().string());
+  Report report{name.empty() ? source.filename().string() : name};
+  if (!isText(ext, data)) {
+    // picture subtitles (PGS, VobSub) go to mpv untouched
+    report.encoding = "binary";
+    std::lock_guard<std::mutex> l(lock);
+    history.push_back(std::move(report));
+    if (history.size() > MaxReports) history.pop_front();
+    return source;
+  }
+
+  int codepage = codepageOf(report.name);
+  auto key = normalizedKey(contentKey(data), codepage);
+  auto base = dir / "normalized" / key;
+
+  std::error_code ec;
+  std::filesystem::path result;
+  if (auto found = normalized(key, ext); !found.empty()) {
+    touch(found);
+    result = found.extension() == ".clean" ? source : found;
+    report.encoding = "-";
+    report.cached = true;
+  }
+
+  if (result.empty()) {
+    auto normalized = SubtitleText::normalize(data, codepage);
+    report.encoding = SubtitleText::encodingName(normalized.encoding);
+    if (normalized.codepage != 0) report.encoding = fmt::format("CP{}", normalized.codepage);
+    report.repairs = normalized.repairs;
+    if (normalized.changed) {
+      // written under a temporary name first, a half written file must never be found by key
+      auto path = dir / "normalized" / (key + (normalized.srt ? ".srt" : ext));
+      auto tmp = dir / "tmp" / (key + ".norm");
+      std::ofstream(tmp, std::ios::binary).write(normalized.text.data(), normalized.text.size());
+      std::filesystem::rename(tmp, path, ec);
+      result = ec ? source : path;
+      if (!ec) {
+        std::lock_guard<std::mutex> l(lock);
+        cachedBytes += normalized.text.size();
+      }
+    } else {
+      std::ofstream(base.string() + ".clean");
+      result = source;
+    }
+  }
+
+  report.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  std::lock_guard<std::mutex> l(lock);
+  history.push_back(std::move(report));
+  if (history.size() > MaxReports) history.pop_front();
+  return result;
+}
+
+std::filesystem::path SubtitleCache::normalized(const std::string &key, const std::string &ext) {
+  std::error_code ec;
+  for (auto &candidate : {std::string(".clean"), std::string(".srt"), ext}) {
+    auto path = dir / "normalized" / (key + candidate);
+    if (!candidate.empty() && std::filesystem::exists(path, ec)) return path;
+  }
+  return {};
+}
+
+void SubtitleCache::addLocal(const LocalFile &file) {
+  auto data = readFile(file.path);
+  auto path = data.empty() ? file.path : prepare(file.path, data, "");
+  // the normalized copy is named by its hash, keep the original name on the track
+  add(path.string(), path == file.path ? "" : file.path.filename().string(), file.flag.c_str());
+}
+
+void SubtitleCache::evict() {
+  TRACE_FUNC();
+  // an object and its normalized copies go together, they share the content key
+  struct Group {
+    std::filesystem::file_time_type used;
+    uint64_t bytes = 0;
+    std::vector<std::filesystem::path> files;
+  };
+  std::map<std::string, Group> groups;
+  uint64_t total = 0;
+  for (auto sub : {"objects", "normalized"}) {
+    std::error_code ec;
+    for (auto &file : std::filesystem::directory_iterator(dir / sub, ec)) {
+      std::error_code fec;
+      auto size = file.file_size(fec);
+      auto used = file.last_write_time(fec);
+      if (fec) continue;
+      auto name = file.path().filename().string();
+      auto &group = groups[name.substr(0, name.find_first_of(".~"))];
+      group.bytes += size;
+      group.used = std::max(group.used, used);
+      group.files.push_back(file.path());
+      total += size;
+    }
+  }
+
+  std::vector<std::filesystem::path> removed;
+  if (total > MaxCacheBytes) {
+    std::vector<std::pair<std::filesystem::file_time_type, const Group *>> order;
+    for (auto &[key, group] : groups) order.emplace_back(group.used, &group);
+    std::sort(order.begin(), order.end(), [](auto &a, auto &b) { return a.first < b.first; });
+    std::error_code ec;
+    for (auto &[used, group] : order) {
+      if (total <= MaxCacheBytes) break;
+      for (auto &file : group->files) std::filesystem::remove(file, ec);
+      removed.insert(removed.end(), group->files.begin(), group->files.end());
+      total -= group->bytes;
+    }
+  }
+
+  std::lock_guard<std::mutex> l(lock);
+  cachedBytes = total;
+  if (removed.empty()) return;
+  for (auto &[url, entry] : entries) {
+    if (entry.state != State::Ready) continue;
+    auto object = entry.object.empty() ? std::filesystem::path() : dir / "objects" / entry.object;
+    if (std::find(removed.begin(), removed.end(), entry.path) == removed.end() &&
+        std::find(removed.begin(), removed.end(), object) == removed.end())
+      continue;
+    entry.state = State::Unknown;
+    entry.path.clear();
+    entry.object.clear();
+  }
+  writeIndex();
+}
+
+void SubtitleCache::writeIndex() {
+  auto tmp = dir / "tmp" / "index.tsv";
+  {
+    std::ofstream index(tmp, std::ios::trunc);
+    for (auto &[url, entry] : entries)
+      if (entry.state == State::Ready && !entry.object.empty()) index << entry.object << '\t' << url << '\n';
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, dir / "index.tsv", ec);
+}
+
+void SubtitleCache::add(const std::string &source, const std::string &title, const char *flag) {
+  mpv->commandv("sub-add", source.c_str(), flag, title.empty() ? nullptr : title.c_str(), nullptr);
+}
+
+std::vector<std::string> SubtitleCache::languages(std::string_view slang, std::string_view uiLang) {
+  std::vector<std::string> ret;
+  auto push = [&](std::string_view code) {
+    while (!code.empty() && code.front() == ' ') code.remove_prefix(1);
+    while (!code.empty() && code.back() == ' ') code.remove_suffix(1);
+    auto str = lower(code);
+    if (!str.empty() && std::find(ret.begin(), ret.end(), str) == ret.end()) ret.push_back(str);
+  };
+  for (size_t pos = 0; pos <= slang.size();) {
+    auto end = std::min(slang.find(',', pos), slang.size());
+    push(slang.substr(pos, end - pos));
+    pos = end + 1;
+  }
+  push(uiLang.substr(0, uiLang.find_first_of("-_")));
+  return ret;
+}
+
+size_t SubtitleCache::rank(std::string_view name, const std::vector<std::string> &languages) {
+  auto list = words(name);
+  for (size_t i = 0; i < languages.size(); i++) {
+    auto lang = findLanguage(languages[i]);
+    for (auto &word : list) {
+      if (word == languages[i]) return i;
+      if (lang && (word == lang->code || word == lang->code3 || word == lang->name)) return i;
+    }
+  }
+  return languages.size();
+}
+}  // namespace ImPlay
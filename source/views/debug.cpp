@@ -1,27 +1,56 @@
 // Copyright (c) 2022-2025 tsl0922. All rights reserved.
 // SPDX-License-Identifier: GPL-2.0-only
 
+#include <algorithm>
+#include <chrono>
 #include <cstdarg>
 #include <cstdio>
 #include <map>
 #include "helpers/utils.h"
 #include "helpers/imgui.h"
+#include "helpers/trace.h"
 #include "views/debug.h"
 
 namespace ImPlay::Views {
-Debug::Debug(Config* config, Mpv* mpv) : View(config, mpv) { console = new Console(mpv); }
+Debug::Debug(Config* config, Mpv* mpv) : View(config, mpv) {
+  console = new Console(mpv);
+  inspector = new Inspector(mpv);
+  hud = new Hud(mpv);
+}
 
-Debug::~Debug() { delete console; }
+Debug::~Debug() {
+  delete hud;
+  delete inspector;
+  delete console;
+}
 
-void Debug::init() { console->init(config->Data.Debug.LogLevel.c_str(), config->Data.Debug.LogLimit); }
+void Debug::init() {
+  console->init(config->Data.Debug.LogLevel.c_str(), config->Data.Debug.LogLimit);
+  inspector->setRate(config->Data.Debug.PollRate);
+}
 
 void Debug::show() {
   m_open = true;
   initData();
 }
 
+void Debug::toggleHud() { hud->setVisible(!hud->visible); }
+
+void Debug::addTiming(Timing_ timing, float ms) {
+  if (!hud->visible) return;
+  if (timing == Timing_Video)
+    hud->videoTime = ms;
+  else
+    hud->timings[timing].push(ms);
+}
+
 void Debug::draw() {
-  if (!m_open) return;
+  if (hud->visible) hud->draw();
+  if (!m_open) {
+    inspector->setActive(false);
+    return;
+  }
+  m_polling = false;
   ImVec2 wPos = ImGui::GetMainViewport()->WorkPos;
   ImVec2 wSize = ImGui::GetMainViewport()->WorkSize;
   ImGui::SetNextWindowSizeConstraints(ImVec2(scaled(35), scaled(45)), ImVec2(FLT_MAX, FLT_MAX));
@@ -30,13 +59,19 @@ void Debug::draw() {
                           ImVec2(0.2f, 0.5f));
   if (ImGui::Begin("views.debug.title"_i18n, &m_open, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoScrollbar)) {
     drawHeader();
-    drawProperties("views.debug.options"_i18n, options);
-    drawProperties("views.debug.properties"_i18n, properties);
+    drawWatch();
+    drawProperties("views.debug.options"_i18n, options, optionsSearch);
+    drawProperties("views.debug.properties"_i18n, properties, propertiesSearch);
     drawBindings();
     drawCommands();
+    drawSubtitles();
+    drawLoadTimings();
+    drawPrefetch();
+    drawDiskCache();
     drawConsole();
   }
   ImGui::End();
+  inspector->setActive(m_open && m_polling);
   if (m_demo) ImGui::ShowDemoWindow(&m_demo);
   if (m_metrics) ImGui::ShowMetricsWindow(&m_metrics);
 }
@@ -67,18 +102,196 @@ void Debug::drawConsole() {
   console->draw();
 }
 
+void Debug::drawSubtitles() {
+  if (subtitleCache == nullptr) return;
+  auto reports = subtitleCache->reports();
+  if (m_node != "Subtitles") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
+  if (!ImGui::CollapsingHeader(i18n_a("views.debug.subtitles", reports.size()).c_str())) return;
+  m_node = "Subtitles";
+
+  static ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter |
+                                 ImGuiTableFlags_BordersV | ImGuiTableFlags_NoBordersInBody | ImGuiTableFlags_ScrollY;
+  if (ImGui::BeginTable("subtitle-reports", 4, flags)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("File", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("Encoding", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Repairs", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Time", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableHeadersRow();
+    for (auto it = reports.rbegin(); it != reports.rend(); it++) {  // newest first
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", it->name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", it->encoding.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%d", it->repairs);
+      ImGui::TableNextColumn();
+      if (it->cached)
+        ImGui::TextDisabled("%.2f ms (cached)", it->ms);
+      else
+        ImGui::Text("%.2f ms", it->ms);
+    }
+    ImGui::EndTable();
+  }
+}
+
+void Debug::drawLoadTimings() {
+  if (loadTimings == nullptr) return;
+  auto items = loadTimings->items();
+  if (m_node != "LoadTimings") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
+  if (!ImGui::CollapsingHeader(i18n_a("views.debug.load_timings", items.size()).c_str())) return;
+  m_node = "LoadTimings";
+
+  auto stageColumns = [] {
+    for (int i = 0; i < LoadTimings::Stage_COUNT; i++)
+      ImGui::TableSetupColumn(LoadTimings::stageName((LoadTimings::Stage_)i), ImGuiTableColumnFlags_WidthFixed);
+  };
+  auto msCell = [](double ms) {
+    ImGui::TableNextColumn();
+    if (ms < 0)
+      ImGui::TextDisabled("-");
+    else
+      ImGui::Text("%.0f", ms);
+  };
+  static ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter |
+                                 ImGuiTableFlags_BordersV | ImGuiTableFlags_NoBordersInBody | ImGuiTableFlags_ScrollY;
+
+  // per source: mean over the items that reached each stage, milliseconds since start-file
+  ImGui::TextDisabled("%s", i18n("views.debug.load_timings.sources"));
+  auto stats = loadTimings->stats();
+  ImVec2 size(0, ImGui::GetTextLineHeightWithSpacing() * (std::min<float>((float)stats.size(), 6) + 1.5f));
+  if (ImGui::BeginTable("load-timings-sources", LoadTimings::Stage_COUNT + 2, flags, size)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Source", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed);
+    stageColumns();
+    ImGui::TableHeadersRow();
+    for (auto& [source, stat] : stats) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", source.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%d", stat.count);
+      for (int i = 0; i < LoadTimings::Stage_COUNT; i++) {
+        msCell(stat.mean((LoadTimings::Stage_)i));
+        if (stat.reached[i] > 0 && ImGui::IsItemHovered()) ImGui::SetTooltip("worst: %.0f ms", stat.worst[i]);
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::TextDisabled("%s", i18n("views.debug.load_timings.recent"));
+  if (ImGui::BeginTable("load-timings-items", LoadTimings::Stage_COUNT + 2, flags)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Path", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("Result", ImGuiTableColumnFlags_WidthFixed);
+    stageColumns();
+    ImGui::TableHeadersRow();
+    for (auto it = items.rbegin(); it != items.rend(); it++) {  // newest first
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", it->path.c_str());
+      if (ImGui::IsItemHovered()) ImGui::SetTooltip("%s", it->path.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", it->result.c_str());
+      for (double ms : it->ms) msCell(ms);
+    }
+    ImGui::EndTable();
+  }
+}
+
+void Debug::drawPrefetch() {
+  if (playlistPrefetch == nullptr) return;
+  auto& gaps = playlistPrefetch->gaps();
+  if (m_node != "Prefetch") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
+  if (!ImGui::CollapsingHeader(i18n_a("views.debug.prefetch", gaps.size()).c_str())) return;
+  m_node = "Prefetch";
+
+  auto warm = playlistPrefetch->warmup();
+  ImGui::TextDisabled("%s", i18n("views.debug.prefetch.warmup"));
+  ImGui::SameLine();
+  if (warm.url.empty()) {
+    ImGui::TextUnformatted(PlaylistPrefetch::stateName(warm.state));
+  } else {
+    ImGui::Text("%s %.0f ms: %s", PlaylistPrefetch::stateName(warm.state), warm.ms, warm.url.c_str());
+    if (warm.resolved != warm.url && ImGui::IsItemHovered()) ImGui::SetTooltip("-> %s", warm.resolved.c_str());
+  }
+
+  static ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter |
+                                 ImGuiTableFlags_BordersV | ImGuiTableFlags_NoBordersInBody | ImGuiTableFlags_ScrollY;
+  if (ImGui::BeginTable("prefetch-gaps", 5, flags)) {
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Path", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("Gap", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Warmed", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Redirect", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Prefetch", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableHeadersRow();
+    auto flag = [](bool value) {
+      ImGui::TableNextColumn();
+      if (value)
+        ImGui::TextUnformatted("yes");
+      else
+        ImGui::TextDisabled("-");
+    };
+    for (auto it = gaps.rbegin(); it != gaps.rend(); it++) {  // newest first
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", it->path.c_str());
+      if (ImGui::IsItemHovered()) ImGui::SetTooltip("%s", it->path.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.0f ms", it->ms);
+      flag(it->warmed);
+      flag(it->redirected);
+      flag(it->prefetched);
+    }
+    ImGui::EndTable();
+  }
+}
+
+void Debug::drawDiskCache() {
+  if (diskCache == nullptr) return;
+  auto stats = diskCache->stats();
+  if (m_node != "DiskCache") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
+  if (!ImGui::CollapsingHeader(i18n_a("views.debug.disk_cache", stats.entries).c_str())) return;
+  m_node = "DiskCache";
+
+  auto mib = [](int64_t bytes) { return bytes / 1048576.0; };
+  if (ImGui::BeginTable("disk-cache", 2, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter)) {
+    ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthStretch);
+    auto row = [](const char* name, const std::string& value) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextDisabled("%s", name);
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(value.c_str());
+    };
+    row("Hit ratio", fmt::format("{:.1f}%", stats.hitRatio() * 100));
+    row("Saved", fmt::format("{:.1f} MiB", mib(stats.hitBytes)));
+    row("Fetched", fmt::format("{:.1f} MiB", mib(stats.missBytes)));
+    row("Opens", fmt::format("{} ({} found on disk)", stats.opens, stats.reused));
+    row("Stored", fmt::format("{:.1f} / {} MiB", mib(stats.storedBytes), config->Data.Cache.DiskSize));
+    ImGui::EndTable();
+  }
+}
+
 void Debug::drawBindings() {
-  auto bindings = mpv->bindings;
+  auto& bindings = mpv->bindings;
   if (m_node != "Bindings") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
   if (!ImGui::CollapsingHeader(i18n_a("views.debug.bindings", bindings.size()).c_str())) return;
   m_node = "Bindings";
 
-  static char buf[256] = "";
-  ImGui::TextUnformatted("views.debug.commands.filter"_i18n);
-  ImGui::SameLine();
-  ImGui::PushItemWidth(-1);
-  ImGui::InputText("##Filter.bindings", buf, IM_ARRAYSIZE(buf));
-  ImGui::PopItemWidth();
+  if (bindingsVersion != mpv->bindingsVersion) {
+    std::vector<std::string> texts;
+    texts.reserve(bindings.size());
+    for (auto& binding : bindings) texts.push_back(binding.key + '\x1f' + binding.cmd);
+    bindingsSearch.reset(std::move(texts));
+    bindingsVersion = mpv->bindingsVersion;
+  }
+  bindingsSearch.draw("##Filter.bindings", "views.debug.commands.filter"_i18n);
+  auto& results = bindingsSearch.results();
 
   static ImGuiTableFlags flags = ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter |
                                  ImGuiTableFlags_BordersV | ImGuiTableFlags_NoBordersInBody | ImGuiTableFlags_ScrollY;
@@ -91,21 +304,27 @@ void Debug::drawBindings() {
     ImGui::TableSetupColumn("Command", ImGuiTableColumnFlags_WidthStretch);
     ImGui::TableSetupColumn("Comment", ImGuiTableColumnFlags_WidthStretch);
     ImGui::TableHeadersRow();
-    for (auto& binding : bindings) {
-      if (buf[0] != '\0' && !findCase(binding.key, buf) && !findCase(binding.cmd, buf)) continue;
-      ImGui::TableNextRow();
-      ImGui::TableNextColumn();
-      ImGui::Selectable(binding.section.c_str(), false, ImGuiSelectableFlags_SpanAllColumns);
-      ImGui::TableNextColumn();
-      ImGui::Text("%d", binding.priority);
-      ImGui::TableNextColumn();
-      ImGui::Text("%s", binding.weak ? "yes" : "no");
-      ImGui::TableNextColumn();
-      ImGui::Text("%s", binding.key.c_str());
-      ImGui::TableNextColumn();
-      ImGui::Text("%s", binding.cmd.c_str());
-      ImGui::TableNextColumn();
-      ImGui::Text("%s", binding.comment.c_str());
+    ImGuiListClipper clipper;
+    clipper.Begin((int)results.size());
+    while (clipper.Step()) {
+      for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+        auto& binding = bindings[results[row]];
+        ImGui::PushID(row);
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Selectable(binding.section.c_str(), false, ImGuiSelectableFlags_SpanAllColumns);
+        ImGui::TableNextColumn();
+        ImGui::Text("%d", binding.priority);
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", binding.weak ? "yes" : "no");
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", binding.key.c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", binding.cmd.c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", binding.comment.c_str());
+        ImGui::PopID();
+      }
     }
     ImGui::EndTable();
   }
@@ -165,6 +384,13 @@ void Debug::initData() {
   formatCommands(node, commands);
   mpv_free_node_contents(&node);
 
+  optionsSearch.reset(options);
+  propertiesSearch.reset(properties);
+  std::vector<std::string> names;
+  names.reserve(commands.size());
+  for (auto& [name, args] : commands) names.push_back(name);
+  commandsSearch.reset(std::move(names));
+
   console->initCommands(commands);
 }
 
@@ -173,30 +399,37 @@ void Debug::drawCommands() {
   if (!ImGui::CollapsingHeader(i18n_a("views.debug.commands", commands.size()).c_str())) return;
   m_node = "Commands";
 
-  static char buf[256] = "";
-  ImGui::TextUnformatted("views.debug.commands.filter"_i18n);
-  ImGui::SameLine();
-  ImGui::PushItemWidth(-1);
-  ImGui::InputText("##Filter.commands", buf, IM_ARRAYSIZE(buf));
-  ImGui::PopItemWidth();
+  commandsSearch.draw("##Filter.commands", "views.debug.commands.filter"_i18n);
+  auto& results = commandsSearch.results();
   if (ImGui::BeginListBox("command-list", ImVec2(-FLT_MIN, -FLT_MIN))) {
-    for (auto& [name, args] : commands) {
-      if (buf[0] != '\0' && !findCase(name, buf)) continue;
-      ImGui::PushID(name.c_str());
-      ImGui::Selectable("", false);
-      ImGui::SameLine();
-      ImGui::TextColored(ImGui::GetStyle().Colors[ImGuiCol_CheckMark], "%s", name.c_str());
-      if (!args.empty()) {
+    ImGuiListClipper clipper;
+    clipper.Begin((int)results.size());
+    while (clipper.Step()) {
+      for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+        auto& [name, args] = commands[results[row]];
+        ImGui::PushID(name.c_str());
+        ImGui::Selectable("", false);
         ImGui::SameLine();
-        ImGui::Text("%s", args.c_str());
+        ImGui::TextColored(ImGui::GetStyle().Colors[ImGuiCol_CheckMark], "%s", name.c_str());
+        if (!args.empty()) {
+          ImGui::SameLine();
+          ImGui::Text("%s", args.c_str());
+        }
+        ImGui::PopID();
       }
-      ImGui::PopID();
     }
     ImGui::EndListBox();
   }
 }
 
-void Debug::drawProperties(const char* title, std::vector<std::string>& props) {
+void Debug::drawWatch() {
+  if (m_node != "Watch") ImGui::SetNextItemOpen(false, ImGuiCond_Always);
+  if (!ImGui::CollapsingHeader(i18n_a("views.debug.watch", inspector->watches.size()).c_str())) return;
+  m_node = "Watch";
+  inspector->drawWatch();
+}
+
+void Debug::drawProperties(const char* title, std::vector<std::string>& props, Search& search) {
   if (m_node != title) ImGui::SetNextItemOpen(false, ImGuiCond_Always);
   if (!ImGui::CollapsingHeader(fmt::format("{} [{}]", title, props.size()).c_str())) {
     return;
@@ -207,7 +440,6 @@ void Debug::drawProperties(const char* title, std::vector<std::string>& props) {
              1 << MPV_FORMAT_INT64 | 1 << MPV_FORMAT_DOUBLE | 1 << MPV_FORMAT_NODE | 1 << MPV_FORMAT_NODE_ARRAY |
              1 << MPV_FORMAT_NODE_MAP | 1 << MPV_FORMAT_BYTE_ARRAY;
   static int format = mask;
-  static char buf[256] = "";
   ImGui::AlignTextToFramePadding();
   ImGui::TextUnformatted("views.debug.properties.format"_i18n);
   ImGui::SameLine();
@@ -230,95 +462,468 @@ void Debug::drawProperties(const char* title, std::vector<std::string>& props) {
   ImGui::SameLine();
   ImGui::CheckboxFlags("BYTE_ARRAY", &format, 1 << MPV_FORMAT_BYTE_ARRAY);
   ImGui::Unindent();
-  ImGui::TextUnformatted("views.debug.properties.filter"_i18n);
+  ImGui::TextUnformatted("views.debug.properties.rate"_i18n);
   ImGui::SameLine();
-  ImGui::PushItemWidth(-1);
-  ImGui::InputText("##Filter.properties", buf, IM_ARRAYSIZE(buf));
-  ImGui::PopItemWidth();
+  ImGui::SetNextItemWidth(scaled(8));
+  if (ImGui::SliderInt("##Rate.properties", &config->Data.Debug.PollRate, 1, 30, "%d Hz"))
+    inspector->setRate(config->Data.Debug.PollRate);
+  search.draw("##Filter.properties", "views.debug.properties.filter"_i18n);
+  m_polling = true;
+
+  // values come from the inspector snapshot, only the visible rows are polled
   auto posY = ImGui::GetCursorScreenPos().y;
+  visibleProps.clear();
   if (format > 0 && ImGui::BeginListBox(title, ImVec2(-FLT_MIN, -FLT_MIN))) {
-    for (auto& name : props) {
-      if (buf[0] != '\0' && name.find(buf) == std::string::npos) continue;
+    auto lock = inspector->lock();
+    for (int i : search.results()) {
+      auto& name = props[i];
       if (ImGui::GetCursorScreenPos().y > posY + ImGui::GetStyle().FramePadding.y && !ImGui::IsItemVisible()) {
         ImGui::BulletText("%s", name.c_str());
         continue;
       }
-      auto prop = mpv->property<mpv_node, MPV_FORMAT_NODE>(name.c_str());
-      if (format & 1 << prop.format) drawPropNode(name.c_str(), prop);
-      mpv_free_node_contents(&prop);
+      visibleProps.push_back(&name);
+      auto prop = inspector->find(name);
+      if (prop == nullptr) {
+        ImGui::BulletText("%s", name.c_str());
+        ImGui::SameLine(ImGui::GetContentRegionAvail().x * 0.5f);
+        ImGui::TextDisabled("%s", i18n("views.debug.properties.pending"));
+        continue;
+      }
+      if (format & 1 << prop->format) drawPropNode(name.c_str(), const_cast<mpv_node&>(*prop));
     }
+    lock.unlock();
     ImGui::EndListBox();
   }
+  inspector->request(visibleProps);
 }
 
 void Debug::drawPropNode(const char* name, mpv_node& node, int depth) {
-  constexpr static auto drawSimple = [&](const char* title, mpv_node prop) {
-    std::string value;
-    auto style = ImGuiStyle();
-    ImVec4 color = style.Colors[ImGuiCol_CheckMark];
-    switch (prop.format) {
-      case MPV_FORMAT_OSD_STRING:
-      case MPV_FORMAT_STRING:
-        value = prop.u.string;
-        break;
-      case MPV_FORMAT_FLAG:
-        value = prop.u.flag ? "yes" : "no";
-        break;
-      case MPV_FORMAT_INT64:
-        value = fmt::format("{}", prop.u.int64);
-        break;
-      case MPV_FORMAT_DOUBLE:
-        value = fmt::format("{}", prop.u.double_);
-        break;
-      case MPV_FORMAT_BYTE_ARRAY:
-        value = fmt::format("byte array [{}]", prop.u.ba->size);
-        break;
-      case MPV_FORMAT_NONE:
-      default:
-        value = i18n("views.debug.properties.invalid");
-        color = style.Colors[ImGuiCol_TextDisabled];
-        break;
-    }
-    ImGui::PushID(&prop);
-    ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, ImGui::GetStyle().ItemSpacing.y));
-    ImGui::Selectable("", false);
-    if (ImGui::BeginPopupContextItem(fmt::format("##menu_{}", title).c_str())) {
-      if (ImGui::MenuItem("views.debug.properties.menu.copy"_i18n))
-        ImGui::SetClipboardText(fmt::format("{}={}", title, value).c_str());
-      if (ImGui::MenuItem("views.debug.properties.menu.copy_name"_i18n)) ImGui::SetClipboardText(title);
-      if (ImGui::MenuItem("views.debug.properties.menu.copy_value"_i18n)) ImGui::SetClipboardText(value.c_str());
-      ImGui::EndPopup();
-    }
-    ImGui::SameLine();
-    ImGui::BulletText("%s", title);
-    ImGui::SameLine(ImGui::GetContentRegionAvail().x * 0.5f);
-    ImGui::TextColored(color, "%s", value.c_str());
-    if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) ImGui::SetTooltip("%s", value.c_str());
-    ImGui::PopStyleVar();
-    ImGui::PopID();
-  };
-
   switch (node.format) {
     case MPV_FORMAT_NODE_ARRAY:
-      if (ImGui::TreeNode(fmt::format("{} [{}]", name, node.u.list->num).c_str())) {
-        for (int i = 0; i < node.u.list->num; i++)
-          drawPropNode(fmt::format("#{}", i).c_str(), node.u.list->values[i], depth + 1);
+      if (ImGui::TreeNode(name, "%s [%d]", name, node.u.list->num)) {
+        char index[16];
+        for (int i = 0; i < node.u.list->num; i++) {
+          std::snprintf(index, sizeof(index), "#%d", i);
+          drawPropNode(index, node.u.list->values[i], depth + 1);
+        }
         ImGui::TreePop();
       }
       break;
     case MPV_FORMAT_NODE_MAP:
       if (depth > 0) ImGui::SetNextItemOpen(true, ImGuiCond_Once);
-      if (ImGui::TreeNode(fmt::format("{} ({})", name, node.u.list->num).c_str())) {
-        for (int i = 0; i < node.u.list->num; i++) drawPropNode(node.u.list->keys[i], node.u.list->values[i]);
+      if (ImGui::TreeNode(name, "%s (%d)", name, node.u.list->num)) {
+        for (int i = 0; i < node.u.list->num; i++)
+          drawPropNode(node.u.list->keys[i], node.u.list->values[i], depth + 1);
         ImGui::TreePop();
       }
       break;
     default:
-      drawSimple(name, node);
+      drawPropValue(name, node, depth);
       break;
   }
 }
 
+void Debug::drawPropValue(const char* name, mpv_node& node, int depth) {
+  char buf[64];
+  const char* value = buf;
+  auto style = ImGuiStyle();
+  ImVec4 color = style.Colors[ImGuiCol_CheckMark];
+  switch (node.format) {
+    case MPV_FORMAT_OSD_STRING:
+    case MPV_FORMAT_STRING:
+      value = node.u.string;
+      break;
+    case MPV_FORMAT_FLAG:
+      value = node.u.flag ? "yes" : "no";
+      break;
+    case MPV_FORMAT_INT64:
+      *fmt::format_to_n(buf, sizeof(buf) - 1, "{}", node.u.int64).out = '\0';
+      break;
+    case MPV_FORMAT_DOUBLE:
+      *fmt::format_to_n(buf, sizeof(buf) - 1, "{}", node.u.double_).out = '\0';
+      break;
+    case MPV_FORMAT_BYTE_ARRAY:
+      *fmt::format_to_n(buf, sizeof(buf) - 1, "byte array [{}]", node.u.ba->size).out = '\0';
+      break;
+    case MPV_FORMAT_NONE:
+    default:
+      value = i18n("views.debug.properties.invalid");
+      color = style.Colors[ImGuiCol_TextDisabled];
+      break;
+  }
+  ImGui::PushID(name);
+  ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, ImGui::GetStyle().ItemSpacing.y));
+  ImGui::Selectable("", false);
+  if (ImGui::BeginPopupContextItem("##menu")) {
+    if (ImGui::MenuItem("views.debug.properties.menu.copy"_i18n))
+      ImGui::SetClipboardText(fmt::format("{}={}", name, value).c_str());
+    if (ImGui::MenuItem("views.debug.properties.menu.copy_name"_i18n)) ImGui::SetClipboardText(name);
+    if (ImGui::MenuItem("views.debug.properties.menu.copy_value"_i18n)) ImGui::SetClipboardText(value);
+    if (depth == 0) {
+      ImGui::Separator();
+      if (!inspector->pinned(name)) {
+        if (ImGui::MenuItem("views.debug.properties.menu.pin"_i18n)) inspector->pin(name);
+      } else if (ImGui::MenuItem("views.debug.properties.menu.unpin"_i18n)) {
+        inspector->unpin(name);
+      }
+    }
+    ImGui::EndPopup();
+  }
+  ImGui::SameLine();
+  ImGui::BulletText("%s", name);
+  ImGui::SameLine(ImGui::GetContentRegionAvail().x * 0.5f);
+  ImGui::TextColored(color, "%s", value);
+  if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal)) ImGui::SetTooltip("%s", value);
+  ImGui::PopStyleVar();
+  ImGui::PopID();
+}
+
+Debug::Inspector::Inspector(Mpv* mpv) : mpv(mpv) { worker = std::thread(&Inspector::poll, this); }
+
+Debug::Inspector::~Inspector() {
+  {
+    std::lock_guard<std::mutex> l(mutex);
+    quit = true;
+  }
+  cond.notify_one();
+  worker.join();
+  for (auto& [name, node] : snapshot) mpv_free_node_contents(&node);
+  for (auto& series : watches) mpv->unobserveProperty(series.id);
+}
+
+void Debug::Inspector::setActive(bool value) {
+  if (active == value) return;
+  {
+    std::lock_guard<std::mutex> l(mutex);
+    active = value;
+  }
+  cond.notify_one();
+}
+
+void Debug::Inspector::setRate(int hz) {
+  {
+    std::lock_guard<std::mutex> l(mutex);
+    rate = std::clamp(hz, 1, 30);
+  }
+  cond.notify_one();
+}
+
+void Debug::Inspector::request(const std::vector<const std::string*>& names) {
+  std::lock_guard<std::mutex> l(mutex);
+  if (std::equal(names.begin(), names.end(), wanted.begin(), wanted.end(),
+                 [](const std::string* a, const std::string& b) { return *a == b; }))
+    return;
+  wanted.clear();
+  for (auto name : names) wanted.push_back(*name);
+  dirty = true;
+  cond.notify_one();
+}
+
+const mpv_node* Debug::Inspector::find(const std::string& name) const {
+  auto it = snapshot.find(name);
+  return it != snapshot.end() ? &it->second : nullptr;
+}
+
+void Debug::Inspector::poll() {
+  TRACE_THREAD("Debug inspector");
+  std::unique_lock<std::mutex> l(mutex);
+  while (!quit) {
+    if (!active || wanted.empty()) {
+      cond.wait(l, [this] { return quit || (active && !wanted.empty()); });
+      continue;
+    }
+    auto names = wanted;
+    auto interval = std::chrono::milliseconds(1000 / rate);
+    dirty = false;
+    l.unlock();
+
+    std::map<std::string, mpv_node> fresh;
+    {
+      TRACE_ZONE("Inspector::poll");  // the fetches only, not the wait below
+      for (auto& name : names) fresh.emplace(name, mpv->property<mpv_node, MPV_FORMAT_NODE>(name.c_str()));
+    }
+
+    l.lock();
+    std::swap(snapshot, fresh);
+    l.unlock();
+    for (auto& [name, node] : fresh) mpv_free_node_contents(&node);
+    l.lock();
+
+    cond.wait_for(l, interval, [this] { return quit || dirty || !active; });
+  }
+}
+
+bool Debug::Inspector::pinned(const std::string& name) const {
+  return std::any_of(watches.begin(), watches.end(), [&](const Series& s) { return s.name == name; });
+}
+
+void Debug::Inspector::pin(const std::string& name) {
+  if (name.empty() || pinned(name)) return;
+  auto& series = watches.emplace_back();
+  series.name = name;
+  series.id = mpv->observeProperty<mpv_node, MPV_FORMAT_NODE>(name, [s = &series](mpv_node node) { s->add(node); });
+}
+
+void Debug::Inspector::unpin(const std::string& name) {
+  auto it = std::find_if(watches.begin(), watches.end(), [&](const Series& s) { return s.name == name; });
+  if (it == watches.end()) return;
+  mpv->unobserveProperty(it->id);
+  watches.erase(it);
+}
+
+void Debug::Inspector::drawWatch() {
+  static char buf[256] = "";
+  ImGui::SetNextItemWidth(-scaled(5));
+  bool add = ImGui::InputTextWithHint("##Watch.add", "views.debug.watch.hint"_i18n, buf, IM_ARRAYSIZE(buf),
+                                      ImGuiInputTextFlags_EnterReturnsTrue);
+  ImGui::SameLine();
+  if (ImGui::Button("views.debug.watch.add"_i18n, ImVec2(-FLT_MIN, 0)) || add) {
+    pin(trim(buf));
+    buf[0] = '\0';
+  }
+
+  auto style = ImGuiStyle();
+  for (auto it = watches.begin(); it != watches.end();) {
+    auto& series = *it;
+    ImGui::PushID(series.name.c_str());
+    bool remove = ImGui::SmallButton("x");
+    ImGui::SameLine();
+    ImGui::TextUnformatted(series.name.c_str());
+    ImGui::SameLine(ImGui::GetContentRegionAvail().x * 0.5f);
+    ImGui::TextColored(style.Colors[ImGuiCol_CheckMark], "%s", series.last.c_str());
+    if (series.samples.count > 1) {
+      ImGui::PlotLines("##plot", series.samples.values.data(), series.samples.count, series.samples.start(), nullptr,
+                       series.min, series.max, ImVec2(-FLT_MIN, scaled(2.5f)));
+      ImGui::TextDisabled("min %.4g  max %.4g  changes %d", series.min, series.max, series.changes);
+    }
+    ImGui::PopID();
+    if (remove) {
+      mpv->unobserveProperty(series.id);
+      it = watches.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void Debug::Inspector::Series::add(mpv_node& node) {
+  float value = 0;
+  bool numeric = true;
+  switch (node.format) {
+    case MPV_FORMAT_FLAG:
+      value = node.u.flag;
+      last = node.u.flag ? "yes" : "no";
+      break;
+    case MPV_FORMAT_INT64:
+      value = (float)node.u.int64;
+      last = fmt::format("{}", node.u.int64);
+      break;
+    case MPV_FORMAT_DOUBLE:
+      value = (float)node.u.double_;
+      last = fmt::format("{:.4f}", node.u.double_);
+      break;
+    case MPV_FORMAT_STRING:
+      last = node.u.string;
+      numeric = false;
+      break;
+    case MPV_FORMAT_NODE_ARRAY:
+    case MPV_FORMAT_NODE_MAP:
+      value = (float)node.u.list->num;
+      last = fmt::format("[{}]", node.u.list->num);
+      break;
+    default:
+      last = i18n("views.debug.properties.invalid");
+      numeric = false;
+      break;
+  }
+  changes++;
+  if (!numeric) return;
+
+  samples.push(value);
+  samples.range(min, max);
+}
+
+void Debug::Search::reset(std::vector<std::string> texts) {
+  for (auto& text : texts) text = tolower(std::move(text));
+  index = std::move(texts);
+  stale = true;
+  update();
+}
+
+void Debug::Search::draw(const char* id, const char* label) {
+  auto& style = ImGui::GetStyle();
+  const char* fuzzyLabel = "views.debug.search.fuzzy"_i18n;
+  float fuzzyWidth = ImGui::GetFrameHeight() + style.ItemInnerSpacing.x + ImGui::CalcTextSize(fuzzyLabel).x;
+  ImGui::AlignTextToFramePadding();
+  ImGui::TextUnformatted(label);
+  ImGui::SameLine();
+  ImGui::PushID(id);
+  ImGui::PushItemWidth(-(fuzzyWidth + style.ItemSpacing.x));
+  ImGui::InputText(id, buf, IM_ARRAYSIZE(buf));
+  ImGui::PopItemWidth();
+  ImGui::SameLine();
+  ImGui::Checkbox(fuzzyLabel, &fuzzy);
+  ImGui::PopID();
+  update();
+}
+
+void Debug::Search::update() {
+  std::string q = tolower(buf);
+  if (!stale && q == query && fuzzy == ranked) return;
+
+  // a longer query can only match a subset of what the shorter one matched
+  bool narrow = !stale && fuzzy == ranked && q.starts_with(query);
+  query = std::move(q);
+  ranked = fuzzy;
+  stale = false;
+  if (!narrow) {
+    matches.resize(index.size());
+    for (int i = 0; i < (int)index.size(); i++) matches[i] = i;
+  }
+  if (query.empty()) return;
+
+  scored.clear();
+  for (int i : matches) {
+    int s = score(index[i]);
+    if (s >= 0) scored.emplace_back(s, i);
+  }
+  if (fuzzy) std::stable_sort(scored.begin(), scored.end(), [](auto& a, auto& b) { return a.first > b.first; });
+  matches.clear();
+  for (auto& [s, i] : scored) matches.push_back(i);
+}
+
+// -1: no match. Substring matches always rank above subsequence matches, earlier and tighter is better.
+int Debug::Search::score(const std::string& text) const {
+  auto pos = text.find(query);
+  if (pos != std::string::npos) return 2000 - (int)std::min<size_t>(pos, 999);
+  if (!fuzzy) return -1;
+
+  int s = 1000;
+  size_t last = std::string::npos;
+  for (size_t i = 0, j = 0; j < query.size(); i++) {
+    if (i == text.size()) return -1;
+    if (text[i] != query[j]) continue;
+    if (last != std::string::npos) s -= (int)(i - last - 1);
+    last = i;
+    j++;
+  }
+  return std::max(s, 0);
+}
+
+void Debug::Hud::setVisible(bool value) {
+  if (visible == value) return;
+  visible = value;
+  for (auto id : observers) mpv->unobserveProperty(id);
+  observers.clear();
+  if (!visible) return;
+
+  for (auto& ring : timings) ring.clear();
+  for (auto& ring : stats) ring.clear();
+  std::fill(std::begin(current), std::end(current), 0);
+  videoTime = -1;
+  lastSample = 0;
+
+  auto observeInt = [&](const char* name, Stat_ stat) {
+    observers.push_back(mpv->observeProperty<int64_t, MPV_FORMAT_INT64>(
+        name, [this, stat](int64_t value) { current[stat] = (double)value; }));
+  };
+  auto observeDouble = [&](const char* name, Stat_ stat) {
+    observers.push_back(
+        mpv->observeProperty<double, MPV_FORMAT_DOUBLE>(name, [this, stat](double value) { current[stat] = value; }));
+  };
+  observeInt("frame-drop-count", Stat_FrameDrops);
+  observeInt("decoder-frame-drop-count", Stat_DecoderDrops);
+  observeInt("vo-delayed-frame-count", Stat_Delayed);
+  observeDouble("avsync", Stat_AvSync);
+  observeDouble("estimated-vf-fps", Stat_VfFps);
+  observeDouble("display-fps", Stat_DisplayFps);
+  observeInt("cache-speed", Stat_CacheSpeed);
+  observers.push_back(
+      mpv->observeProperty<char*, MPV_FORMAT_STRING>("hwdec-current", [this](char* value) { hwdec = value; }));
+}
+
+void Debug::Hud::draw() {
+  float ms = videoTime.exchange(-1);
+  if (ms >= 0) timings[Timing_Video].push(ms);
+
+  // mpv stats are sampled at 10 Hz from the latest observed values
+  double now = ImGui::GetTime();
+  if (now - lastSample >= 0.1) {
+    for (int i = 0; i < Stat_COUNT; i++) stats[i].push((float)current[i]);
+    lastSample = now;
+  }
+
+  ImGuiViewport* vp = ImGui::GetMainViewport();
+  ImGui::SetNextWindowPos(vp->WorkPos + ImVec2(scaled(1), scaled(1)), ImGuiCond_Always);
+  ImGui::SetNextWindowBgAlpha(0.6f);
+  ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoNav |
+                           ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoSavedSettings |
+                           ImGuiWindowFlags_AlwaysAutoResize;
+  if (!ImGui::Begin("##hud", nullptr, flags)) {
+    ImGui::End();
+    return;
+  }
+
+  char overlay[64];
+  ImVec2 size(scaled(16), scaled(2));
+  auto plot = [&](const Ring<300>& ring, float min, float max) {
+    ImGui::PushID(&ring);
+    ImGui::PlotLines("##plot", ring.values.data(), ring.count, ring.start(), overlay, min, max, size);
+    ImGui::PopID();
+  };
+  auto plotTiming = [&](const char* label, Timing_ timing) {
+    auto& ring = timings[timing];
+    float min, max;
+    ring.range(min, max);
+    std::snprintf(overlay, sizeof(overlay), "%s %.2f ms (max %.2f)", label, ring.last(), max);
+    plot(ring, 0, std::max(max, 1.0f));
+  };
+  auto plotCounter = [&](const char* label, Stat_ stat) {
+    auto& ring = stats[stat];
+    std::snprintf(overlay, sizeof(overlay), "%s %.0f", label, ring.last());
+    // counters are cumulative, plot the increment between consecutive samples
+    auto delta = [](void* data, int i) {
+      auto r = static_cast<const Ring<300>*>(data);
+      if (i == 0) return 0.0f;
+      int n = (int)r->values.size(), cur = (r->start() + i) % n;
+      return r->values[cur] - r->values[(cur + n - 1) % n];
+    };
+    ImGui::PushID(&ring);
+    ImGui::PlotHistogram("##plot", delta, (void*)&ring, ring.count, 0, overlay, 0, FLT_MAX, size);
+    ImGui::PopID();
+  };
+  auto plotStat = [&](const char* label, Stat_ stat, const char* format) {
+    auto& ring = stats[stat];
+    float min, max;
+    ring.range(min, max);
+    std::snprintf(overlay, sizeof(overlay), format, label, ring.last());
+    plot(ring, min, max > min ? max : min + 1);
+  };
+
+  ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0, 0, 0, 0));
+  ImGui::TextUnformatted("views.debug.hud.player"_i18n);
+  plotTiming(i18n("views.debug.hud.frame"), Timing_Frame);
+  plotTiming(i18n("views.debug.hud.video"), Timing_Video);
+  plotTiming(i18n("views.debug.hud.swap"), Timing_Swap);
+  plotTiming(i18n("views.debug.hud.events"), Timing_Events);
+
+  ImGui::Separator();
+  ImGui::Text("%s %s", i18n("views.debug.hud.mpv"), hwdec.empty() ? "no" : hwdec.c_str());
+  plotCounter(i18n("views.debug.hud.drops"), Stat_FrameDrops);
+  plotCounter(i18n("views.debug.hud.decoder_drops"), Stat_DecoderDrops);
+  plotCounter(i18n("views.debug.hud.delayed"), Stat_Delayed);
+  plotStat(i18n("views.debug.hud.avsync"), Stat_AvSync, "%s %+.3f s");
+  plotStat(i18n("views.debug.hud.vf_fps"), Stat_VfFps, "%s %.2f");
+  plotStat(i18n("views.debug.hud.display_fps"), Stat_DisplayFps, "%s %.2f");
+  std::snprintf(overlay, sizeof(overlay), "%s %.1f KiB/s", i18n("views.debug.hud.cache_speed"),
+                stats[Stat_CacheSpeed].last() / 1024);
+  float min, max;
+  stats[Stat_CacheSpeed].range(min, max);
+  plot(stats[Stat_CacheSpeed], 0, std::max(max, 1.0f));
+  ImGui::PopStyleColor();
+  ImGui::End();
+}
+
 Debug::Console::Console(Mpv* mpv) : mpv(mpv) {
   ClearLog();
   memset(InputBuf, 0, sizeof(InputBuf));
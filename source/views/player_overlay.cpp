@@ -5,6 +5,7 @@
 #include "helpers/utils.h"
 #include "helpers/imgui.h"
 #include "helpers/nfd.h"
+#include "follow_stream.h"
 #include "views/player_overlay.h"
 
 namespace ImPlay::Views {
@@ -149,12 +150,101 @@ void PlayerOverlay::drawIdleScreen() {
     ImVec2 hs = ImGui::CalcTextSize(hint);
     ImGui::SetCursorPos(ImVec2((wSize.x - hs.x) / 2, btnY + 85));
     ImGui::TextColored(ImVec4(0.4f, 0.35f, 0.5f, 0.6f), "%s", hint);
+
+    drawLibrarySearch(btnY + 125);
   }
   ImGui::End();
   ImGui::PopStyleVar();
   ImGui::PopStyleColor();
 }
 
+void PlayerOverlay::drawLibrarySearch(float y) {
+  if (m_library == nullptr || m_library->size() == 0) return;
+
+  auto wSize = ImGui::GetWindowSize();
+  float boxW = std::min(480.0f, wSize.x - 40);
+  float boxX = (wSize.x - boxW) / 2;
+
+  ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 14);
+  ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(14, 8));
+  ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0.10f, 0.06f, 0.18f, 0.9f));
+  ImGui::SetCursorPos(ImVec2(boxX, y));
+  ImGui::SetNextItemWidth(boxW);
+  auto hint = fmt::format(ICON_FA_SEARCH "  Search library ({} files)", m_library->size());
+  ImGui::InputTextWithHint("##LibrarySearch", hint.c_str(), m_libraryQuery, IM_ARRAYSIZE(m_libraryQuery));
+  ImGui::PopStyleColor();
+  ImGui::PopStyleVar(2);
+
+  if (m_lastLibraryQuery != m_libraryQuery) {
+    m_lastLibraryQuery = m_libraryQuery;
+    m_libraryResults = m_library->search(m_lastLibraryQuery, 8);
+  }
+
+  ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0.25f, 0.18f, 0.40f, 1.0f));
+  int index = 0;
+  for (auto &item : m_libraryResults) {
+    auto file = std::filesystem::path(reinterpret_cast<const char8_t *>(item.path.c_str())).filename().u8string();
+    auto name = std::string(file.begin(), file.end());
+    ImGui::SetCursorPosX(boxX);
+    ImGui::PushID(index++);
+    if (ImGui::Selectable("##LibraryItem", false, 0, ImVec2(boxW, 0))) {
+      mpv->commandv("loadfile", item.path.c_str(), nullptr);
+      m_libraryQuery[0] = '\0';
+    }
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("%s", item.path.c_str());
+    ImGui::SameLine(boxX + 8);
+    ImGui::TextColored(item.type == MediaType::Audio ? m_accentPurple : ImVec4(1, 1, 1, 0.9f), "%s %s",
+                       item.type == MediaType::Audio ? ICON_FA_MUSIC : ICON_FA_FILM, name.c_str());
+    if (item.duration > 0) {
+      auto length = fmt::format("{}:{:02}", (int)item.duration / 60, (int)item.duration % 60);
+      ImGui::SameLine(boxX + boxW - ImGui::CalcTextSize(length.c_str()).x - 8);
+      ImGui::TextColored(ImVec4(0.6f, 0.5f, 0.75f, 0.9f), "%s", length.c_str());
+    }
+    ImGui::PopID();
+  }
+  ImGui::PopStyleColor();
+}
+
+void PlayerOverlay::drawScanProgress() {
+  if (m_scanner == nullptr || !m_scanner->running()) return;
+
+  auto vp = ImGui::GetMainViewport();
+  float toastW = 420;
+  ImGui::SetNextWindowPos(ImVec2(vp->WorkPos.x + (vp->WorkSize.x - toastW) / 2, vp->WorkPos.y + 70));
+  ImGui::SetNextWindowSize(ImVec2(toastW, 0));
+
+  ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0.06f, 0.04f, 0.12f, 0.92f));
+  ImGui::PushStyleColor(ImGuiCol_Border, ImVec4(0.5f, 0.3f, 0.8f, 0.3f));
+  ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 12);
+  ImGui::PushStyleVar(ImGuiStyleVar_WindowBorderSize, 1);
+  ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(16, 12));
+
+  ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove |
+                           ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing;
+  if (ImGui::Begin("##ScanProgress", nullptr, flags)) {
+    ImGui::TextColored(m_accentPurple, ICON_FA_FOLDER_OPEN);
+    ImGui::SameLine(0, 10);
+    ImGui::TextColored(ImVec4(1, 1, 1, 0.95f), "Scanning: %zu files in %zu folders", m_scanner->filesFound(),
+                       m_scanner->foldersScanned());
+
+    ImGui::SameLine(toastW - 90);
+    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.15f, 0.10f, 0.25f, 0.9f));
+    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.25f, 0.18f, 0.40f, 1.0f));
+    ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 8);
+    if (ImGui::Button("Cancel##scan", ImVec2(60, 0))) m_scanner->cancel();
+    ImGui::PopStyleVar();
+    ImGui::PopStyleColor(2);
+
+    auto folder = m_scanner->currentFolder();
+    ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.6f, 0.5f, 0.75f, 0.9f));
+    ImGui::TextEllipsis(folder.c_str());
+    ImGui::PopStyleColor();
+  }
+  ImGui::End();
+  ImGui::PopStyleVar(3);
+  ImGui::PopStyleColor(2);
+}
+
 void PlayerOverlay::drawTopBar() {
   if (!mpv) return;  // Safety check
   
@@ -190,7 +280,7 @@ void PlayerOverlay::drawTopBar() {
 
     ImGui::SetCursorPos(ImVec2(18, 15));
     ImGui::SetWindowFontScale(1.4f);
-    if (ImGui::Button(ICON_FA_CHEVRON_LEFT "##back", ImVec2(50, 50))) mpv->command("quit");
+    if (ImGui::Button(ICON_FA_CHEVRON_LEFT "##back", ImVec2(50, 50))) mpv->command("script-message-to implay close");
     ImGui::SetWindowFontScale(1.0f);
 
     ImGui::PopStyleVar();
@@ -285,6 +375,24 @@ void PlayerOverlay::drawProgressBar() {
     3.0f
   );
   
+  // Written part of a file that is still being downloaded, at the current bitrate: stream-pos
+  // runs ahead of playback by the demuxer cache, and the size mpv sees is only what is written
+  if (FollowStream::active() && duration > 0) {
+    int64_t written = FollowStream::available(mpv->property("path"));
+    double bitrate = mpv->property<double, MPV_FORMAT_DOUBLE>("video-bitrate") +
+                     mpv->property<double, MPV_FORMAT_DOUBLE>("audio-bitrate");
+    if (written > 0 && bitrate > 0) {
+      double seconds = written / (bitrate / 8);
+      float availW = barWidth * std::clamp((float)(seconds / duration), progress, 1.0f);
+      dl->AddRectFilled(
+        ImVec2(barX, barY),
+        ImVec2(barX + availW, barY + barHeight),
+        IM_COL32(170, 170, 180, (int)(140 * m_controlsAlpha)),
+        3.0f
+      );
+    }
+  }
+
   // Progress fill - purple gradient
   float progressW = barWidth * progress;
   if (progressW > 0) {
@@ -618,11 +726,25 @@ void PlayerOverlay::drawSubtitleMenu() {
         
         for (int i = 0; i < (int)provider.subtitles.size(); i++) {
           auto& sub = provider.subtitles[i];
+          auto state = m_subtitleCache ? m_subtitleCache->state(sub.url) : SubtitleCache::State::Unknown;
           ImGui::SetWindowFontScale(1.05f);
           if (ImGui::Selectable((sub.name + "##extsub" + std::to_string(i)).c_str(), false, 0, ImVec2(0, 32))) {
-            mpv->commandv("sub-add", sub.url.c_str(), "select", nullptr);
+            if (m_subtitleCache)
+              m_subtitleCache->select(sub.url, sub.name);
+            else
+              mpv->commandv("sub-add", sub.url.c_str(), "select", nullptr);
           }
           ImGui::SetWindowFontScale(1.0f);
+
+          // download state, right aligned on the row
+          const char* marker = nullptr;
+          if (state == SubtitleCache::State::Ready) marker = ICON_FA_CHECK;
+          else if (state == SubtitleCache::State::Fetching) marker = ICON_FA_SPINNER;
+          if (marker) {
+            ImGui::SameLine(ImGui::GetContentRegionMax().x - ImGui::CalcTextSize(marker).x - 8);
+            ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 8);
+            ImGui::TextColored(ImVec4(0.6f, 0.5f, 0.75f, 0.7f), "%s", marker);
+          }
         }
         
         if (provider.subtitles.empty()) {
@@ -740,7 +862,7 @@ void PlayerOverlay::drawSettingsMenu() {
   if (!mpv) return;  // Safety check
   
   auto vp = ImGui::GetMainViewport();
-  float menuW = 360, menuH = 520;
+  float menuW = 360, menuH = 544;
   ImVec2 menuPos(vp->WorkPos.x + vp->WorkSize.x - menuW - 25, vp->WorkPos.y + vp->WorkSize.y - menuH - 145);
   
   ImGui::SetNextWindowPos(menuPos);
@@ -848,10 +970,25 @@ void PlayerOverlay::drawSettingsMenu() {
     ImGui::SetWindowFontScale(1.05f);
     ImGui::TextColored(ImVec4(0.8f, 0.75f, 0.9f, 0.9f), "Cache");
     ImGui::SameLine(labelW);
-    static int cacheSize = 150;
-    ImGui::SetNextItemWidth(controlW);
-    if (ImGui::SliderInt("##cache", &cacheSize, 16, 512, "%d MB"))
-      mpv->commandv("set", "demuxer-max-bytes", fmt::format("{}MiB", cacheSize).c_str(), nullptr);
+    auto &cache = config->Data.Cache;
+    if (ImGui::Checkbox("Auto##cacheAuto", &cache.Adaptive) && m_cache) m_cache->configure();
+    ImGui::SameLine();
+    // adaptive: the slider is the memory ceiling, applied once released instead of on every tick
+    ImGui::SetNextItemWidth(controlW - (ImGui::GetCursorPosX() - labelW));
+    int &cacheSize = cache.Adaptive ? cache.MaxMemory : cache.Size;
+    ImGui::SliderInt("##cache", &cacheSize, 16, 1024, cache.Adaptive ? "max %d MB" : "%d MB");
+    if (ImGui::IsItemDeactivatedAfterEdit()) {
+      if (m_cache)
+        m_cache->configure();
+      else
+        mpv->commandv("set", "demuxer-max-bytes", fmt::format("{}MiB", cacheSize).c_str(), nullptr);
+    }
+    if (m_cache && cache.Adaptive && m_cache->status().policy != CacheController::Policy::None) {
+      auto &status = m_cache->status();
+      ImGui::SetCursorPosX(labelW);
+      ImGui::TextColored(ImVec4(0.6f, 0.5f, 0.75f, 0.8f), "%s  %d MB  %.0fs ahead",
+                         CacheController::policyName(status.policy), (int)(status.maxBytes >> 20), status.readahead);
+    }
     ImGui::SetWindowFontScale(1.0f);
 
     ImGui::Spacing();
@@ -924,8 +1061,12 @@ void PlayerOverlay::openSubtitleFile() {
       {"Subtitle Files", "srt,ass,idx,sub,sup,ttxt,txt,ssa,smi,mks,vtt"},
   };
   mpv->command("set pause yes");
-  if (auto res = NFD::openFile(filters))
-    mpv->commandv("sub-add", res->string().c_str(), "select", nullptr);
+  if (auto res = NFD::openFile(filters)) {
+    if (m_subtitleCache)
+      m_subtitleCache->addFile(*res, "select");
+    else
+      mpv->commandv("sub-add", res->string().c_str(), "select", nullptr);
+  }
   mpv->command("set pause no");
 }
 
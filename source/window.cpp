@@ -14,33 +14,26 @@
 #ifdef _WIN32
 #include <windowsx.h>
 #endif
+#include "helpers/startup.h"
+#include "helpers/task_graph.h"
+#include "helpers/trace.h"
 #include "theme.h"
 #include "window.h"
 
 namespace ImPlay {
-Window::Window(Config* config) : Player(config) {
-  initGLFW();
-  window = glfwCreateWindow(1280, 720, PLAYER_NAME, nullptr, nullptr);
-  if (window == nullptr) throw std::runtime_error("Failed to create window!");
-#ifdef _WIN32
-  hwnd = glfwGetWin32Window(window);
-  if (SUCCEEDED(OleInitialize(nullptr))) oleOk = true;
-#endif
-
-  initGui();
-  installCallbacks(window);
-  ImGui_ImplGlfw_InitForOpenGL(window, true);
-}
+Window::Window(Config* config) : Player(config) {}
 
 Window::~Window() {
-  ImGui_ImplGlfw_Shutdown();
-  exitGui();
+  if (guiReady) {
+    ImGui_ImplGlfw_Shutdown();
+    exitGui();
+  }
 #ifdef _WIN32
   if (taskbarList != nullptr) taskbarList->Release();
   if (oleOk) OleUninitialize();
 #endif
 
-  glfwDestroyWindow(window);
+  if (window != nullptr) glfwDestroyWindow(window);
   glfwTerminate();
 }
 
@@ -71,15 +64,57 @@ void Window::initGLFW() {
   glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 }
 
-bool Window::init(OptionParser& parser) {
+// Startup runs as a small task graph: the mpv core, the embedded fonts and the language
+// catalogs are prepared on worker threads while GLFW and the window come up on this thread,
+// and are joined right before the first step that needs them.
+bool Window::init(OptionParser& parser, bool daemon) {
+  this->daemon = daemon;
+  parked = daemon && parser.paths.empty();
   mpv->wakeupCb() = [this](Mpv* ctx) { wakeup(); };
   mpv->updateCb() = [this](Mpv* ctx) { videoWaiter.notify(); };
-  if (!Player::init(parser.options)) return false;
+
+  bool mpvReady = false;  // before tasks, whose destructor joins the worker that writes it
+  TaskGraph tasks;
+  auto initCore = [&] { mpvReady = initMpv(parser.options); };
+  // embedding mpv into the native window needs the window handle before mpv_initialize
+#ifdef _WIN32
+  bool useWid = config->Data.Mpv.UseWid;
+#else
+  bool useWid = false;
+#endif
+  TaskGraph::Task core;
+  if (!useWid) core = tasks.add("mpv core", initCore);
+  auto fonts = tasks.add("fonts", [this] { prepareFonts(); });
+  auto lang = tasks.add("lang", [] { i18n(""); });
+
+  initGLFW();
+  Startup::mark("glfw-init");
+  window = glfwCreateWindow(1280, 720, PLAYER_NAME, nullptr, nullptr);
+  if (window == nullptr) throw std::runtime_error("Failed to create window!");
+  Startup::mark("create-window");
+#ifdef _WIN32
+  hwnd = glfwGetWin32Window(window);
+  if (SUCCEEDED(OleInitialize(nullptr))) oleOk = true;
+#endif
+  if (useWid) core = tasks.add("mpv core", initCore);
+
+  tasks.wait(lang);
+  tasks.wait(fonts);
+  Startup::mark("join-fonts");
+  initGui();
+  guiReady = true;
+  installCallbacks(window);
+  ImGui_ImplGlfw_InitForOpenGL(window, true);
+
+  tasks.wait(core);
+  Startup::mark("join-mpv-core");
+  if (!mpvReady || !Player::init()) return false;
 
   for (auto& path : parser.paths) {
     if (path == "-") mpv->property("input-terminal", "yes");
     mpv->commandv("loadfile", path.c_str(), "append-play", nullptr);
   }
+  Startup::mark("queue-files");
   
   // Pass external subtitle providers to the overlay
   if (!parser.subtitleProviders.empty()) {
@@ -115,9 +150,11 @@ bool Window::init(OptionParser& parser) {
 
 void Window::run() {
   bool shutdown = false;
-  
+  TRACE_THREAD("UI / mpv events");
+
   // Video renderer thread - renders mpv frames when ready
   std::thread videoRenderer([&]() {
+    TRACE_THREAD("Video render");
     while (!shutdown) {
       videoWaiter.wait();
       if (shutdown) break;
@@ -130,17 +167,33 @@ void Window::run() {
   });
 
   restoreState();
-  glfwShowWindow(window);
+  Startup::mark("restore-state");
+  if (parked) {
+    // a daemon without media stays hidden until a launch hands some over
+    Startup::mark("daemon-ready");
+    Startup::report();
+    park();
+  } else {
+    glfwShowWindow(window);
+    Startup::mark("show-window");
+  }
 
   while (!glfwWindowShouldClose(window)) {
     // Wait for events efficiently - VSync will throttle the loop
-    if (!glfwGetWindowAttrib(window, GLFW_VISIBLE) || glfwGetWindowAttrib(window, GLFW_ICONIFIED)) {
+    if (parked) {
+      double timeout = parkedTick();
+      if (timeout < 0)
+        glfwWaitEvents();
+      else if (timeout > 0)
+        glfwWaitEventsTimeout(timeout);
+    } else if (!glfwGetWindowAttrib(window, GLFW_VISIBLE) || glfwGetWindowAttrib(window, GLFW_ICONIFIED)) {
       glfwWaitEvents();
     } else {
       glfwPollEvents();
     }
 
-    mpv->waitEvent();
+    processEvents();
+    if (parked) continue;
     render();
     updateCursor();
   }
@@ -179,6 +232,7 @@ void Window::installCallbacks(GLFWwindow* target) {
   glfwSetWindowCloseCallback(target, [](GLFWwindow* window) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
     win->shutdown();
+    if (win->daemon) glfwSetWindowShouldClose(window, GLFW_FALSE);
   });
   glfwSetWindowSizeCallback(target, [](GLFWwindow* window, int w, int h) {
     auto win = static_cast<Window*>(glfwGetWindowUserPointer(window));
@@ -356,6 +410,16 @@ void Window::SetWindowFullscreen(bool fs) {
 
 void Window::SetWindowShouldClose(bool c) { glfwSetWindowShouldClose(window, c); }
 
+void Window::RaiseWindow() {
+  if (!glfwGetWindowAttrib(window, GLFW_VISIBLE))
+    glfwShowWindow(window);
+  else if (glfwGetWindowAttrib(window, GLFW_ICONIFIED))
+    glfwRestoreWindow(window);
+  glfwFocusWindow(window);
+}
+
+void Window::HideWindow() { glfwHideWindow(window); }
+
 GLFWmonitor* Window::getMonitor(GLFWwindow* target) {
   int n, wx, wy, ww, wh, mx, my;
   int bestoverlap = 0;
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <filesystem>
+#include <numeric>
 #include <string>
 #include <vector>
 #include <ranges>
@@ -22,12 +27,14 @@ namespace {
             string = replace(string, "\\", "/");
         #endif
 
-        // Replace all " with \"
-        string = replace(string, "\"", "\\\"");
-
         return string;
     }
 
+    std::string toStringLiteral(std::string string) {
+        // Replace all " with \"
+        return replace(string, "\"", "\\\"");
+    }
+
     std::vector<std::string> splitString(std::string string, const std::string &delimiter){
         std::vector<std::string> result;
 
@@ -43,6 +50,138 @@ namespace {
         return result;
     }
 
+    // Must match romfs::impl::hash in the library
+    std::uint64_t hash(std::string_view string, std::uint64_t seed) {
+        std::uint64_t result = 0xcbf29ce484222325ull ^ (seed * 0x9e3779b97f4a7c15ull);
+        for (char c : string) {
+            result ^= static_cast<std::uint8_t>(c);
+            result *= 0x100000001b3ull;
+        }
+        result ^= result >> 33;
+        result *= 0xff51afd7ed558ccdull;
+        result ^= result >> 33;
+        return result;
+    }
+
+    // Hash and displace: every bucket of keys gets the first seed that sends all of them to
+    // free slots. Returns the seed of each bucket and the slot of each key.
+    std::pair<std::vector<std::uint32_t>, std::vector<std::uint32_t>> perfectHash(const std::vector<std::string> &keys) {
+        const auto count = keys.size();
+        std::vector<std::uint32_t> seeds(std::max<std::size_t>(count, 1), 0);
+        std::vector<std::uint32_t> slots(count, 0);
+
+        std::vector<std::vector<std::size_t>> buckets(seeds.size());
+        for (std::size_t i = 0; i < count; i++)
+            buckets[hash(keys[i], 0) % seeds.size()].push_back(i);
+
+        std::vector<std::size_t> order(buckets.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::ranges::stable_sort(order, [&](auto a, auto b) { return buckets[a].size() > buckets[b].size(); });
+
+        std::vector<bool> taken(count, false);
+        for (auto bucket : order) {
+            if (buckets[bucket].empty()) break;
+
+            for (std::uint32_t seed = 1;; seed++) {
+                std::vector<std::uint32_t> candidate;
+                for (auto key : buckets[bucket]) {
+                    auto slot = static_cast<std::uint32_t>(hash(keys[key], seed) % count);
+                    if (taken[slot] || std::ranges::find(candidate, slot) != candidate.end()) break;
+                    candidate.push_back(slot);
+                }
+                if (candidate.size() != buckets[bucket].size()) continue;
+
+                seeds[bucket] = seed;
+                for (std::size_t i = 0; i < candidate.size(); i++) {
+                    taken[candidate[i]] = true;
+                    slots[buckets[bucket][i]] = candidate[i];
+                }
+                break;
+            }
+        }
+
+        return { seeds, slots };
+    }
+
+    // LZ4 block format, greedy parse over hash chains. Decoded by romfs::impl::decompress.
+    std::vector<std::uint8_t> compress(const std::vector<std::uint8_t> &input) {
+        constexpr std::size_t MinMatch = 4, LastLiterals = 5, MatchLimit = 12, MaxOffset = 0xffff, MaxChain = 64;
+        constexpr std::size_t HashBits = 16;
+
+        std::vector<std::uint8_t> output;
+        const auto size = input.size();
+        std::vector<std::int64_t> head(1 << HashBits, -1), chain(size, -1);
+
+        auto read32 = [&](std::size_t pos) {
+            return input[pos] | input[pos + 1] << 8 | input[pos + 2] << 16 | static_cast<std::uint32_t>(input[pos + 3]) << 24;
+        };
+        auto hash4 = [&](std::size_t pos) { return (read32(pos) * 2654435761u) >> (32 - HashBits); };
+        auto insert = [&](std::size_t pos) {
+            auto h = hash4(pos);
+            chain[pos] = head[h];
+            head[h] = static_cast<std::int64_t>(pos);
+        };
+        auto writeLength = [&](std::size_t length) {
+            for (; length >= 255; length -= 255) output.push_back(255);
+            output.push_back(static_cast<std::uint8_t>(length));
+        };
+        auto emit = [&](std::size_t literalStart, std::size_t literalLength, std::size_t offset, std::size_t matchLength) {
+            auto tokenIndex = output.size();
+            output.push_back(static_cast<std::uint8_t>(std::min<std::size_t>(literalLength, 15) << 4));
+            if (literalLength >= 15) writeLength(literalLength - 15);
+            output.insert(output.end(), input.begin() + literalStart, input.begin() + literalStart + literalLength);
+
+            if (matchLength == 0) return;
+            output.push_back(static_cast<std::uint8_t>(offset));
+            output.push_back(static_cast<std::uint8_t>(offset >> 8));
+            auto length = matchLength - MinMatch;
+            output[tokenIndex] |= static_cast<std::uint8_t>(std::min<std::size_t>(length, 15));
+            if (length >= 15) writeLength(length - 15);
+        };
+
+        std::size_t anchor = 0, pos = 0;
+        if (size > MatchLimit) {
+            const auto matchEnd = size - LastLiterals;
+            while (pos + MatchLimit <= size) {
+                std::size_t bestLength = 0, bestOffset = 0;
+                std::size_t depth = 0;
+                for (auto candidate = head[hash4(pos)]; candidate >= 0 && depth < MaxChain; candidate = chain[candidate], depth++) {
+                    auto offset = pos - static_cast<std::size_t>(candidate);
+                    if (offset > MaxOffset) break;
+                    if (read32(candidate) != read32(pos)) continue;
+
+                    std::size_t length = MinMatch;
+                    while (pos + length < matchEnd && input[candidate + length] == input[pos + length]) length++;
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestOffset = offset;
+                    }
+                }
+                insert(pos);
+
+                if (bestLength < MinMatch) {
+                    pos++;
+                    continue;
+                }
+
+                emit(anchor, pos - anchor, bestOffset, bestLength);
+                for (auto end = pos + bestLength, i = pos + 1; i < end && i + MinMatch <= size; i++) insert(i);
+                pos += bestLength;
+                anchor = pos;
+            }
+        }
+        emit(anchor, size - anchor, 0, 0);
+
+        return output;
+    }
+
+    struct Entry {
+        std::string path;
+        std::string parent;
+        std::size_t size;
+        bool compressed;
+    };
+
 }
 
 int main() {
@@ -57,8 +196,8 @@ int main() {
     outputFile << "\n\n";
     outputFile << "/* Resource definitions */\n";
 
-    std::vector<std::filesystem::path> paths;
-    std::uint64_t identifierCount = 0;
+    std::vector<Entry> entries;
+    std::size_t totalSize = 0, storedSize = 0;
 
     auto resourceLocations = splitString(RESOURCE_LOCATION, ",");
     for (const auto &resourceLocation : resourceLocations) {
@@ -77,42 +216,74 @@ int main() {
         for (const auto &entry : fs::recursive_directory_iterator(resourceLocation)) {
             if (!entry.is_regular_file()) continue;
 
-            auto path = fs::canonical(fs::absolute(entry.path()));
             auto relativePath = fs::relative(entry.path(), fs::absolute(resourceLocation));
 
-            outputFile << "static std::array<std::uint8_t, " << entry.file_size() + 1 << "> " << "resource_" LIBROMFS_PROJECT_NAME "_" << identifierCount << " = {\n";
-            outputFile << "    ";
-
-            std::vector<std::byte> bytes;
+            std::vector<std::uint8_t> bytes;
             bytes.resize(entry.file_size());
 
             auto file = std::fopen(entry.path().string().c_str(), "rb");
             bytes.resize(std::fread(bytes.data(), 1, entry.file_size(), file));
             std::fclose(file);
 
-            for (std::byte byte : bytes) {
+            // Only keep the compressed form when it saves at least an eighth
+            auto packed = LIBROMFS_COMPRESS ? compress(bytes) : std::vector<std::uint8_t>{};
+            bool compressed = LIBROMFS_COMPRESS && packed.size() + bytes.size() / 8 < bytes.size();
+
+            auto identifier = entries.size();
+            auto &stored = compressed ? packed : bytes;
+            outputFile << "static const std::array<std::uint8_t, " << stored.size() + 1 << "> " << "resource_" LIBROMFS_PROJECT_NAME "_" << identifier << " = {\n";
+            outputFile << "    ";
+            for (std::uint8_t byte : stored) {
                 outputFile << static_cast<std::uint32_t>(byte) << ",";
             }
-
             outputFile << "0 };\n\n";
 
-            paths.push_back(relativePath);
-
-            identifierCount++;
+            totalSize += bytes.size();
+            storedSize += stored.size();
+            entries.push_back({
+                toPathString(relativePath.string()),
+                toPathString(relativePath.parent_path().string()),
+                bytes.size(),
+                compressed
+            });
         }
     }
 
     outputFile << "\n";
 
+    // Resources are emitted in slot order, so the perfect hash gives the array index directly
+    std::vector<std::string> keys;
+    for (const auto &entry : entries) keys.push_back(entry.path);
+
+    // Two folders providing the same path would never hash apart, the seed search would not end
+    {
+        auto sorted = keys;
+        std::ranges::sort(sorted);
+        if (auto it = std::ranges::adjacent_find(sorted); it != sorted.end()) {
+            std::printf("[libromfs] Error: resource %s exists in more than one resource folder\n", it->c_str());
+            outputFile.close();
+            std::filesystem::remove("libromfs_resources.cpp");
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto [seeds, slots] = perfectHash(keys);
+    std::vector<std::size_t> bySlot(entries.size());
+    for (std::size_t i = 0; i < entries.size(); i++) bySlot[slots[i]] = i;
+
     {
         outputFile << "/* Resource map */\n";
         outputFile << "ROMFS_VISIBILITY std::span<romfs::impl::ResourceLocation> RomFs_" LIBROMFS_PROJECT_NAME "_get_resources() {\n";
-        outputFile << "    static std::array<romfs::impl::ResourceLocation, " << identifierCount << "> resources = {\n";
+        outputFile << "    static std::array<romfs::impl::ResourceLocation, " << entries.size() << "> resources = {\n";
 
-        for (std::uint64_t i = 0; i < identifierCount; i++) {
-            std::printf("[libromfs] Bundling resource: %s\n", paths[i].string().c_str());
+        for (auto i : bySlot) {
+            const auto &entry = entries[i];
+            std::printf("[libromfs] Bundling resource: %s (%zu bytes%s)\n", entry.path.c_str(), entry.size, entry.compressed ? ", compressed" : "");
 
-            outputFile << "        " << "romfs::impl::ResourceLocation { \"" << toPathString(paths[i].string()) << "\", romfs::Resource({ reinterpret_cast<std::byte*>(resource_" LIBROMFS_PROJECT_NAME "_" << i << ".data()), " << "resource_" LIBROMFS_PROJECT_NAME "_" << i << ".size() - 1 }) " << "},\n";
+            auto identifier = "resource_" LIBROMFS_PROJECT_NAME "_" + std::to_string(i);
+            outputFile << "        " << "romfs::impl::ResourceLocation { \"" << toStringLiteral(entry.path) << "\", \"" << toStringLiteral(entry.parent) << "\", "
+                       << "romfs::Resource({ reinterpret_cast<const std::byte*>(" << identifier << ".data()), " << identifier << ".size() - 1 }), "
+                       << entry.size << ", " << (entry.compressed ? "true" : "false") << " },\n";
         }
         outputFile << "    };";
 
@@ -122,13 +293,26 @@ int main() {
 
     outputFile << "\n\n";
 
+    {
+        outputFile << "/* Perfect hash seeds, one per bucket */\n";
+        outputFile << "ROMFS_VISIBILITY std::span<const std::uint32_t> RomFs_" LIBROMFS_PROJECT_NAME "_get_index() {\n";
+        outputFile << "    static const std::array<std::uint32_t, " << seeds.size() << "> seeds = { ";
+        for (auto seed : seeds) outputFile << seed << ", ";
+        outputFile << "};";
+
+        outputFile << "\n\n    return seeds;\n";
+        outputFile << "}\n\n";
+    }
+
+    outputFile << "\n\n";
+
     {
         outputFile << "/* Resource paths */\n";
         outputFile << "ROMFS_VISIBILITY std::span<std::string_view> RomFs_" LIBROMFS_PROJECT_NAME "_get_paths() {\n";
-        outputFile << "    static std::array<std::string_view, " << identifierCount << "> paths = {\n";
+        outputFile << "    static std::array<std::string_view, " << entries.size() << "> paths = {\n";
 
-        for (std::uint64_t i = 0; i < identifierCount; i++) {
-            outputFile << "        \"" << toPathString(paths[i].string()) << "\",\n";
+        for (auto i : bySlot) {
+            outputFile << "        \"" << toStringLiteral(entries[i].path) << "\",\n";
         }
         outputFile << "    };";
 
@@ -146,4 +330,6 @@ int main() {
     }
 
     outputFile << "\n\n";
+
+    std::printf("[libromfs] Packed %zu resources: %zu bytes stored for %zu bytes of content\n", entries.size(), storedSize, totalSize);
 }
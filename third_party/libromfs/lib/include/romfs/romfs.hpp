@@ -26,7 +26,7 @@ namespace romfs {
     class Resource {
     public:
         constexpr Resource() = default;
-        explicit constexpr Resource(const std::span<std::byte> &content) : m_content(content) {}
+        explicit constexpr Resource(const std::span<const std::byte> &content) : m_content(content) {}
 
         template<ByteType T = std::byte>
         [[nodiscard]] constexpr const T* data() const {
@@ -66,9 +66,28 @@ namespace romfs {
 
         struct ResourceLocation {
             std::string_view path;
-            Resource resource;
+            std::string_view parent;
+            Resource resource;      // stored bytes
+            std::size_t size;       // size of the content once decompressed
+            bool compressed;        // LZ4 block, decompressed on first access
         };
 
+        // FNV-1a with a seed and a final mix, shared with the generator's perfect hash
+        constexpr std::uint64_t hash(std::string_view string, std::uint64_t seed) {
+            std::uint64_t result = 0xcbf29ce484222325ull ^ (seed * 0x9e3779b97f4a7c15ull);
+            for (char c : string) {
+                result ^= static_cast<std::uint8_t>(c);
+                result *= 0x100000001b3ull;
+            }
+            result ^= result >> 33;
+            result *= 0xff51afd7ed558ccdull;
+            result ^= result >> 33;
+            return result;
+        }
+
+        // Decodes an LZ4 block into exactly output.size() bytes
+        bool decompress(std::span<const std::byte> input, std::span<std::byte> output);
+
         [[nodiscard]] ROMFS_VISIBILITY const Resource& ROMFS_CONCAT(get_, LIBROMFS_PROJECT_NAME)(const std::filesystem::path &path);
         [[nodiscard]] ROMFS_VISIBILITY std::vector<std::filesystem::path> ROMFS_CONCAT(list_, LIBROMFS_PROJECT_NAME)(const std::filesystem::path &path);
         [[nodiscard]] ROMFS_VISIBILITY std::string_view ROMFS_CONCAT(name_, LIBROMFS_PROJECT_NAME)();
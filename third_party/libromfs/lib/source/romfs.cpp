@@ -1,26 +1,119 @@
 #include <romfs/romfs.hpp>
 
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
 std::span<romfs::impl::ResourceLocation> ROMFS_CONCAT(ROMFS_NAME, _get_resources)();
+std::span<const std::uint32_t> ROMFS_CONCAT(ROMFS_NAME, _get_index)();
 std::span<std::string_view> ROMFS_CONCAT(ROMFS_NAME, _get_paths)();
 const char* ROMFS_CONCAT(ROMFS_NAME, _get_name)();
 
 namespace romfs {
 
-    ROMFS_VISIBILITY const romfs::Resource &impl::ROMFS_CONCAT(get_, LIBROMFS_PROJECT_NAME)(const std::filesystem::path &path) {
-        for (const auto &[resourcePath, resourceData] : ROMFS_CONCAT(ROMFS_NAME, _get_resources)()) {
-            if (path == resourcePath)
-                return resourceData;
+    namespace {
+
+        // Decompressed content of compressed resources, filled in on first access
+        struct CacheEntry {
+            std::once_flag once;
+            std::unique_ptr<std::byte[]> data;
+            Resource resource;
+        };
+
+        CacheEntry &cacheEntry(std::size_t index) {
+            static const auto count = ROMFS_CONCAT(ROMFS_NAME, _get_resources)().size();
+            static const auto entries = std::make_unique<CacheEntry[]>(count);
+            return entries[index];
+        }
+
+        const Resource *find(std::string_view path) {
+            auto resources = ROMFS_CONCAT(ROMFS_NAME, _get_resources)();
+            auto seeds = ROMFS_CONCAT(ROMFS_NAME, _get_index)();
+            if (resources.empty() || seeds.empty()) return nullptr;
+
+            auto seed = seeds[impl::hash(path, 0) % seeds.size()];
+            auto index = impl::hash(path, seed) % resources.size();
+            auto &location = resources[index];
+            if (location.path != path) return nullptr;
+            if (!location.compressed) return &location.resource;
+
+            auto &entry = cacheEntry(index);
+            std::call_once(entry.once, [&] {
+                // keep the trailing zero that uncompressed resources have, Resource::string() includes it
+                entry.data = std::make_unique<std::byte[]>(location.size + 1);
+                if (!impl::decompress(location.resource.span(), { entry.data.get(), location.size }))
+                    throw std::runtime_error(std::string("Corrupted romfs resource! File '") + std::string(romfs::name()) + "' : " + std::string(path));
+                entry.data[location.size] = std::byte(0);
+                entry.resource = Resource({ entry.data.get(), location.size });
+            });
+            return &entry.resource;
         }
 
+    }
+
+    bool impl::decompress(std::span<const std::byte> input, std::span<std::byte> output) {
+        auto in = reinterpret_cast<const std::uint8_t *>(input.data());
+        auto inEnd = in + input.size();
+        auto out = reinterpret_cast<std::uint8_t *>(output.data());
+        auto outStart = out, outEnd = out + output.size();
+
+        auto readLength = [&](std::size_t &length) {
+            std::uint8_t byte;
+            do {
+                if (in == inEnd) return false;
+                byte = *in++;
+                length += byte;
+            } while (byte == 255);
+            return true;
+        };
+
+        while (in < inEnd) {
+            auto token = *in++;
+
+            std::size_t literals = token >> 4;
+            if (literals == 15 && !readLength(literals)) return false;
+            if (literals > std::size_t(inEnd - in) || literals > std::size_t(outEnd - out)) return false;
+            std::memcpy(out, in, literals);
+            in += literals;
+            out += literals;
+            if (in == inEnd) break;  // the last sequence has no match
+
+            if (inEnd - in < 2) return false;
+            std::size_t offset = in[0] | in[1] << 8;
+            in += 2;
+            if (offset == 0 || offset > std::size_t(out - outStart)) return false;
+
+            std::size_t length = token & 15;
+            if (length == 15 && !readLength(length)) return false;
+            length += 4;
+            if (length > std::size_t(outEnd - out)) return false;
+
+            // may overlap the bytes being written, so copy forward one at a time
+            for (auto match = out - offset; length > 0; length--) *out++ = *match++;
+        }
+
+        return out == outEnd;
+    }
+
+    ROMFS_VISIBILITY const romfs::Resource &impl::ROMFS_CONCAT(get_, LIBROMFS_PROJECT_NAME)(const std::filesystem::path &path) {
+        auto string = path.generic_u8string();
+        if (auto resource = find({ reinterpret_cast<const char *>(string.data()), string.size() }))
+            return *resource;
+
         throw std::invalid_argument(std::string("Invalid romfs resource path! File '") + std::string(romfs::name()) + "' : " + path.string());
     }
 
     ROMFS_VISIBILITY std::vector<std::filesystem::path> impl::ROMFS_CONCAT(list_, LIBROMFS_PROJECT_NAME)(const std::filesystem::path &parent) {
+        auto string = parent.generic_u8string();
+        std::string_view parentString(reinterpret_cast<const char *>(string.data()), string.size());
+        while (parentString.size() > 1 && parentString.back() == '/') parentString.remove_suffix(1);
+
         std::vector<std::filesystem::path> result;
-        for (const auto &pathString : ROMFS_CONCAT(ROMFS_NAME, _get_paths)()) {
-            auto path = std::filesystem::path(pathString);
-            if (path.parent_path() == parent)
-                result.emplace_back(std::move(path));
+        for (const auto &location : ROMFS_CONCAT(ROMFS_NAME, _get_resources)()) {
+            if (location.parent == parentString)
+                result.emplace_back(location.path);
         }
 
         return result;
@@ -30,4 +123,4 @@ namespace romfs {
         return ROMFS_CONCAT(ROMFS_NAME, _get_name)();
     }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <fmt/format.h>
+#include "growing_file.h"
+
+namespace ImPlay::Bench {
+GrowingFile::GrowingFile(const std::filesystem::path &source, const std::filesystem::path &target,
+                         const RangeServer::Shaping &shaping)
+    : source(source), target(target), shaping(shaping) {}
+
+GrowingFile::~GrowingFile() { stop(); }
+
+void GrowingFile::start() {
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(source, ec)) throw std::runtime_error(fmt::format("cannot read {}", source.string()));
+  if (!std::ofstream(target, std::ios::binary | std::ios::trunc))
+    throw std::runtime_error(fmt::format("cannot create {}", target.string()));
+  written_ = 0;
+  running = true;
+  worker = std::thread(&GrowingFile::run, this);
+}
+
+void GrowingFile::stop() {
+  running = false;
+  if (worker.joinable()) worker.join();
+}
+
+void GrowingFile::run() {
+  std::ifstream in(source, std::ios::binary);
+  std::ofstream out(target, std::ios::binary | std::ios::app);
+  std::vector<char> chunk(ChunkSize);
+  ShapedLink link(shaping);
+  link.wait();
+  link.restart();
+
+  while (running && in.read(chunk.data(), chunk.size()).gcount() > 0) {
+    auto n = in.gcount();
+    link.sent(n);
+    out.write(chunk.data(), n).flush();  // visible to the reader, not just buffered
+    written_ += n;
+  }
+}
+}  // namespace ImPlay::Bench
@@ -0,0 +1,39 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+#include "range_server.h"
+
+namespace ImPlay::Bench {
+// Stand-in for a download in progress: appends a local file to a new one on a writer thread,
+// through a ShapedLink that waits once, before the first byte. Lets the follow:// protocol be
+// exercised against a file that is still growing.
+class GrowingFile {
+ public:
+  GrowingFile(const std::filesystem::path &source, const std::filesystem::path &target,
+              const RangeServer::Shaping &shaping);
+  ~GrowingFile();
+
+  // Truncates the target and starts writing, throws std::runtime_error on failure.
+  void start();
+  void stop();
+
+  int64_t written() const { return written_; }
+
+ private:
+  static constexpr size_t ChunkSize = 64 * 1024;
+
+  void run();
+
+  std::filesystem::path source, target;
+  RangeServer::Shaping shaping;
+  std::atomic<int64_t> written_ = 0;
+
+  std::thread worker;
+  std::atomic<bool> running = false;
+};
+}  // namespace ImPlay::Bench
@@ -0,0 +1,43 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+// Build-time compiler for resources/lang/*.json, see LangCatalog for the output format.
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "helpers/lang_catalog.h"
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::fprintf(stderr, "Usage: %s <input.json> <output.cat>\n", argv[0]);
+    return 1;
+  }
+
+  std::ifstream in(argv[1], std::ios::binary);
+  if (!in) {
+    std::fprintf(stderr, "[lang] Error: failed to open %s\n", argv[1]);
+    return 1;
+  }
+  std::stringstream ss;
+  ss << in.rdbuf();
+
+  std::string error;
+  auto data = ImPlay::LangCatalog::compile(ss.str(), &error);
+  if (data.empty()) {
+    std::fprintf(stderr, "[lang] Error: %s: %s\n", argv[1], error.c_str());
+    return 1;
+  }
+
+  std::ofstream out(argv[2], std::ios::binary);
+  out.write(reinterpret_cast<const char *>(data.data()), data.size());
+  if (!out) {
+    std::fprintf(stderr, "[lang] Error: failed to write %s\n", argv[2]);
+    return 1;
+  }
+
+  ImPlay::LangCatalog catalog(data);
+  std::printf("[lang] Compiled %s: %u entries\n", catalog.code(), catalog.size());
+  return 0;
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <fmt/format.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "piece_producer.h"
+
+namespace ImPlay::Bench {
+static constexpr size_t HeaderSize = 32;
+
+PieceProducer::PieceProducer(const std::filesystem::path &source, const std::filesystem::path &dir,
+                             int64_t pieceLength, const RangeServer::Shaping &shaping)
+    : source(source), dir(dir), pieceLength(pieceLength), shaping(shaping) {}
+
+PieceProducer::~PieceProducer() { stop(); }
+
+void PieceProducer::start() {
+  if (pieceLength <= 0 || !input.open(source)) throw std::runtime_error(fmt::format("cannot read {}", source.string()));
+  size = (int64_t)input.size();
+  count = (size + pieceLength - 1) / pieceLength;
+
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  std::filesystem::remove(dir / "pieces.state", ec);
+  std::filesystem::remove(dir / "pieces.data", ec);
+  // data first: a reader that finds the state file expects the content to be sized already
+  if (!data.open(dir / "pieces.data", true, size) ||
+      !state.open(dir / "pieces.state", true, HeaderSize + count * 5))
+    throw std::runtime_error(fmt::format("cannot create the piece cache in {}", dir.string()));
+
+  auto header = state.data();
+  uint32_t version = 1, length = (uint32_t)pieceLength, pieces = (uint32_t)count;
+  uint64_t total = size;
+  memcpy(header, "PTPC", 4);
+  memcpy(header + 4, &version, 4);
+  memcpy(header + 8, &total, 8);
+  memcpy(header + 16, &length, 4);
+  memcpy(header + 20, &pieces, 4);
+
+  running = true;
+  worker = std::thread(&PieceProducer::run, this);
+}
+
+void PieceProducer::stop() {
+  running = false;
+  if (worker.joinable()) worker.join();
+}
+
+void PieceProducer::run() {
+  ShapedLink link(shaping);
+  int64_t cursor = 0;
+  for (int64_t done = 0; done < count && running; done++) {
+    auto piece = pick(cursor);
+    link.wait();
+    link.sent(std::min(pieceLength, size - piece * pieceLength));
+    complete(piece);
+  }
+}
+
+// Highest priority missing piece, the lowest index among equals; the next missing piece in
+// file order when the reader hints nothing.
+int64_t PieceProducer::pick(int64_t &cursor) {
+  auto have = reinterpret_cast<uint32_t *>(state.data() + HeaderSize);
+  auto priority = reinterpret_cast<uint8_t *>(have + count);
+  int64_t best = -1;
+  uint8_t bestPriority = 0;
+  for (int64_t i = 0; i < count; i++) {
+    if (std::atomic_ref<uint32_t>(have[i]).load(std::memory_order_relaxed)) continue;
+    auto p = std::atomic_ref<uint8_t>(priority[i]).load(std::memory_order_relaxed);
+    if (p > bestPriority) {
+      best = i;
+      bestPriority = p;
+    }
+  }
+  if (best >= 0) {
+    counters_.hinted++;
+    return best;
+  }
+  while (std::atomic_ref<uint32_t>(have[cursor]).load(std::memory_order_relaxed)) cursor++;
+  return cursor;
+}
+
+void PieceProducer::complete(int64_t piece) {
+  auto offset = piece * pieceLength;
+  memcpy(data.data() + offset, input.data() + offset, std::min(pieceLength, size - offset));
+  auto word = reinterpret_cast<uint32_t *>(state.data() + HeaderSize) + piece;
+  std::atomic_ref<uint32_t>(*word).store(1, std::memory_order_release);
+#ifdef __linux__
+  syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+  counters_.pieces++;
+}
+}  // namespace ImPlay::Bench
@@ -0,0 +1,49 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+#include "helpers/mapped_file.h"
+#include "range_server.h"
+
+namespace ImPlay::Bench {
+// Stand-in for the torrent backend: fills a PieceCache directory from a local file.
+//
+// Pieces are completed one at a time, the highest priority hinted by the reader first and in
+// file order otherwise, each one a response on a ShapedLink. Lets the ptpiece:// protocol be
+// exercised without a torrent client.
+class PieceProducer {
+ public:
+  struct Counters {
+    std::atomic<int64_t> pieces = 0;
+    std::atomic<int64_t> hinted = 0;  // completed because the reader asked for them
+  };
+
+  PieceProducer(const std::filesystem::path &source, const std::filesystem::path &dir, int64_t pieceLength,
+                const RangeServer::Shaping &shaping);
+  ~PieceProducer();
+
+  // Creates the cache files, throws std::runtime_error on failure.
+  void start();
+  void stop();
+
+  const Counters &counters() const { return counters_; }
+
+ private:
+  void run();
+  int64_t pick(int64_t &cursor);
+  void complete(int64_t piece);
+
+  std::filesystem::path source, dir;
+  int64_t pieceLength, size = 0, count = 0;
+  RangeServer::Shaping shaping;
+  Counters counters_;
+
+  MappedFile input, state, data;
+  std::thread worker;
+  std::atomic<bool> running = false;
+};
+}  // namespace ImPlay::Bench
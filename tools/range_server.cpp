@@ -0,0 +1,288 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fmt/format.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "range_server.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // SIGPIPE is ignored by the caller instead
+#endif
+
+namespace ImPlay::Bench {
+static constexpr size_t MaxHeaderSize = 16 << 10;
+static constexpr size_t ChunkSize = 16 << 10;
+
+static std::string lower(std::string s) {
+  std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+  return s;
+}
+
+static std::string trim(const std::string &s) {
+  auto begin = s.find_first_not_of(" \t");
+  if (begin == std::string::npos) return "";
+  return s.substr(begin, s.find_last_not_of(" \t") - begin + 1);
+}
+
+static std::string percentDecode(const std::string &s) {
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '%' && i + 2 < s.size() && std::isxdigit((unsigned char)s[i + 1]) &&
+        std::isxdigit((unsigned char)s[i + 2])) {
+      out += (char)std::stoi(s.substr(i + 1, 2), nullptr, 16);
+      i += 2;
+    } else {
+      out += s[i];
+    }
+  }
+  return out;
+}
+
+// Parses a single "bytes=a-b", "bytes=a-" or "bytes=-n" range against size. Returns false for
+// a range that cannot be satisfied; anything else unsupported (multiple ranges) yields the
+// whole file, which HTTP allows.
+static bool parseRange(const std::string &header, int64_t size, int64_t &first, int64_t &last) {
+  first = 0;
+  last = size - 1;
+  auto value = lower(trim(header));
+  if (!value.starts_with("bytes=") || value.find(',') != std::string::npos) return true;
+  auto spec = value.substr(6);
+  auto dash = spec.find('-');
+  if (dash == std::string::npos) return true;
+  try {
+    auto a = trim(spec.substr(0, dash)), b = trim(spec.substr(dash + 1));
+    if (a.empty()) {
+      if (b.empty()) return true;
+      first = std::max<int64_t>(0, size - std::stoll(b));
+    } else {
+      first = (int64_t)std::stoll(a);
+      if (!b.empty()) last = std::min<int64_t>(size - 1, std::stoll(b));
+    }
+  } catch (...) {
+    return true;
+  }
+  return first < size && first <= last;
+}
+
+RangeServer::RangeServer(const std::filesystem::path &root, const Shaping &shaping) : root(root), shaping(shaping) {}
+
+RangeServer::~RangeServer() { stop(); }
+
+void RangeServer::start() {
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd < 0) throw std::runtime_error(fmt::format("socket: {}", strerror(errno)));
+  int yes = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t len = sizeof(addr);
+  if (bind(listenFd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenFd, 16) < 0 ||
+      getsockname(listenFd, (sockaddr *)&addr, &len) < 0) {
+    auto error = fmt::format("bind 127.0.0.1: {}", strerror(errno));
+    close(listenFd);
+    listenFd = -1;
+    throw std::runtime_error(error);
+  }
+  port = ntohs(addr.sin_port);
+  running = true;
+  acceptor = std::thread(&RangeServer::acceptLoop, this);
+}
+
+void RangeServer::stop() {
+  if (!running.exchange(false)) return;
+  shutdown(listenFd, SHUT_RDWR);
+  close(listenFd);
+  if (acceptor.joinable()) acceptor.join();
+
+  std::vector<std::thread> pending;
+  {
+    std::lock_guard<std::mutex> l(lock);
+    for (int fd : clients) shutdown(fd, SHUT_RDWR);
+    pending.swap(workers);
+  }
+  for (auto &t : pending) t.join();
+}
+
+std::string RangeServer::url(const std::string &name) const {
+  std::string path;
+  for (unsigned char c : name) {
+    if (std::isalnum(c) || strchr("-._~/", c))
+      path += (char)c;
+    else
+      path += fmt::format("%{:02X}", c);
+  }
+  return fmt::format("http://127.0.0.1:{}/{}", port, path);
+}
+
+void RangeServer::acceptLoop() {
+  while (running) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) {
+      if (!running) break;
+      continue;
+    }
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    counters_.connections++;
+    std::lock_guard<std::mutex> l(lock);
+    clients.insert(fd);
+    workers.emplace_back(&RangeServer::serve, this, fd);
+  }
+}
+
+void RangeServer::serve(int fd) {
+  std::string buffer;
+  ShapedLink link(shaping);
+  char data[4096];
+  while (running) {
+    auto end = buffer.find("\r\n\r\n");
+    if (end == std::string::npos) {
+      if (buffer.size() > MaxHeaderSize) break;
+      auto n = recv(fd, data, sizeof(data), 0);
+      if (n <= 0) break;
+      buffer.append(data, n);
+      continue;
+    }
+    auto head = buffer.substr(0, end);
+    buffer.erase(0, end + 4);
+
+    auto lineEnd = head.find("\r\n");
+    auto requestLine = head.substr(0, lineEnd);
+    auto sp1 = requestLine.find(' '), sp2 = requestLine.rfind(' ');
+    if (sp1 == std::string::npos || sp2 == sp1) break;
+    auto method = requestLine.substr(0, sp1);
+    auto target = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+    bool keepAlive = requestLine.substr(sp2 + 1) == "HTTP/1.1";
+
+    std::string range;
+    size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+    while (pos < head.size()) {
+      auto next = head.find("\r\n", pos);
+      if (next == std::string::npos) next = head.size();
+      auto line = head.substr(pos, next - pos);
+      pos = next + 2;
+      auto colon = line.find(':');
+      if (colon == std::string::npos) continue;
+      auto name = lower(trim(line.substr(0, colon)));
+      auto value = trim(line.substr(colon + 1));
+      if (name == "range") range = value;
+      if (name == "connection") keepAlive = lower(value) != "close";
+    }
+
+    counters_.requests++;
+    if (!range.empty()) counters_.ranges++;
+    link.wait();
+    if (!respond(fd, link, method, target, range) || !keepAlive) break;
+  }
+
+  std::lock_guard<std::mutex> l(lock);
+  clients.erase(fd);
+  close(fd);
+}
+
+bool RangeServer::respond(int fd, ShapedLink &link, const std::string &method, const std::string &target,
+                          const std::string &range) {
+  auto status = [&](const char *code, const std::string &extra = "") {
+    auto msg = fmt::format("HTTP/1.1 {}\r\nContent-Length: 0\r\n{}\r\n", code, extra);
+    return sendAll(fd, msg.data(), msg.size());
+  };
+  if (method != "GET" && method != "HEAD") return status("405 Method Not Allowed", "Allow: GET, HEAD\r\n");
+
+  auto name = percentDecode(target.substr(0, target.find_first_of("?#")));
+  auto rel = std::filesystem::path(name).relative_path().lexically_normal();
+  if (rel.empty() || rel.begin()->string() == "..") return status("404 Not Found");
+  auto path = root / rel;
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(path, ec)) return status("404 Not Found");
+  auto size = (int64_t)std::filesystem::file_size(path, ec);
+  if (ec) return status("404 Not Found");
+
+  int64_t first, last;
+  if (!parseRange(range, size, first, last))
+    return status("416 Range Not Satisfiable", fmt::format("Content-Range: bytes */{}\r\n", size));
+
+  bool partial = !range.empty() && (first > 0 || last < size - 1);
+  int64_t length = size > 0 ? last - first + 1 : 0;
+  auto header = fmt::format(
+      "HTTP/1.1 {}\r\nContent-Type: application/octet-stream\r\nAccept-Ranges: bytes\r\nContent-Length: {}\r\n",
+      partial ? "206 Partial Content" : "200 OK", length);
+  if (partial) header += fmt::format("Content-Range: bytes {}-{}/{}\r\n", first, last, size);
+  // a validator like real servers send, so caches can tell versions of the file apart
+  auto mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+  header += fmt::format("ETag: \"{:x}-{:x}\"\r\n\r\n", (uint64_t)mtime, size);
+  if (!sendAll(fd, header.data(), header.size())) return false;
+  if (method == "HEAD" || length == 0) return true;
+  return sendBody(fd, link, path, first, length);
+}
+
+bool RangeServer::sendAll(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    auto n = send(fd, data, size, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool RangeServer::sendBody(int fd, ShapedLink &link, const std::filesystem::path &path, int64_t offset,
+                           int64_t length) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.seekg(offset)) return false;
+
+  std::vector<char> chunk(ChunkSize);
+  link.restart();
+  while (length > 0 && running) {
+    auto n = link.limit(std::min<int64_t>(length, chunk.size()));
+    if (!file.read(chunk.data(), n)) return false;
+    if (!sendAll(fd, chunk.data(), n)) return false;
+    counters_.bytes += n;
+    length -= n;
+    if (link.sent(n)) counters_.stalls++;
+  }
+  return length == 0;
+}
+
+ShapedLink::ShapedLink(const RangeServer::Shaping &shaping)
+    : shaping(shaping), paceStart(std::chrono::steady_clock::now()) {}
+
+void ShapedLink::wait() const {
+  if (shaping.latencyMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(shaping.latencyMs));
+}
+
+void ShapedLink::restart() {
+  paceStart = std::chrono::steady_clock::now();
+  paced = 0;
+}
+
+int64_t ShapedLink::limit(int64_t n) const {
+  if (shaping.stallEvery <= 0) return n;
+  return std::min(n, std::max<int64_t>(1, shaping.stallEvery - sinceStall));
+}
+
+bool ShapedLink::sent(int64_t n) {
+  paced += n;
+  if (shaping.stallEvery > 0 && (sinceStall += n) >= shaping.stallEvery) {
+    sinceStall = 0;
+    std::this_thread::sleep_for(std::chrono::milliseconds(shaping.stallMs));
+    restart();
+    return true;
+  }
+  if (shaping.bandwidth > 0)
+    std::this_thread::sleep_until(paceStart + std::chrono::microseconds(paced * 1000000 / shaping.bandwidth));
+  return false;
+}
+}  // namespace ImPlay::Bench
@@ -0,0 +1,93 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ImPlay::Bench {
+// Minimal HTTP/1.1 file server on 127.0.0.1 for the streaming benchmark.
+//
+// Serves the files of one directory with GET/HEAD, single byte ranges and keep-alive, which
+// is all mpv's (ffmpeg's) http protocol needs to open, probe and seek. Every connection is a
+// ShapedLink, so slow or flaky links can be replayed offline.
+class ShapedLink;
+
+class RangeServer {
+ public:
+  struct Shaping {
+    int64_t bandwidth = 0;   // bytes/s per connection, 0 for unlimited
+    int latencyMs = 0;       // before every response (piece, ...)
+    int64_t stallEvery = 0;  // bytes per connection between stalls, 0 for none
+    int stallMs = 0;
+  };
+
+  struct Counters {
+    std::atomic<int64_t> connections = 0;
+    std::atomic<int64_t> requests = 0;
+    std::atomic<int64_t> ranges = 0;  // requests with a Range header
+    std::atomic<int64_t> bytes = 0;   // body bytes sent
+    std::atomic<int64_t> stalls = 0;
+  };
+
+  RangeServer(const std::filesystem::path &root, const Shaping &shaping);
+  ~RangeServer();
+
+  // Binds an ephemeral port, throws std::runtime_error on failure.
+  void start();
+  void stop();
+
+  std::string url(const std::string &name) const;
+  const Counters &counters() const { return counters_; }
+
+ private:
+  void acceptLoop();
+  void serve(int fd);
+  bool respond(int fd, ShapedLink &link, const std::string &method, const std::string &target,
+               const std::string &range);
+  bool sendAll(int fd, const char *data, size_t size);
+  bool sendBody(int fd, ShapedLink &link, const std::filesystem::path &path, int64_t offset, int64_t length);
+
+  std::filesystem::path root;
+  Shaping shaping;
+  Counters counters_;
+  int listenFd = -1;
+  int port = 0;
+  std::atomic<bool> running = false;
+  std::thread acceptor;
+
+  std::mutex lock;
+  std::set<int> clients;
+  std::vector<std::thread> workers;
+};
+
+// The shaping shared by the bench sources that stand in for a network: a fixed latency before
+// each response, a bandwidth cap and, after every stallEvery bytes, a pause of stallMs.
+//
+// Callers wait() before a response, send at most limit(n) bytes at a time and report them with
+// sent(). Stalls are counted over the whole link; the pace restarts with restart() and after
+// every stall, which is not made up for by a burst afterwards.
+class ShapedLink {
+ public:
+  explicit ShapedLink(const RangeServer::Shaping &shaping);
+
+  void wait() const;
+  void restart();
+  int64_t limit(int64_t n) const;
+  // Sleeps as the link would, returns true if the link stalled.
+  bool sent(int64_t n);
+
+ private:
+  RangeServer::Shaping shaping;
+  std::chrono::steady_clock::time_point paceStart;
+  int64_t paced = 0;
+  int64_t sinceStall = 0;
+};
+}  // namespace ImPlay::Bench
@@ -0,0 +1,529 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+// Offline HTTP streaming benchmark: serves a local media file through RangeServer with the
+// requested link shaping and drives a headless player core (the app's Mpv wrapper and
+// CacheController, vo=null) through scripted scenarios. Every run starts a fresh core, so the
+// open is always cold; the connection counters of the server are reported with the timings.
+// With --pieces the file goes through the ptpiece:// protocol instead, fed by a PieceProducer
+// with the same shaping, and with --grow through the follow:// protocol from a file a
+// GrowingFile is still appending to. --disk-cache reads through the persistent stream cache,
+// whose directory outlives the runs, so every run after the first shows the warm case.
+// --local opens the file itself, dropped from the page cache before every run, to compare
+// cold opens with and without --readahead. A run whose file stays resident (dirty pages, a
+// filesystem that ignores the advice) is reported, its numbers are not cold.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "cache_controller.h"
+#include "config.h"
+#include "disk_cache.h"
+#include "follow_stream.h"
+#include "growing_file.h"
+#include "mpv.h"
+#include "piece_producer.h"
+#include "piece_stream.h"
+#include "range_server.h"
+#include "readahead.h"
+
+using namespace ImPlay;
+using clock_type = std::chrono::steady_clock;
+
+struct Options {
+  std::string file;
+  Bench::RangeServer::Shaping shaping;
+  std::vector<std::string> scenarios = {"play", "seek", "storm", "switch"};
+  int runs = 3;
+  int seeks = 10;
+  int playSecs = 10;
+  int64_t pieceLength = 0;  // ptpiece:// instead of HTTP when set
+  bool grow = false;        // follow:// from a file still being written
+  std::string diskCache;    // stream cache directory, shared by all runs
+  bool local = false;       // the file itself, cold, instead of HTTP
+  bool readahead = false;   // warm head and index as Player::load does
+  unsigned seed = 1;
+  std::string cache = "adaptive";
+  std::string json;
+  std::vector<std::string> mpvOptions;
+  bool verbose = false;
+};
+
+struct Summary {
+  std::vector<double> values;  // ms
+  int failed = 0;              // timed out
+
+  void add(double ms) { values.push_back(ms); }
+  double at(double q) const {
+    if (values.empty()) return -1;
+    auto sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[std::min(sorted.size() - 1, (size_t)(q * (sorted.size() - 1) + 0.5))];
+  }
+  nlohmann::json toJson() const {
+    return {{"count", values.size()}, {"failed", failed}, {"min", at(0)},
+            {"median", at(0.5)},      {"p90", at(0.9)},   {"max", at(1)}};
+  }
+};
+
+struct Results {
+  Summary ttff, seek, storm, audioSwitch, videoSwitch;
+  int rebuffers = 0;
+  double rebufferMs = 0;
+  int64_t diskHitBytes = 0, diskMissBytes = 0;
+};
+
+#ifdef __linux__
+// Share of the file's pages in the page cache, to tell whether dropping it worked.
+static double resident(const std::filesystem::path &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return 0;
+  std::error_code ec;
+  auto size = (size_t)std::filesystem::file_size(path, ec);
+  void *addr = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (addr == MAP_FAILED) return 0;
+  auto page = (size_t)sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> pages((size + page - 1) / page);
+  double share = 0;
+  if (mincore(addr, size, pages.data()) == 0)
+    share = (double)std::count_if(pages.begin(), pages.end(), [](unsigned char p) { return p & 1; }) / pages.size();
+  munmap(addr, size);
+  return share;
+}
+#endif
+
+static double msSince(clock_type::time_point start) {
+  return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+// One player core with its cache controller, waited on from the calling thread.
+class Session {
+ public:
+  Session(const Options &opts, Results &results) : cache(&config, &mpv), results(results) {
+    auto &c = config.Data.Cache;
+    c.Log = opts.verbose;
+    if (opts.cache.starts_with("fixed:")) {
+      c.Adaptive = false;
+      c.Size = std::stoi(opts.cache.substr(6));
+    } else if (opts.cache.starts_with("adaptive:")) {
+      c.MaxMemory = std::stoi(opts.cache.substr(9));
+    }
+    controlled = opts.cache != "mpv";
+    if (!opts.diskCache.empty()) {
+      disk = std::make_unique<DiskCache>(&config, &mpv);
+      if (!disk->open(opts.diskCache)) throw std::runtime_error(fmt::format("cannot use {}", opts.diskCache));
+    }
+
+    // no user config or scripts, and no ytdl hook probing every http URL
+    std::pair<const char *, const char *> defaults[] = {{"config", "no"}, {"load-scripts", "no"}, {"ytdl", "no"},
+                                                        {"vo", "null"},    {"ao", "null"},           {"idle", "yes"},
+                                                        {"keep-open", "yes"}};
+    for (auto [name, value] : defaults) mpv.option(name, value);
+    for (auto &opt : opts.mpvOptions) {
+      auto eq = opt.find('=');
+      if (mpv.option(opt.substr(0, eq).c_str(), eq == std::string::npos ? "yes" : opt.substr(eq + 1).c_str()) < 0)
+        throw std::runtime_error(fmt::format("invalid mpv option: {}", opt));
+    }
+    if (opts.verbose)
+      mpv.requestLog("info", [](const char *prefix, const char *level, const char *text) {
+        fmt::print(stderr, "[{}] {}: {}", prefix, level, text);
+      });
+    mpv.initCore();
+    PieceStream::add(&mpv);
+    FollowStream::add(&mpv);
+    if (disk) disk->init();
+
+    mpv.observeEvent(MPV_EVENT_FILE_LOADED, [this](void *) { loaded = true; });
+    mpv.observeEvent(MPV_EVENT_PLAYBACK_RESTART, [this](void *) { restarts++; });
+    mpv.observeEvent(MPV_EVENT_AUDIO_RECONFIG, [this](void *) { audioReconfigs++; });
+    mpv.observeEvent(MPV_EVENT_VIDEO_RECONFIG, [this](void *) { videoReconfigs++; });
+    mpv.observeEvent(MPV_EVENT_END_FILE, [this](void *data) {
+      if (static_cast<mpv_event_end_file *>(data)->reason == MPV_END_FILE_REASON_ERROR) failed = true;
+    });
+    mpv.observeProperty<int, MPV_FORMAT_FLAG>("paused-for-cache", [this](int flag) {
+      if (flag && !buffering) {
+        this->results.rebuffers++;
+        bufferStart = clock_type::now();
+      } else if (!flag && buffering) {
+        this->results.rebufferMs += msSince(bufferStart);
+      }
+      buffering = flag;
+    });
+    if (controlled) cache.init();
+  }
+
+  bool waitFor(const std::function<bool()> &done, double secs = 30) {
+    auto deadline = clock_type::now() + std::chrono::duration<double>(secs);
+    while (!done()) {
+      if (failed || clock_type::now() > deadline) return false;
+      mpv.waitEvent(0.05);
+    }
+    return true;
+  }
+
+  bool open(const std::string &url) {
+    auto start = clock_type::now();
+    mpv.commandv("loadfile", url.c_str(), nullptr);
+    if (!waitFor([&] { return loaded && restarts > 0; }, 60)) {
+      results.ttff.failed++;
+      return false;
+    }
+    results.ttff.add(msSince(start));
+    duration = mpv.property<double, MPV_FORMAT_DOUBLE>("duration");
+    return true;
+  }
+
+  void play(int secs) {
+    auto until = clock_type::now() + std::chrono::seconds(secs);
+    waitFor([&] { return clock_type::now() >= until; }, secs + 1);
+  }
+
+  // Waits for every seek to restart playback before the next one.
+  void seek(std::mt19937 &rng, int count) {
+    std::uniform_real_distribution<double> pos(0.05, 0.9);
+    for (int i = 0; i < count && !failed; i++) {
+      auto target = fmt::format("{:.3f}", pos(rng) * duration);
+      auto before = restarts;
+      auto start = clock_type::now();
+      mpv.commandv("seek", target.c_str(), "absolute", nullptr);
+      if (waitFor([&] { return restarts > before; }))
+        results.seek.add(msSince(start));
+      else
+        results.seek.failed++;
+    }
+  }
+
+  // Fires count seeks 100ms apart, like a user dragging the seek bar, and measures from the
+  // last one until playback resumes near its target.
+  void storm(std::mt19937 &rng, int count) {
+    std::uniform_real_distribution<double> pos(0.05, 0.9);
+    double target = 0;
+    clock_type::time_point last;
+    for (int i = 0; i < count && !failed; i++) {
+      target = pos(rng) * duration;
+      last = clock_type::now();
+      mpv.commandv("seek", fmt::format("{:.3f}", target).c_str(), "absolute", nullptr);
+      auto next = last + std::chrono::milliseconds(100);
+      waitFor([&] { return clock_type::now() >= next; }, 1);
+    }
+    // keyframe seeks land up to a GOP away from the target
+    double slack = std::max(10.0, duration * 0.02);
+    auto landed = [&] {
+      if (restarts == 0 || mpv.property<int, MPV_FORMAT_FLAG>("seeking")) return false;
+      return std::abs(mpv.property<double, MPV_FORMAT_DOUBLE>("time-pos") - target) <= slack;
+    };
+    if (waitFor(landed))
+      results.storm.add(msSince(last));
+    else
+      results.storm.failed++;
+  }
+
+  // Cycles through the audio and video tracks; with a single track of a type it is toggled
+  // off and back on, only the re-enable is timed. Both force the demuxer to refetch data.
+  void switchTracks(int count) {
+    for (auto type : {"audio", "video"}) {
+      auto ids = trackIds(type);
+      if (ids.empty()) continue;
+      auto prop = strcmp(type, "audio") == 0 ? "aid" : "vid";
+      auto &reconfigs = strcmp(type, "audio") == 0 ? audioReconfigs : videoReconfigs;
+      auto &summary = strcmp(type, "audio") == 0 ? results.audioSwitch : results.videoSwitch;
+      for (int i = 0; i < count && !failed; i++) {
+        if (ids.size() == 1) {
+          mpv.commandv("set", prop, "no", nullptr);
+          auto before = reconfigs;
+          waitFor([&] { return reconfigs > before; }, 5);
+        }
+        auto id = std::to_string(ids[(i + 1) % ids.size()]);
+        auto before = reconfigs;
+        auto start = clock_type::now();
+        mpv.commandv("set", prop, id.c_str(), nullptr);
+        if (waitFor([&] { return reconfigs > before && !mpv.property<int, MPV_FORMAT_FLAG>("paused-for-cache"); }))
+          summary.add(msSince(start));
+        else
+          summary.failed++;
+      }
+    }
+  }
+
+  int64_t maxBytes() const { return cache.status().maxBytes; }
+  DiskCache::Stats diskStats() { return disk ? disk->stats() : DiskCache::Stats{}; }
+
+ private:
+  std::vector<int64_t> trackIds(const char *type) {
+    std::vector<int64_t> ids;
+    auto count = mpv.property<int64_t, MPV_FORMAT_INT64>("track-list/count");
+    for (int64_t i = 0; i < count; i++) {
+      if (mpv.property(fmt::format("track-list/{}/type", i).c_str()) != type) continue;
+      ids.push_back(mpv.property<int64_t, MPV_FORMAT_INT64>(fmt::format("track-list/{}/id", i).c_str()));
+    }
+    return ids;
+  }
+
+  std::unique_ptr<DiskCache> disk;  // outlives mpv, whose teardown closes the streams reading through it
+  Mpv mpv;
+  Config config;
+  CacheController cache;
+  Results &results;
+  bool controlled = true;
+
+  bool loaded = false, failed = false, buffering = false;
+  int restarts = 0, audioReconfigs = 0, videoReconfigs = 0;
+  double duration = 0;
+  clock_type::time_point bufferStart;
+};
+
+static void usage(const char *prog) {
+  fmt::print(stderr,
+             "Usage: {} [options] <media file>\n"
+             "  --bandwidth <KiB/s>    per connection, 0 for unlimited (default 0)\n"
+             "  --latency <ms>         before every response (default 0)\n"
+             "  --stall-every <KiB>    pause a connection after this many bytes (default never)\n"
+             "  --stall <ms>           length of every pause (default 2000)\n"
+             "  --pieces <KiB>         read through ptpiece:// with this piece length instead of HTTP\n"
+             "  --disk-cache <dir>     read HTTP through the persistent stream cache in this directory\n"
+             "  --local                open the file directly, evicted from the page cache before every run\n"
+             "  --readahead            with --local, warm its head and index while it is being opened\n"
+             "  --grow                 read through follow:// from a file written at the shaped rate\n"
+             "  --scenarios <list>     comma separated: play,seek,storm,switch (default all)\n"
+             "  --runs <n>             cold opens, each followed by the scenarios (default 3)\n"
+             "  --seeks <n>            seeks, storm seeks and switches per scenario (default 10)\n"
+             "  --play <secs>          length of the play scenario (default 10)\n"
+             "  --cache <mode>         adaptive[:<max MiB>], fixed:<MiB> or mpv (default adaptive)\n"
+             "  --seed <n>             seek position seed (default 1)\n"
+             "  --mpv <name=value>     extra mpv option, repeatable\n"
+             "  --json <file>          also write the results as JSON\n"
+             "  --verbose              print the mpv log and cache decisions\n",
+             prog);
+}
+
+static bool parse(int argc, char *argv[], Options &opts) {
+  opts.shaping.stallMs = 2000;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) throw std::invalid_argument(fmt::format("{} needs a value", arg));
+      return argv[++i];
+    };
+    if (arg == "--bandwidth")
+      opts.shaping.bandwidth = std::stoll(value()) * 1024;
+    else if (arg == "--latency")
+      opts.shaping.latencyMs = std::stoi(value());
+    else if (arg == "--stall-every")
+      opts.shaping.stallEvery = std::stoll(value()) * 1024;
+    else if (arg == "--stall")
+      opts.shaping.stallMs = std::stoi(value());
+    else if (arg == "--pieces")
+      opts.pieceLength = std::stoll(value()) * 1024;
+    else if (arg == "--disk-cache")
+      opts.diskCache = value();
+    else if (arg == "--local")
+      opts.local = true;
+    else if (arg == "--readahead")
+      opts.readahead = true;
+    else if (arg == "--grow")
+      opts.grow = true;
+    else if (arg == "--runs")
+      opts.runs = std::stoi(value());
+    else if (arg == "--seeks")
+      opts.seeks = std::stoi(value());
+    else if (arg == "--play")
+      opts.playSecs = std::stoi(value());
+    else if (arg == "--seed")
+      opts.seed = std::stoul(value());
+    else if (arg == "--cache")
+      opts.cache = value();
+    else if (arg == "--json")
+      opts.json = value();
+    else if (arg == "--mpv")
+      opts.mpvOptions.push_back(value());
+    else if (arg == "--verbose")
+      opts.verbose = true;
+    else if (arg == "--scenarios") {
+      opts.scenarios.clear();
+      auto list = value();
+      for (size_t pos = 0; pos <= list.size();) {
+        auto end = std::min(list.find(',', pos), list.size());
+        if (end > pos) opts.scenarios.push_back(list.substr(pos, end - pos));
+        pos = end + 1;
+      }
+    } else if (arg.starts_with("--"))
+      throw std::invalid_argument(fmt::format("unknown option {}", arg));
+    else
+      opts.file = arg;
+  }
+  return !opts.file.empty();
+}
+
+int main(int argc, char *argv[]) {
+  Options opts;
+  try {
+    if (!parse(argc, argv, opts)) {
+      usage(argv[0]);
+      return 1;
+    }
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "Error: {}\n", e.what());
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::signal(SIGPIPE, SIG_IGN);  // mpv drops connections on every seek
+  auto path = std::filesystem::absolute(opts.file);
+  if (!std::filesystem::is_regular_file(path)) {
+    fmt::print(stderr, "Error: {} is not a file\n", opts.file);
+    return 1;
+  }
+
+  Results results;
+  Bench::RangeServer server(path.parent_path(), opts.shaping);
+  auto pieceDir = std::filesystem::temp_directory_path() / fmt::format("stream_bench-{}", getpid());
+  int64_t pieces = 0, hinted = 0;
+  try {
+    std::string url;
+    if (opts.pieceLength > 0) {
+      url = fmt::format("{}://{}", PieceStream::Protocol, pieceDir.string());
+    } else if (opts.local) {
+      url = path.string();
+    } else if (opts.grow) {
+      url = fmt::format("{}://{}", FollowStream::Protocol, (pieceDir / path.filename()).string());
+    } else {
+      server.start();
+      url = server.url(path.filename().string());
+    }
+    fmt::print("serving {} at {}\n", path.string(), url);
+
+    std::mt19937 rng(opts.seed);
+    auto enabled = [&](const char *name) {
+      return std::find(opts.scenarios.begin(), opts.scenarios.end(), name) != opts.scenarios.end();
+    };
+    for (int run = 0; run < opts.runs; run++) {
+      // a fresh cache every run, its pieces would all be there from the previous one
+      std::unique_ptr<Bench::PieceProducer> producer;
+      if (opts.pieceLength > 0) {
+        producer = std::make_unique<Bench::PieceProducer>(path, pieceDir, opts.pieceLength, opts.shaping);
+        producer->start();
+      }
+      std::unique_ptr<Bench::GrowingFile> writer;
+      if (opts.grow) {
+        std::filesystem::create_directories(pieceDir);
+        writer = std::make_unique<Bench::GrowingFile>(path, pieceDir / path.filename(), opts.shaping);
+        writer->start();
+      }
+#ifdef POSIX_FADV_DONTNEED
+      if (opts.local) {
+        // only clean pages are dropped, which is all of them for a file that is only read
+        if (int fd = open(path.c_str(), O_RDONLY); fd >= 0) {
+          posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#ifdef __linux__
+          if (auto share = resident(path); share > 0.01)
+            fmt::print(stderr, "run {}: {:.0f}% of the file is still cached, the open is not cold\n", run + 1,
+                       share * 100);
+#endif
+          close(fd);
+        }
+      }
+#endif
+      Session session(opts, results);
+      // Player::load hands the file to the Readahead worker right before loadfile
+      std::thread warm;
+      if (opts.local && opts.readahead) warm = std::thread(&Readahead::warm, path);
+      bool opened = session.open(url);
+      if (warm.joinable()) warm.join();
+      if (!opened) {
+        fmt::print(stderr, "run {}: open failed\n", run + 1);
+        continue;
+      }
+      if (enabled("play")) session.play(opts.playSecs);
+      if (enabled("seek")) session.seek(rng, opts.seeks);
+      if (enabled("storm")) session.storm(rng, opts.seeks);
+      if (enabled("switch")) session.switchTracks(opts.seeks);
+      fmt::print("run {}: done, demuxer-max-bytes {} MiB\n", run + 1, session.maxBytes() >> 20);
+      if (!opts.diskCache.empty()) {
+        auto disk = session.diskStats();
+        fmt::print("run {}: disk cache hit ratio {:.1f}%, {:.1f} MiB saved\n", run + 1, disk.hitRatio() * 100,
+                   disk.hitBytes / 1048576.0);
+        results.diskHitBytes += disk.hitBytes;
+        results.diskMissBytes += disk.missBytes;
+      }
+      if (producer) {
+        producer->stop();
+        pieces += producer->counters().pieces;
+        hinted += producer->counters().hinted;
+      }
+      if (writer) {
+        writer->stop();
+        fmt::print("run {}: {:.1f} MiB written\n", run + 1, writer->written() / 1048576.0);
+      }
+    }
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "Error: {}\n", e.what());
+    return 1;
+  }
+  server.stop();
+  std::error_code ec;
+  std::filesystem::remove_all(pieceDir, ec);
+
+  auto &c = server.counters();
+  fmt::print("\n{:<14}{:>6}{:>8}{:>10}{:>10}{:>10}{:>10}\n", "ms", "count", "failed", "min", "median", "p90",
+             "max");
+  struct Row {
+    const char *label, *key;
+    const Summary *summary;
+  } rows[] = {{"ttff", "ttff", &results.ttff},
+              {"seek", "seek", &results.seek},
+              {"seek storm", "seek_storm", &results.storm},
+              {"audio switch", "audio_switch", &results.audioSwitch},
+              {"video switch", "video_switch", &results.videoSwitch}};
+  for (auto &[name, key, s] : rows) {
+    if (s->values.empty() && s->failed == 0) continue;
+    fmt::print("{:<14}{:>6}{:>8}{:>10.1f}{:>10.1f}{:>10.1f}{:>10.1f}\n", name, s->values.size(), s->failed, s->at(0),
+               s->at(0.5), s->at(0.9), s->at(1));
+  }
+  fmt::print("\nrebuffers {} ({:.0f} ms), connections {}, requests {} ({} ranged), {:.1f} MiB sent, {} stalls\n",
+             results.rebuffers, results.rebufferMs, c.connections.load(), c.requests.load(), c.ranges.load(),
+             c.bytes.load() / 1048576.0, c.stalls.load());
+  if (opts.pieceLength > 0) fmt::print("pieces {} ({} on reader priority)\n", pieces, hinted);
+  if (!opts.diskCache.empty())
+    fmt::print("disk cache {:.1f} MiB from disk, {:.1f} MiB fetched\n", results.diskHitBytes / 1048576.0,
+               results.diskMissBytes / 1048576.0);
+
+  if (!opts.json.empty()) {
+    nlohmann::json j;
+    j["file"] = path.string();
+    j["cache"] = opts.cache;
+    if (opts.local) j["readahead"] = opts.readahead;
+    j["shaping"] = {{"bandwidth", opts.shaping.bandwidth},
+                    {"latency_ms", opts.shaping.latencyMs},
+                    {"stall_every", opts.shaping.stallEvery},
+                    {"stall_ms", opts.shaping.stallMs}};
+    for (auto &[name, key, s] : rows) j[key] = s->toJson();
+    j["rebuffers"] = results.rebuffers;
+    j["rebuffer_ms"] = results.rebufferMs;
+    j["server"] = {{"connections", c.connections.load()},
+                   {"requests", c.requests.load()},
+                   {"ranged", c.ranges.load()},
+                   {"bytes", c.bytes.load()},
+                   {"stalls", c.stalls.load()}};
+    if (!opts.diskCache.empty())
+      j["disk_cache"] = {{"hit_bytes", results.diskHitBytes}, {"miss_bytes", results.diskMissBytes}};
+    if (opts.pieceLength > 0) j["pieces"] = {{"completed", pieces}, {"hinted", hinted}};
+    std::ofstream(opts.json) << j.dump(2) << '\n';
+  }
+  return results.ttff.values.empty() ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+// Copyright (c) 2022-2025 tsl0922. All rights reserved.
+// SPDX-License-Identifier: GPL-2.0-only
+
+// Offline check of the provider subtitle cache: serves a directory of subtitle files through
+// RangeServer and prefetches all of them with a SubtitleCache on a headless mpv core, as the
+// player does for the providers of a title. The first run starts from an empty cache unless
+// --cache names an existing one; every later run reopens it, like a restart, and should be
+// served without a single request. Before that, SRT repair is checked on a few inline samples:
+// valid files must come through unchanged, broken ones repaired.
+
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include <unistd.h>
+#include "mpv.h"
+#include "helpers/subtitle_text.h"
+#include "range_server.h"
+#include "subtitle_cache.h"
+
+using namespace ImPlay;
+using clock_type = std::chrono::steady_clock;
+
+struct Options {
+  std::string dir;
+  std::string cache;  // kept when given, a temporary directory otherwise
+  Bench::RangeServer::Shaping shaping;
+  int runs = 2;
+  int timeoutSecs = 60;
+};
+
+// Runs SRT samples through SubtitleText::normalize, returns the number that came out wrong.
+static int checkRepairs() {
+  struct Sample {
+    const char *name, *input, *expected;
+    int repairs;
+  };
+  static constexpr Sample samples[] = {
+      {"multi-line cues", "1\n00:00:01,000 --> 00:00:02,000\nFirst line\nSecond line\n\n"
+                          "2\n00:00:03,000 --> 00:00:04,000\nOnly line\n\n",
+       nullptr, 0},
+      {"cue ending in a number", "1\n00:00:01,000 --> 00:00:02,000\nThe answer is\n42\n\n"
+                                 "2\n00:00:03,000 --> 00:00:04,000\nRight\n\n",
+       nullptr, 0},
+      {"missing blank line", "1\n00:00:01,000 --> 00:00:02,000\nOne\n2\n00:00:03,000 --> 00:00:04,000\nTwo\n\n",
+       "1\n00:00:01,000 --> 00:00:02,000\nOne\n\n2\n00:00:03,000 --> 00:00:04,000\nTwo\n\n", 1},
+  };
+  int wrong = 0;
+  for (auto &sample : samples) {
+    auto result = SubtitleText::normalize(sample.input, 0);
+    auto expected = sample.expected ? sample.expected : sample.input;
+    bool ok = result.srt && result.text == expected && result.repairs == sample.repairs;
+    if (!ok) {
+      fmt::print(stderr, "srt check: {}: {} repairs, got:\n{}\n", sample.name, result.repairs, result.text);
+      wrong++;
+    }
+  }
+  fmt::print("srt check: {}/{} samples as expected\n", std::size(samples) - wrong, std::size(samples));
+  return wrong;
+}
+
+static void usage(const char *prog) {
+  fmt::print(stderr,
+             "Usage: {} [options] <subtitle dir>\n"
+             "  --bandwidth <KiB/s>    per connection, 0 for unlimited (default 0)\n"
+             "  --latency <ms>         before every response (default 0)\n"
+             "  --runs <n>             cache opens, the first one cold (default 2)\n"
+             "  --cache <dir>          cache directory to use and keep (default a temporary one)\n"
+             "  --timeout <secs>       per run (default 60)\n",
+             prog);
+}
+
+static bool parse(int argc, char *argv[], Options &opts) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) throw std::invalid_argument(fmt::format("{} needs a value", arg));
+      return argv[++i];
+    };
+    if (arg == "--bandwidth")
+      opts.shaping.bandwidth = std::stoll(value()) * 1024;
+    else if (arg == "--latency")
+      opts.shaping.latencyMs = std::stoi(value());
+    else if (arg == "--runs")
+      opts.runs = std::stoi(value());
+    else if (arg == "--cache")
+      opts.cache = value();
+    else if (arg == "--timeout")
+      opts.timeoutSecs = std::stoi(value());
+    else if (arg.starts_with("--"))
+      throw std::invalid_argument(fmt::format("unknown option {}", arg));
+    else
+      opts.dir = arg;
+  }
+  return !opts.dir.empty();
+}
+
+int main(int argc, char *argv[]) {
+  Options opts;
+  try {
+    if (!parse(argc, argv, opts)) {
+      usage(argv[0]);
+      return 1;
+    }
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "Error: {}\n", e.what());
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::signal(SIGPIPE, SIG_IGN);
+  if (checkRepairs() > 0) return 1;
+  auto root = std::filesystem::absolute(opts.dir);
+  std::vector<SubtitleCache::Item> items;
+  std::error_code ec;
+  for (auto &file : std::filesystem::directory_iterator(root, ec))
+    if (file.is_regular_file()) items.push_back({"", file.path().filename().string()});
+  if (items.empty()) {
+    fmt::print(stderr, "Error: no files in {}\n", opts.dir);
+    return 1;
+  }
+
+  bool temporary = opts.cache.empty();
+  auto cacheDir = temporary ? std::filesystem::temp_directory_path() / fmt::format("subtitle_bench-{}", getpid())
+                            : std::filesystem::path(opts.cache);
+  Bench::RangeServer server(root, opts.shaping);
+  int failed = 0;
+  try {
+    server.start();
+    for (auto &item : items) item.url = server.url(item.name);
+    fmt::print("serving {} subtitles from {}, cache in {}\n", items.size(), root.string(), cacheDir.string());
+
+    for (int run = 0; run < opts.runs; run++) {
+      auto &c = server.counters();
+      int64_t requests = c.requests, bytes = c.bytes;
+
+      Mpv mpv;
+      std::pair<const char *, const char *> defaults[] = {
+          {"config", "no"}, {"load-scripts", "no"}, {"vo", "null"}, {"ao", "null"}, {"idle", "yes"}};
+      for (auto [name, value] : defaults) mpv.option(name, value);
+      mpv.initCore();
+      SubtitleCache cache(&mpv);  // destroyed first, its workers use mpv
+      if (!cache.open(cacheDir)) throw std::runtime_error(fmt::format("cannot use {}", cacheDir.string()));
+
+      auto start = clock_type::now();
+      cache.prefetch(items);
+      auto deadline = start + std::chrono::seconds(opts.timeoutSecs);
+      // done once nothing is queued or downloading, items evicted right away end up Unknown
+      int ready = 0, failures = 0, pending = 0;
+      while (true) {
+        ready = failures = pending = 0;
+        for (auto &item : items) {
+          auto state = cache.state(item.url);
+          ready += state == SubtitleCache::State::Ready;
+          failures += state == SubtitleCache::State::Failed;
+          pending += state == SubtitleCache::State::Queued || state == SubtitleCache::State::Fetching;
+        }
+        if (pending == 0 || clock_type::now() > deadline) break;
+        mpv.waitEvent(0.01);
+      }
+      double ms = std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+
+      fmt::print("run {}: {}/{} ready, {} failed, {} evicted in {:.1f} ms, {} requests, {:.1f} KiB sent\n", run + 1,
+                 ready, items.size(), failures, (int)items.size() - ready - failures - pending, ms,
+                 c.requests - requests, (c.bytes - bytes) / 1024.0);
+      for (auto &report : cache.reports())
+        fmt::print("  {:<40} {:<12} {:>3} repairs {:>8.2f} ms{}\n", report.name, report.encoding, report.repairs,
+                   report.ms, report.cached ? " (cached)" : "");
+      if (failures > 0 || pending > 0) failed++;
+    }
+  } catch (const std::exception &e) {
+    fmt::print(stderr, "Error: {}\n", e.what());
+    failed++;
+  }
+  server.stop();
+  if (temporary) std::filesystem::remove_all(cacheDir, ec);
+  return failed > 0 ? 1 : 0;
+}